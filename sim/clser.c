@@ -0,0 +1,352 @@
+/* Copyright (C) 2011, 2012 Matthias Vogelgesang <matthias.vogelgesang@kit.edu>
+   (Karlsruhe Institute of Technology)
+
+   This library is free software; you can redistribute it and/or modify it
+   under the terms of the GNU Lesser General Public License as published by the
+   Free Software Foundation; either version 2.1 of the License, or (at your
+   option) any later version.
+
+   This library is distributed in the hope that it will be useful, but WITHOUT
+   ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+   FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+   details.
+
+   You should have received a copy of the GNU Lesser General Public License along
+   with this library; if not, write to the Free Software Foundation, Inc., 51
+   Franklin St, Fifth Floor, Boston, MA 02110, USA */
+
+/*
+ * Simulated camera behind the CameraLink serial interface of clsersis. The
+ * camera answers the telegrams of sc2_telegram.h from a table of properties:
+ * a GET returns the stored response, the matching SET overwrites its fields
+ * with those of the request and any other command is acknowledged. The camera
+ * describes itself according to the setup in sim.h, so that its resolution,
+ * type and data format fit the frames generated by the simulated grabber.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "clser.h"
+#include "sc2_defs.h"
+#include "sc2_cl.h"
+#include "sc2_common.h"
+#include "sc2_command.h"
+#include "sc2_telegram.h"
+#include "sc2_add.h"
+#include "sim.h"
+
+#define HEADER_SIZE     (2 * sizeof(uint16_t))
+
+typedef struct {
+    uint16_t get_code;
+    uint16_t set_code;
+    uint16_t size;
+    uint8_t data[PCO_SC2_DEF_BLOCK_SIZE];
+} property;
+
+typedef struct {
+    bool open;
+    uint8_t response[PCO_SC2_DEF_BLOCK_SIZE];
+    unsigned int length;
+    unsigned int offset;
+} port;
+
+#define PROPERTY(get, set, type) { get, set, sizeof(type), { 0 } }
+
+static property properties[] = {
+    PROPERTY (GET_CAMERA_TYPE,                  0,                                  SC2_Camera_Type_Response),
+    PROPERTY (GET_CAMERA_HEALTH_STATUS,         0,                                  SC2_Camera_Health_Status_Response),
+    PROPERTY (GET_TEMPERATURE,                  0,                                  SC2_Temperature_Response),
+    PROPERTY (GET_CAMERA_NAME,                  0,                                  SC2_Camera_Name_Response),
+    PROPERTY (GET_CAMERA_SETUP,                 SET_CAMERA_SETUP,                   SC2_Get_Camera_Setup_Response),
+    PROPERTY (GET_CAMERA_DESCRIPTION,           0,                                  SC2_Camera_Description_Response),
+    PROPERTY (GET_ROI,                          SET_ROI,                            SC2_ROI_Response),
+    PROPERTY (GET_BINNING,                      SET_BINNING,                        SC2_Binning_Response),
+    PROPERTY (GET_PIXELRATE,                    SET_PIXELRATE,                      SC2_Pixelrate_Response),
+    PROPERTY (GET_DOUBLE_IMAGE_MODE,            SET_DOUBLE_IMAGE_MODE,              SC2_Double_Image_Mode_Response),
+    PROPERTY (GET_ADC_OPERATION,                SET_ADC_OPERATION,                  SC2_ADC_Operation_Response),
+    PROPERTY (GET_COOLING_SETPOINT_TEMPERATURE, SET_COOLING_SETPOINT_TEMPERATURE,   SC2_Cooling_Setpoint_Response),
+    PROPERTY (GET_OFFSET_MODE,                  SET_OFFSET_MODE,                    SC2_Offset_Mode_Response),
+    PROPERTY (GET_SENSOR_FORMAT,                SET_SENSOR_FORMAT,                  SC2_Sensor_Format_Response),
+    PROPERTY (GET_NOISE_FILTER_MODE,            SET_NOISE_FILTER_MODE,              SC2_Noise_Filter_Mode_Response),
+    PROPERTY (GET_HOT_PIXEL_CORRECTION_MODE,    SET_HOT_PIXEL_CORRECTION_MODE,      SC2_Hot_Pixel_Correction_Mode_Response),
+    PROPERTY (GET_DELAY_EXPOSURE_TIME,          SET_DELAY_EXPOSURE_TIME,            SC2_Delay_Exposure_Response),
+    PROPERTY (GET_TRIGGER_MODE,                 SET_TRIGGER_MODE,                   SC2_Trigger_Mode_Response),
+    PROPERTY (GET_TIMEBASE,                     SET_TIMEBASE,                       SC2_Timebase_Response),
+    PROPERTY (GET_COC_RUNTIME,                  0,                                  SC2_COC_Runtime_Response),
+    PROPERTY (GET_FRAMERATE,                    SET_FRAMERATE,                      SC2_Get_Framerate_Response),
+    PROPERTY (GET_CAMERA_RAM_SEGMENT_SIZE,      0,                                  SC2_Camera_RAM_Segment_Size_Response),
+    PROPERTY (GET_ACTIVE_RAM_SEGMENT,           0,                                  SC2_Active_RAM_Segment_Response),
+    PROPERTY (GET_NUMBER_OF_IMAGES_IN_SEGMENT,  0,                                  SC2_Number_of_Images_Response),
+    PROPERTY (GET_STORAGE_MODE,                 SET_STORAGE_MODE,                   SC2_Storage_Mode_Response),
+    PROPERTY (GET_RECORDER_SUBMODE,             SET_RECORDER_SUBMODE,               SC2_Recorder_Submode_Response),
+    PROPERTY (GET_RECORDING_STATE,              SET_RECORDING_STATE,                SC2_Recording_State_Response),
+    PROPERTY (GET_ACQUIRE_MODE,                 SET_ACQUIRE_MODE,                   SC2_Acquire_Mode_Response),
+    PROPERTY (GET_TIMESTAMP_MODE,               SET_TIMESTAMP_MODE,                 SC2_Timestamp_Mode_Response),
+    PROPERTY (GET_BIT_ALIGNMENT,                SET_BIT_ALIGNMENT,                  SC2_Bit_Alignment_Response),
+    PROPERTY (GET_METADATA_MODE,                SET_METADATA_MODE,                  SC2_Metadata_Mode_Response),
+    PROPERTY (GET_INTERFACE_OUTPUT_FORMAT,      SET_INTERFACE_OUTPUT_FORMAT,        SC2_Get_Interface_Output_Format_Response),
+    PROPERTY (GET_CL_BAUDRATE,                  SET_CL_BAUDRATE,                    SC2_Get_CL_Baudrate_Response),
+    PROPERTY (GET_CL_CONFIGURATION,             SET_CL_CONFIGURATION,               SC2_Get_CL_Configuration_Response),
+};
+
+#define NUM_PROPERTIES (sizeof(properties) / sizeof(property))
+
+static port ports[1];
+static bool initialized = false;
+
+static property *
+find_property (uint16_t code)
+{
+    for (unsigned int i = 0; i < NUM_PROPERTIES; i++) {
+        if (properties[i].get_code == code || (properties[i].set_code != 0 && properties[i].set_code == code))
+            return &properties[i];
+    }
+
+    return NULL;
+}
+
+static void *
+get_data (uint16_t code)
+{
+    return find_property (code)->data;
+}
+
+static void
+init_properties (void)
+{
+    pco_sim_config config;
+    SC2_Camera_Type_Response *type;
+    SC2_Camera_Description_Response *desc;
+    SC2_Camera_Name_Response *name;
+    SC2_ROI_Response *roi;
+    SC2_Delay_Exposure_Response *delay_exposure;
+    SC2_Timebase_Response *timebase;
+    SC2_COC_Runtime_Response *runtime;
+    SC2_Get_Framerate_Response *framerate;
+    SC2_Get_CL_Configuration_Response *cl_config;
+    SC2_Get_Interface_Output_Format_Response *output_format;
+    uint8_t data_format;
+
+    pco_sim_get_config (&config);
+
+    for (unsigned int i = 0; i < NUM_PROPERTIES; i++) {
+        uint16_t *header = (uint16_t *) properties[i].data;
+
+        memset (properties[i].data, 0, PCO_SC2_DEF_BLOCK_SIZE);
+        header[0] = properties[i].get_code;
+        header[1] = properties[i].size;
+    }
+
+    type = get_data (GET_CAMERA_TYPE);
+    type->wCamType = config.format == PCO_SIM_FORMAT_GRAY16 ? CAMERATYPE_PCO4000 : CAMERATYPE_PCO_EDGE;
+    type->dwSerialNumber = 1;
+    type->dwHWVersion = 0x00010000;
+    type->dwFWVersion = 0x00010000;
+
+    desc = get_data (GET_CAMERA_DESCRIPTION);
+    desc->wMaxHorzResStdDESC = desc->wMaxHorzResExtDESC = (uint16_t) config.width;
+    desc->wMaxVertResStdDESC = desc->wMaxVertResExtDESC = (uint16_t) config.height;
+    desc->wDynResDESC = 16;
+    desc->wMaxBinHorzDESC = desc->wMaxBinVertDESC = 1;
+    desc->wRoiHorStepsDESC = desc->wRoiVertStepsDESC = 1;
+    desc->wNumADCsDESC = 1;
+    desc->dwPixelRateDESC[0] = 95333333;
+    desc->dwPixelRateDESC[1] = 286000000;
+    desc->dwMaxDelayDESC = 1000;
+    desc->dwMinDelayStepDESC = 10;
+    desc->dwMinExposureDESC = 500;
+    desc->dwMaxExposureDESC = 2000;
+    desc->dwMinExposureStepDESC = 10;
+
+    name = get_data (GET_CAMERA_NAME);
+    strncpy (name->szName, type->wCamType == CAMERATYPE_PCO4000 ? "pco.4000 (simulated)" : "pco.edge (simulated)",
+             sizeof(name->szName) - 1);
+
+    roi = get_data (GET_ROI);
+    roi->wROI_x0 = 1;
+    roi->wROI_y0 = 1;
+    roi->wROI_x1 = (uint16_t) config.width;
+    roi->wROI_y1 = (uint16_t) config.height;
+
+    /* Exposure and delay in microseconds, exposing during the whole frame */
+    timebase = get_data (GET_TIMEBASE);
+    timebase->wTimebaseDelay = 1;
+    timebase->wTimebaseExposure = 1;
+
+    delay_exposure = get_data (GET_DELAY_EXPOSURE_TIME);
+    delay_exposure->dwExposure = (uint32_t) (1e6 / config.fps);
+
+    runtime = get_data (GET_COC_RUNTIME);
+    runtime->dwtime_s = (uint32_t) (1 / config.fps);
+    runtime->dwtime_ns = (uint32_t) ((1 / config.fps - runtime->dwtime_s) * 1e9);
+
+    framerate = get_data (GET_FRAMERATE);
+    framerate->dwFramerate = (uint32_t) (config.fps * 1000);
+    framerate->dwExposure = delay_exposure->dwExposure * 1000;
+
+    ((SC2_Timestamp_Mode_Response *) get_data (GET_TIMESTAMP_MODE))->wMode = TIMESTAMP_MODE_BINARY;
+    ((SC2_Bit_Alignment_Response *) get_data (GET_BIT_ALIGNMENT))->wAlignment = 1;
+    ((SC2_Active_RAM_Segment_Response *) get_data (GET_ACTIVE_RAM_SEGMENT))->wSegment = 1;
+    ((SC2_Get_CL_Baudrate_Response *) get_data (GET_CL_BAUDRATE))->dwBaudrate = 115200;
+
+    /* The scan mode is derived from the pixel rate, see pco_get_scan_mode() */
+    ((SC2_Pixelrate_Response *) get_data (GET_PIXELRATE))->dwPixelrate =
+        desc->dwPixelRateDESC[config.format == PCO_SIM_FORMAT_5X12 ? 1 : 0];
+
+    data_format = config.format == PCO_SIM_FORMAT_5X12 ? PCO_CL_DATAFORMAT_5x12 : PCO_CL_DATAFORMAT_5x16;
+
+    if (config.format == PCO_SIM_FORMAT_GRAY16)
+        data_format = PCO_CL_DATAFORMAT_1x16;
+
+    cl_config = get_data (GET_CL_CONFIGURATION);
+    cl_config->dwClockFrequency = 85000000;
+    cl_config->bDataFormat = data_format;
+    cl_config->bTransmit = 1;
+
+    output_format = get_data (GET_INTERFACE_OUTPUT_FORMAT);
+    output_format->wInterface = SET_INTERFACE_CAMERALINK;
+    output_format->wFormat = config.format == PCO_SIM_FORMAT_GRAY16 ? 0 : SCCMOS_FORMAT_TOP_CENTER_BOTTOM_CENTER;
+}
+
+static void
+set_checksum (uint8_t *telegram, unsigned int size)
+{
+    uint8_t sum = 0;
+
+    for (unsigned int i = 0; i < size - 1; i++)
+        sum += telegram[i];
+
+    telegram[size - 1] = sum;
+}
+
+static void
+respond (port *p, const uint8_t *request, unsigned int size)
+{
+    const uint16_t code = ((const uint16_t *) request)[0];
+    property *prop = find_property (code);
+    uint16_t *header = (uint16_t *) p->response;
+
+    if (prop == NULL) {
+        /* Commands without state, e.g. ARM_CAMERA, are simply acknowledged */
+        memcpy (p->response, request, size);
+        p->length = size;
+    }
+    else {
+        if (code == prop->set_code && size > HEADER_SIZE + 1) {
+            unsigned int payload = size - HEADER_SIZE - 1;
+
+            if (payload > prop->size - HEADER_SIZE - 1u)
+                payload = prop->size - HEADER_SIZE - 1;
+
+            memcpy (prop->data + HEADER_SIZE, request + HEADER_SIZE, payload);
+        }
+
+        memcpy (p->response, prop->data, prop->size);
+        p->length = prop->size;
+    }
+
+    header[0] = code | RESPONSE_OK_CODE;
+    header[1] = (uint16_t) p->length;
+    set_checksum (p->response, p->length);
+    p->offset = 0;
+}
+
+int
+clGetNumSerialPorts (unsigned int *num_ports)
+{
+    *num_ports = sizeof(ports) / sizeof(port);
+    return CL_OK;
+}
+
+int
+clSerialInit (unsigned int index, void **serial_ref)
+{
+    if (index >= sizeof(ports) / sizeof(port))
+        return CL_ERR_INVALID_INDEX;
+
+    if (!initialized) {
+        init_properties ();
+        initialized = true;
+    }
+
+    ports[index].open = true;
+    ports[index].length = ports[index].offset = 0;
+    *serial_ref = &ports[index];
+    return CL_OK;
+}
+
+void
+clSerialClose (void *serial_ref)
+{
+    if (serial_ref != NULL)
+        ((port *) serial_ref)->open = false;
+}
+
+int
+clSerialRead (void *serial_ref, char *buffer, unsigned int *size, unsigned int timeout)
+{
+    port *p = (port *) serial_ref;
+    unsigned int available;
+
+    if (p == NULL || !p->open)
+        return CL_ERR_INVALID_REFERENCE;
+
+    available = p->length - p->offset;
+
+    if (available < *size) {
+        *size = 0;
+        return CL_ERR_TIMEOUT;
+    }
+
+    memcpy (buffer, p->response + p->offset, *size);
+    p->offset += *size;
+    return CL_OK;
+}
+
+int
+clSerialWrite (void *serial_ref, char *buffer, unsigned int *size, unsigned int timeout)
+{
+    port *p = (port *) serial_ref;
+
+    if (p == NULL || !p->open)
+        return CL_ERR_INVALID_REFERENCE;
+
+    if (*size <= HEADER_SIZE || *size > PCO_SC2_DEF_BLOCK_SIZE)
+        return CL_OK;
+
+    respond (p, (const uint8_t *) buffer, *size);
+    return CL_OK;
+}
+
+int
+clFlushPort (void *serial_ref)
+{
+    port *p = (port *) serial_ref;
+
+    if (p == NULL || !p->open)
+        return CL_ERR_INVALID_REFERENCE;
+
+    p->length = p->offset = 0;
+    return CL_OK;
+}
+
+int
+clGetSupportedBaudRates (void *serial_ref, unsigned int *baud_rates)
+{
+    *baud_rates = CL_BAUDRATE_9600 | CL_BAUDRATE_19200 | CL_BAUDRATE_38400 | CL_BAUDRATE_57600 | CL_BAUDRATE_115200;
+    return CL_OK;
+}
+
+int
+clSetBaudRate (void *serial_ref, unsigned int baud_rate)
+{
+    if (!(baud_rate & (CL_BAUDRATE_9600 | CL_BAUDRATE_19200 | CL_BAUDRATE_38400 | CL_BAUDRATE_57600 | CL_BAUDRATE_115200)))
+        return CL_ERR_BAUD_RATE_NOT_SUPPORTED;
+
+    return CL_OK;
+}
@@ -0,0 +1,50 @@
+/* Copyright (C) 2011, 2012 Matthias Vogelgesang <matthias.vogelgesang@kit.edu>
+   (Karlsruhe Institute of Technology)
+
+   This library is free software; you can redistribute it and/or modify it
+   under the terms of the GNU Lesser General Public License as published by the
+   Free Software Foundation; either version 2.1 of the License, or (at your
+   option) any later version.
+
+   This library is distributed in the hope that it will be useful, but WITHOUT
+   ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+   FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+   details.
+
+   You should have received a copy of the GNU Lesser General Public License along
+   with this library; if not, write to the Free Software Foundation, Inc., 51
+   Franklin St, Fifth Floor, Boston, MA 02110, USA */
+
+/*
+ * CameraLink serial interface of the simulated camera, see clser.c.
+ */
+
+#ifndef __CLSER_H
+#define __CLSER_H
+
+#define CL_OK                       0
+#define CL_ERR_PORT_IN_USE          -10001
+#define CL_ERR_TIMEOUT              -10003
+#define CL_ERR_INVALID_INDEX        -10005
+#define CL_ERR_INVALID_REFERENCE    -10006
+#define CL_ERR_BAUD_RATE_NOT_SUPPORTED -10009
+
+#define CL_BAUDRATE_9600            1
+#define CL_BAUDRATE_19200           2
+#define CL_BAUDRATE_38400           4
+#define CL_BAUDRATE_57600           8
+#define CL_BAUDRATE_115200          16
+#define CL_BAUDRATE_230400          32
+#define CL_BAUDRATE_460800          64
+#define CL_BAUDRATE_921600          128
+
+int clGetNumSerialPorts (unsigned int *num_ports);
+int clSerialInit (unsigned int index, void **serial_ref);
+void clSerialClose (void *serial_ref);
+int clSerialRead (void *serial_ref, char *buffer, unsigned int *size, unsigned int timeout);
+int clSerialWrite (void *serial_ref, char *buffer, unsigned int *size, unsigned int timeout);
+int clFlushPort (void *serial_ref);
+int clGetSupportedBaudRates (void *serial_ref, unsigned int *baud_rates);
+int clSetBaudRate (void *serial_ref, unsigned int baud_rate);
+
+#endif
@@ -0,0 +1,58 @@
+/* Copyright (C) 2011, 2012 Matthias Vogelgesang <matthias.vogelgesang@kit.edu>
+   (Karlsruhe Institute of Technology)
+
+   This library is free software; you can redistribute it and/or modify it
+   under the terms of the GNU Lesser General Public License as published by the
+   Free Software Foundation; either version 2.1 of the License, or (at your
+   option) any later version.
+
+   This library is distributed in the hope that it will be useful, but WITHOUT
+   ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+   FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+   details.
+
+   You should have received a copy of the GNU Lesser General Public License along
+   with this library; if not, write to the Free Software Foundation, Inc., 51
+   Franklin St, Fifth Floor, Boston, MA 02110, USA */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "sim.h"
+
+static double
+get_number (const char *name, double fallback, double min, double max)
+{
+    const char *value = getenv (name);
+    char *end;
+    double number;
+
+    if (value == NULL)
+        return fallback;
+
+    number = strtod (value, &end);
+
+    if (end == value || number < min || number > max)
+        return fallback;
+
+    return number;
+}
+
+void
+pco_sim_get_config (pco_sim_config *config)
+{
+    const char *format = getenv ("PCO_SIM_FORMAT");
+
+    config->format = PCO_SIM_FORMAT_5X16;
+
+    if (format != NULL && strcmp (format, "5x12") == 0)
+        config->format = PCO_SIM_FORMAT_5X12;
+    else if (format != NULL && strcmp (format, "gray16") == 0)
+        config->format = PCO_SIM_FORMAT_GRAY16;
+
+    config->width = (uint32_t) get_number ("PCO_SIM_WIDTH", 2560, 16, 65535);
+    config->height = (uint32_t) get_number ("PCO_SIM_HEIGHT", 2160, 1, 65535);
+    config->fps = get_number ("PCO_SIM_FPS", 100, 0.001, 1e6);
+    config->jitter = (uint32_t) get_number ("PCO_SIM_JITTER", 0, 0, 1e7);
+    config->drop_rate = get_number ("PCO_SIM_DROP", 0, 0, 100) / 100.0;
+}
@@ -0,0 +1,571 @@
+/* Copyright (C) 2011, 2012 Matthias Vogelgesang <matthias.vogelgesang@kit.edu>
+   (Karlsruhe Institute of Technology)
+
+   This library is free software; you can redistribute it and/or modify it
+   under the terms of the GNU Lesser General Public License as published by the
+   Free Software Foundation; either version 2.1 of the License, or (at your
+   option) any later version.
+
+   This library is distributed in the hope that it will be useful, but WITHOUT
+   ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+   FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+   details.
+
+   You should have received a copy of the GNU Lesser General Public License along
+   with this library; if not, write to the Free Software Foundation, Inc., 51
+   Franklin St, Fifth Floor, Boston, MA 02110, USA */
+
+/*
+ * Simulated frame grabber, a stand-in for the SiliconSoftware fglib5 that
+ * generates frames instead of receiving them. It is set up through the same
+ * parameters as the real grabber and writes frames into the DMA buffers at the
+ * configured rate, see sim.h. pco.edge frames are generated in the raw 5x16 or
+ * 5x12 layout, other cameras deliver 16 bit pixels in display order.
+ *
+ * Each frame starts with a binary time stamp, whose image counter keeps
+ * counting frames that are dropped so that losses can be detected as with a
+ * real camera. The pixels are a fixed gradient, generated once and copied into
+ * each buffer to cost as much memory bandwidth as a DMA transfer.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "fgrab_struct.h"
+#include "fgrab_prototyp.h"
+#include "sim.h"
+
+#define NUM_PORTS           2
+#define TIMESTAMP_PIXELS    14
+
+enum {
+    WIDTH,
+    HEIGHT,
+    FORMAT,
+    CL_TYPE,
+    TRIGGER_MODE,
+    TIMEOUT,
+    NUM_PARAMETERS
+};
+
+struct Fg_Struct_s {
+    pco_sim_config config;
+    int parameters[NUM_PORTS][NUM_PARAMETERS];
+    int last_error;
+};
+
+struct dma_mem_s {
+    Fg_Struct *fg;
+    uint8_t *memory;
+    size_t buffer_size;
+    frameindex_t num_buffers;
+
+    /* Frame as transferred and its first row in display order */
+    uint16_t *frame;
+    uint16_t *first_row;
+    size_t frame_size;
+    pco_sim_format format;
+    int width;
+
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    frameindex_t last;
+    frameindex_t num_frames;
+    bool running;
+    bool stop;
+};
+
+static void
+set_error (Fg_Struct *fg, int error)
+{
+    if (fg != NULL)
+        fg->last_error = error;
+}
+
+static int
+find_parameter (int parameter)
+{
+    switch (parameter) {
+        case FG_WIDTH:
+            return WIDTH;
+        case FG_HEIGHT:
+            return HEIGHT;
+        case FG_FORMAT:
+            return FORMAT;
+        case FG_CAMERA_LINK_CAMTYP:
+            return CL_TYPE;
+        case FG_TRIGGERMODE:
+            return TRIGGER_MODE;
+        case FG_TIMEOUT:
+            return TIMEOUT;
+        default:
+            return -1;
+    }
+}
+
+/*
+ * Raw pco.edge lines alternate between the top and the bottom half of the
+ * frame, see pco_reorder_image_5x16().
+ */
+static int
+get_row (int line, int height)
+{
+    return line % 2 == 0 ? line / 2 : height - 1 - line / 2;
+}
+
+static uint16_t
+get_pixel (int x, int y)
+{
+    return (uint16_t) ((x + y) & 0xFFF);
+}
+
+/* Pixels of a 5x12 line are a stream of 12 bit values, MSB first */
+static void
+pack_line_5x12 (uint16_t *out, const uint16_t *in, int width)
+{
+    memset (out, 0, ((width * 12 + 15) / 16) * sizeof(uint16_t));
+
+    for (int x = 0; x < width; x++) {
+        const int word = (x * 12) / 16;
+        const int shift = (x * 12) % 16;
+        const uint32_t v = (uint32_t) (in[x] & 0xFFF) << (20 - shift);
+
+        out[word] |= (uint16_t) (v >> 16);
+
+        if (shift > 4)
+            out[word + 1] |= (uint16_t) (v & 0xFFFF);
+    }
+}
+
+static size_t
+get_pitch (pco_sim_format format, int width)
+{
+    return format == PCO_SIM_FORMAT_5X12 ? (size_t) (width * 12 + 15) / 16 : (size_t) width;
+}
+
+static bool
+generate_frame (dma_mem *mem, unsigned int port)
+{
+    Fg_Struct *fg = mem->fg;
+    const int height = fg->parameters[port][HEIGHT];
+    size_t pitch;
+
+    /* The pco.edge applets transfer 16 bit pixels as pairs of 8 bit pixels */
+    if (fg->parameters[port][FORMAT] == FG_GRAY16) {
+        mem->format = PCO_SIM_FORMAT_GRAY16;
+        mem->width = fg->parameters[port][WIDTH];
+    }
+    else {
+        mem->format = fg->config.format == PCO_SIM_FORMAT_5X12 ? PCO_SIM_FORMAT_5X12 : PCO_SIM_FORMAT_5X16;
+        mem->width = fg->parameters[port][WIDTH] / 2;
+    }
+
+    pitch = get_pitch (mem->format, mem->width);
+    mem->frame_size = pitch * height * sizeof(uint16_t);
+
+    if (mem->width < TIMESTAMP_PIXELS || height < 1 || mem->frame_size > mem->buffer_size)
+        return false;
+
+    free (mem->frame);
+    free (mem->first_row);
+    mem->frame = (uint16_t *) malloc (mem->frame_size);
+    mem->first_row = (uint16_t *) malloc (mem->width * sizeof(uint16_t));
+
+    if (mem->frame == NULL || mem->first_row == NULL)
+        return false;
+
+    for (int line = 0; line < height; line++) {
+        const int y = mem->format == PCO_SIM_FORMAT_GRAY16 ? line : get_row (line, height);
+        uint16_t *out = mem->frame + line * pitch;
+
+        for (int x = 0; x < mem->width; x++)
+            mem->first_row[x] = get_pixel (x, y);
+
+        if (mem->format == PCO_SIM_FORMAT_5X12)
+            pack_line_5x12 (out, mem->first_row, mem->width);
+        else
+            memcpy (out, mem->first_row, mem->width * sizeof(uint16_t));
+    }
+
+    /* The first raw line is the top row in all layouts */
+    for (int x = 0; x < mem->width; x++)
+        mem->first_row[x] = get_pixel (x, 0);
+
+    return true;
+}
+
+static uint16_t
+to_bcd (unsigned int value)
+{
+    return (uint16_t) (((value / 10) % 10) << 4 | (value % 10));
+}
+
+static void
+write_timestamp (dma_mem *mem, uint16_t *frame, uint32_t counter)
+{
+    uint16_t pixels[16];
+    struct timespec now;
+    /* -fpack-struct makes struct tm shorter than the one localtime_r() fills */
+    union {
+        struct tm tm;
+        uint8_t space[2 * sizeof(struct tm)];
+    } local;
+    struct tm tm;
+    time_t seconds;
+    unsigned int us;
+    int n = mem->width < 16 ? mem->width : 16;
+
+    clock_gettime (CLOCK_REALTIME, &now);
+    seconds = now.tv_sec;
+    localtime_r (&seconds, &local.tm);
+    tm = local.tm;
+    us = (unsigned int) (now.tv_nsec / 1000);
+
+    memcpy (pixels, mem->first_row, n * sizeof(uint16_t));
+    pixels[0] = to_bcd (counter / 1000000);
+    pixels[1] = to_bcd (counter / 10000);
+    pixels[2] = to_bcd (counter / 100);
+    pixels[3] = to_bcd (counter);
+    pixels[4] = to_bcd ((tm.tm_year + 1900) / 100);
+    pixels[5] = to_bcd (tm.tm_year + 1900);
+    pixels[6] = to_bcd (tm.tm_mon + 1);
+    pixels[7] = to_bcd (tm.tm_mday);
+    pixels[8] = to_bcd (tm.tm_hour);
+    pixels[9] = to_bcd (tm.tm_min);
+    pixels[10] = to_bcd (tm.tm_sec);
+    pixels[11] = to_bcd (us / 10000);
+    pixels[12] = to_bcd (us / 100);
+    pixels[13] = to_bcd (us);
+
+    /* 16 pixels of a 5x12 line fill exactly 12 words */
+    if (mem->format == PCO_SIM_FORMAT_5X12)
+        pack_line_5x12 (frame, pixels, n);
+    else
+        memcpy (frame, pixels, n * sizeof(uint16_t));
+}
+
+static void
+add_time (struct timespec *t, long ns)
+{
+    t->tv_nsec += ns;
+
+    while (t->tv_nsec >= 1000000000) {
+        t->tv_nsec -= 1000000000;
+        t->tv_sec++;
+    }
+}
+
+static bool
+is_stopped (dma_mem *mem)
+{
+    bool stop;
+
+    pthread_mutex_lock (&mem->lock);
+    stop = mem->stop;
+    pthread_mutex_unlock (&mem->lock);
+    return stop;
+}
+
+static void *
+transfer_frames (void *data)
+{
+    dma_mem *mem = (dma_mem *) data;
+    const pco_sim_config *config = &mem->fg->config;
+    const long period = (long) (1e9 / config->fps);
+    unsigned int seed = (unsigned int) time (NULL);
+    struct timespec next;
+    frameindex_t number = 0;
+    uint32_t counter = 0;
+
+    clock_gettime (CLOCK_MONOTONIC, &next);
+
+    while (mem->num_frames == GRAB_INFINITE || number < mem->num_frames) {
+        struct timespec due = next;
+        uint16_t *frame;
+
+        add_time (&next, period);
+
+        if (config->jitter > 0)
+            add_time (&due, (long) (rand_r (&seed) % (config->jitter + 1)) * 1000);
+
+        clock_nanosleep (CLOCK_MONOTONIC, TIMER_ABSTIME, &due, NULL);
+
+        if (is_stopped (mem))
+            break;
+
+        counter++;
+
+        /* Lost on the link, the camera counted it but the grabber never sees it */
+        if (config->drop_rate > 0 && rand_r (&seed) < config->drop_rate * ((double) RAND_MAX + 1))
+            continue;
+
+        number++;
+        frame = (uint16_t *) (mem->memory + ((number - 1) % mem->num_buffers) * mem->buffer_size);
+        memcpy (frame, mem->frame, mem->frame_size);
+        write_timestamp (mem, frame, counter);
+
+        pthread_mutex_lock (&mem->lock);
+        mem->last = number;
+        pthread_cond_broadcast (&mem->cond);
+        pthread_mutex_unlock (&mem->lock);
+    }
+
+    return NULL;
+}
+
+Fg_Struct *
+Fg_Init (const char *applet, unsigned int board)
+{
+    Fg_Struct *fg;
+
+    if (applet == NULL || board > 0)
+        return NULL;
+
+    fg = (Fg_Struct *) calloc (1, sizeof(Fg_Struct));
+
+    if (fg == NULL)
+        return NULL;
+
+    pco_sim_get_config (&fg->config);
+
+    for (int i = 0; i < NUM_PORTS; i++) {
+        fg->parameters[i][WIDTH] = 1024;
+        fg->parameters[i][HEIGHT] = 1024;
+        fg->parameters[i][FORMAT] = FG_GRAY;
+        fg->parameters[i][TRIGGER_MODE] = FREE_RUN;
+        fg->parameters[i][TIMEOUT] = 1000000;
+    }
+
+    return fg;
+}
+
+int
+Fg_FreeGrabber (Fg_Struct *fg)
+{
+    free (fg);
+    return FG_OK;
+}
+
+int
+Fg_setParameter (Fg_Struct *fg, int parameter, const void *value, unsigned int port)
+{
+    int index;
+
+    if (fg == NULL || value == NULL || port >= NUM_PORTS)
+        return FG_INVALID_PARAMETER;
+
+    index = find_parameter (parameter);
+
+    if (index < 0) {
+        set_error (fg, FG_INVALID_PARAMETER);
+        return FG_INVALID_PARAMETER;
+    }
+
+    fg->parameters[port][index] = *((const int *) value);
+    return FG_OK;
+}
+
+int
+Fg_getParameter (Fg_Struct *fg, int parameter, void *value, unsigned int port)
+{
+    int index;
+
+    if (fg == NULL || value == NULL || port >= NUM_PORTS)
+        return FG_INVALID_PARAMETER;
+
+    switch (parameter) {
+        case FG_CAMSTATUS:
+            *((int *) value) = 1;
+            return FG_OK;
+        case FG_PIXELDEPTH:
+            *((int *) value) = fg->parameters[port][FORMAT] == FG_GRAY16 ? 16 : 8;
+            return FG_OK;
+        case FG_EXPOSURE:
+            *((int *) value) = (int) (1e6 / fg->config.fps);
+            return FG_OK;
+    }
+
+    index = find_parameter (parameter);
+
+    if (index < 0) {
+        set_error (fg, FG_INVALID_PARAMETER);
+        return FG_INVALID_PARAMETER;
+    }
+
+    *((int *) value) = fg->parameters[port][index];
+    return FG_OK;
+}
+
+dma_mem *
+Fg_AllocMemEx (Fg_Struct *fg, size_t size, frameindex_t num_buffers)
+{
+    dma_mem *mem;
+    void *memory;
+
+    if (fg == NULL || num_buffers < 1 || size < (size_t) num_buffers)
+        return NULL;
+
+    mem = (dma_mem *) calloc (1, sizeof(dma_mem));
+
+    if (mem == NULL || posix_memalign (&memory, 4096, size) != 0) {
+        free (mem);
+        set_error (fg, FG_NOT_ENOUGH_MEM);
+        return NULL;
+    }
+
+    mem->fg = fg;
+    mem->memory = (uint8_t *) memory;
+    mem->num_buffers = num_buffers;
+    mem->buffer_size = size / num_buffers;
+    pthread_mutex_init (&mem->lock, NULL);
+    pthread_cond_init (&mem->cond, NULL);
+    return mem;
+}
+
+int
+Fg_FreeMemEx (Fg_Struct *fg, dma_mem *mem)
+{
+    if (mem == NULL)
+        return FG_INVALID_PARAMETER;
+
+    if (mem->running)
+        Fg_stopAcquireEx (fg, 0, mem, STOP_SYNC);
+
+    pthread_mutex_destroy (&mem->lock);
+    pthread_cond_destroy (&mem->cond);
+    free (mem->frame);
+    free (mem->first_row);
+    free (mem->memory);
+    free (mem);
+    return FG_OK;
+}
+
+int
+Fg_AcquireEx (Fg_Struct *fg, unsigned int port, frameindex_t num_frames, int flags, dma_mem *mem)
+{
+    pthread_t thread;
+
+    if (fg == NULL || mem == NULL || port >= NUM_PORTS || mem->fg != fg)
+        return FG_INVALID_PARAMETER;
+
+    if (mem->running) {
+        set_error (fg, FG_ACQUISITION_RUNNING);
+        return FG_ACQUISITION_RUNNING;
+    }
+
+    if (!generate_frame (mem, port)) {
+        set_error (fg, FG_INVALID_PARAMETER);
+        return FG_INVALID_PARAMETER;
+    }
+
+    mem->last = 0;
+    mem->num_frames = num_frames;
+    mem->stop = false;
+
+    if (pthread_create (&thread, NULL, transfer_frames, mem) != 0) {
+        set_error (fg, FG_NOT_ENOUGH_MEM);
+        return FG_NOT_ENOUGH_MEM;
+    }
+
+    mem->thread = thread;
+    mem->running = true;
+    return FG_OK;
+}
+
+int
+Fg_stopAcquireEx (Fg_Struct *fg, unsigned int port, dma_mem *mem, int flags)
+{
+    if (mem == NULL || !mem->running)
+        return FG_INVALID_PARAMETER;
+
+    pthread_mutex_lock (&mem->lock);
+    mem->stop = true;
+    pthread_cond_broadcast (&mem->cond);
+    pthread_mutex_unlock (&mem->lock);
+
+    pthread_join (mem->thread, NULL);
+    mem->running = false;
+    return FG_OK;
+}
+
+frameindex_t
+Fg_getLastPicNumberBlockingEx (Fg_Struct *fg, frameindex_t number, unsigned int port, int timeout, dma_mem *mem)
+{
+    struct timespec deadline;
+    frameindex_t last;
+    int err = 0;
+
+    if (mem == NULL)
+        return FG_INVALID_PARAMETER;
+
+    clock_gettime (CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += timeout;
+
+    pthread_mutex_lock (&mem->lock);
+
+    while (mem->last < number && !mem->stop && err == 0)
+        err = pthread_cond_timedwait (&mem->cond, &mem->lock, &deadline);
+
+    last = mem->last >= number ? mem->last : FG_TIMEOUT_ERR;
+    pthread_mutex_unlock (&mem->lock);
+
+    if (last < 0)
+        set_error (fg, FG_TIMEOUT_ERR);
+
+    return last;
+}
+
+frameindex_t
+Fg_getLastPicNumberEx (Fg_Struct *fg, unsigned int port, dma_mem *mem)
+{
+    frameindex_t last;
+
+    if (mem == NULL)
+        return FG_INVALID_PARAMETER;
+
+    pthread_mutex_lock (&mem->lock);
+    last = mem->last;
+    pthread_mutex_unlock (&mem->lock);
+    return last;
+}
+
+void *
+Fg_getImagePtrEx (Fg_Struct *fg, frameindex_t number, unsigned int port, dma_mem *mem)
+{
+    if (mem == NULL || number < 1)
+        return NULL;
+
+    return mem->memory + ((number - 1) % mem->num_buffers) * mem->buffer_size;
+}
+
+int
+Fg_getLastErrorNumber (Fg_Struct *fg)
+{
+    return fg != NULL ? fg->last_error : FG_INVALID_PARAMETER;
+}
+
+const char *
+Fg_getLastErrorDescription (Fg_Struct *fg)
+{
+    switch (Fg_getLastErrorNumber (fg)) {
+        case FG_OK:
+            return "No error";
+        case FG_INVALID_PARAMETER:
+            return "Invalid parameter";
+        case FG_NOT_ENOUGH_MEM:
+            return "Not enough memory";
+        case FG_TIMEOUT_ERR:
+            return "Timeout";
+        case FG_ACQUISITION_RUNNING:
+            return "Acquisition is running";
+        default:
+            return "Unknown error";
+    }
+}
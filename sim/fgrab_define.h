@@ -0,0 +1,64 @@
+/* Copyright (C) 2011, 2012 Matthias Vogelgesang <matthias.vogelgesang@kit.edu>
+   (Karlsruhe Institute of Technology)
+
+   This library is free software; you can redistribute it and/or modify it
+   under the terms of the GNU Lesser General Public License as published by the
+   Free Software Foundation; either version 2.1 of the License, or (at your
+   option) any later version.
+
+   This library is distributed in the hope that it will be useful, but WITHOUT
+   ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+   FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+   details.
+
+   You should have received a copy of the GNU Lesser General Public License along
+   with this library; if not, write to the Free Software Foundation, Inc., 51
+   Franklin St, Fifth Floor, Boston, MA 02110, USA */
+
+/*
+ * Constants of the simulated frame grabber. The values are only meaningful
+ * together with the simulated library.
+ */
+
+#ifndef __FGRAB_DEFINE_H
+#define __FGRAB_DEFINE_H
+
+#define FGLIB_VERSION_STRING        "5.0.0-sim"
+
+#define FG_OK                       0
+#define FG_INVALID_PARAMETER        -2020
+#define FG_NOT_ENOUGH_MEM           -2021
+#define FG_TIMEOUT_ERR              -2120
+#define FG_ACQUISITION_RUNNING      -2121
+
+#define PORT_A                      0
+#define PORT_B                      1
+
+/* Parameters */
+#define FG_WIDTH                    100
+#define FG_HEIGHT                   200
+#define FG_FORMAT                   201
+#define FG_PIXELDEPTH               300
+#define FG_TIMEOUT                  2000000
+#define FG_CAMSTATUS                2000080
+#define FG_TRIGGERMODE              8100
+#define FG_EXPOSURE                 10020
+#define FG_CAMERA_LINK_CAMTYP       20011
+
+/* Values of FG_FORMAT */
+#define FG_GRAY                     3
+#define FG_GRAY16                   1
+
+/* Values of FG_CAMERA_LINK_CAMTYP */
+#define FG_CL_SINGLETAP_16_BIT      2
+#define FG_CL_8BIT_FULL_10          112
+
+/* Values of FG_TRIGGERMODE */
+#define FREE_RUN                    0
+
+#define GRAB_INFINITE               -1
+#define ACQ_STANDARD                0x1
+#define STOP_ASYNC                  0x0
+#define STOP_SYNC                   0x80000000
+
+#endif
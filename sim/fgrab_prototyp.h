@@ -0,0 +1,41 @@
+/* Copyright (C) 2011, 2012 Matthias Vogelgesang <matthias.vogelgesang@kit.edu>
+   (Karlsruhe Institute of Technology)
+
+   This library is free software; you can redistribute it and/or modify it
+   under the terms of the GNU Lesser General Public License as published by the
+   Free Software Foundation; either version 2.1 of the License, or (at your
+   option) any later version.
+
+   This library is distributed in the hope that it will be useful, but WITHOUT
+   ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+   FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+   details.
+
+   You should have received a copy of the GNU Lesser General Public License along
+   with this library; if not, write to the Free Software Foundation, Inc., 51
+   Franklin St, Fifth Floor, Boston, MA 02110, USA */
+
+/*
+ * Functions of the simulated frame grabber, see fglib.c.
+ */
+
+#ifndef __FGRAB_PROTOTYP_H
+#define __FGRAB_PROTOTYP_H
+
+#include "fgrab_struct.h"
+
+Fg_Struct *Fg_Init (const char *applet, unsigned int board);
+int Fg_FreeGrabber (Fg_Struct *fg);
+int Fg_setParameter (Fg_Struct *fg, int parameter, const void *value, unsigned int port);
+int Fg_getParameter (Fg_Struct *fg, int parameter, void *value, unsigned int port);
+dma_mem *Fg_AllocMemEx (Fg_Struct *fg, size_t size, frameindex_t num_buffers);
+int Fg_FreeMemEx (Fg_Struct *fg, dma_mem *mem);
+int Fg_AcquireEx (Fg_Struct *fg, unsigned int port, frameindex_t num_frames, int flags, dma_mem *mem);
+int Fg_stopAcquireEx (Fg_Struct *fg, unsigned int port, dma_mem *mem, int flags);
+frameindex_t Fg_getLastPicNumberBlockingEx (Fg_Struct *fg, frameindex_t number, unsigned int port, int timeout, dma_mem *mem);
+frameindex_t Fg_getLastPicNumberEx (Fg_Struct *fg, unsigned int port, dma_mem *mem);
+void *Fg_getImagePtrEx (Fg_Struct *fg, frameindex_t number, unsigned int port, dma_mem *mem);
+int Fg_getLastErrorNumber (Fg_Struct *fg);
+const char *Fg_getLastErrorDescription (Fg_Struct *fg);
+
+#endif
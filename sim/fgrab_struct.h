@@ -0,0 +1,36 @@
+/* Copyright (C) 2011, 2012 Matthias Vogelgesang <matthias.vogelgesang@kit.edu>
+   (Karlsruhe Institute of Technology)
+
+   This library is free software; you can redistribute it and/or modify it
+   under the terms of the GNU Lesser General Public License as published by the
+   Free Software Foundation; either version 2.1 of the License, or (at your
+   option) any later version.
+
+   This library is distributed in the hope that it will be useful, but WITHOUT
+   ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+   FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+   details.
+
+   You should have received a copy of the GNU Lesser General Public License along
+   with this library; if not, write to the Free Software Foundation, Inc., 51
+   Franklin St, Fifth Floor, Boston, MA 02110, USA */
+
+/*
+ * Data types of the simulated frame grabber. Only the part of the
+ * SiliconSoftware runtime used by libpco is provided.
+ */
+
+#ifndef __FGRAB_STRUCT_H
+#define __FGRAB_STRUCT_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "fgrab_define.h"
+
+typedef int64_t frameindex_t;
+
+typedef struct Fg_Struct_s Fg_Struct;
+typedef struct dma_mem_s dma_mem;
+
+#endif
@@ -0,0 +1,52 @@
+/* Copyright (C) 2011, 2012 Matthias Vogelgesang <matthias.vogelgesang@kit.edu>
+   (Karlsruhe Institute of Technology)
+
+   This library is free software; you can redistribute it and/or modify it
+   under the terms of the GNU Lesser General Public License as published by the
+   Free Software Foundation; either version 2.1 of the License, or (at your
+   option) any later version.
+
+   This library is distributed in the hope that it will be useful, but WITHOUT
+   ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+   FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+   details.
+
+   You should have received a copy of the GNU Lesser General Public License along
+   with this library; if not, write to the Free Software Foundation, Inc., 51
+   Franklin St, Fifth Floor, Boston, MA 02110, USA */
+
+#ifndef __PCO_SIM_H
+#define __PCO_SIM_H
+
+#include <stdint.h>
+
+/*
+ * Setup shared by the simulated camera and frame grabber, read from the
+ * environment:
+ *
+ *  PCO_SIM_FORMAT  5x16 (default) or 5x12 for a pco.edge, gray16 for a
+ *                  pco.4000 delivering 16 bit pixels in display order
+ *  PCO_SIM_WIDTH   sensor width, 2560 by default
+ *  PCO_SIM_HEIGHT  sensor height, 2160 by default
+ *  PCO_SIM_FPS     frame rate, 100 by default
+ *  PCO_SIM_JITTER  maximum delay of a frame in microseconds, 0 by default
+ *  PCO_SIM_DROP    percentage of frames lost before the grabber, 0 by default
+ */
+typedef enum {
+    PCO_SIM_FORMAT_5X16,
+    PCO_SIM_FORMAT_5X12,
+    PCO_SIM_FORMAT_GRAY16
+} pco_sim_format;
+
+typedef struct {
+    pco_sim_format format;
+    uint32_t width;
+    uint32_t height;
+    double fps;
+    uint32_t jitter;
+    double drop_rate;
+} pco_sim_config;
+
+void pco_sim_get_config (pco_sim_config *config);
+
+#endif
@@ -0,0 +1,1332 @@
+/* Copyright (C) 2011, 2012 Matthias Vogelgesang <matthias.vogelgesang@kit.edu>
+   (Karlsruhe Institute of Technology)
+
+   This library is free software; you can redistribute it and/or modify it
+   under the terms of the GNU Lesser General Public License as published by the
+   Free Software Foundation; either version 2.1 of the License, or (at your
+   option) any later version.
+
+   This library is distributed in the hope that it will be useful, but WITHOUT
+   ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+   FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+   details.
+
+   You should have received a copy of the GNU Lesser General Public License along
+   with this library; if not, write to the Free Software Foundation, Inc., 51
+   Franklin St, Fifth Floor, Boston, MA 02110, USA */
+
+/*
+ * Continuous acquisition through a Silicon Software frame grabber. The
+ * grabber writes frames into a ring of DMA buffers and the acquisition runs
+ * as a pipeline of threads connected by lock-free queues:
+ *
+ * - the grab thread waits for the grabber and queues the numbers of new DMA
+ *   frames,
+ * - decode threads re-order those frames into a pool of frame buffers and
+ *   queue the buffers,
+ * - the consumer takes decoded buffers, either in a thread passing them to a
+ *   writer and the frame callback or with pco_acquisition_get_frame().
+ *
+ * Buffers are placed on the NUMA node of the frame grabber and the grab and
+ * decode threads run on its CPUs, see placement.c.
+ *
+ * Frames are moved between the stages in batches. The consumer receives a
+ * buffer as a reference-counted #pco_frame, which returns the buffer to the
+ * pool when the last reference is released. Several consumers can thus share
+ * a frame without copying it.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "fgrab_struct.h"
+#include "fgrab_prototyp.h"
+
+#include "libpco.h"
+#include "queue.h"
+#include "pool.h"
+#include "placement.h"
+
+#define FRAME_BATCH_SIZE    8
+#define CACHE_LINE_SIZE     64
+#define MAX_DECODE_THREADS  16
+
+#define COUNT(counter, n) __atomic_fetch_add (&(counter), (n), __ATOMIC_RELAXED)
+
+typedef struct {
+    int camera_type;
+    const char *applet;
+    int cl_type;
+    int cl_format;
+} pco_grabber_config;
+
+static const pco_grabber_config pco_grabber_configs[] = {
+    { CAMERATYPE_PCO_EDGE,       "libFullAreaGray8.so",  FG_CL_8BIT_FULL_10,        FG_GRAY },
+    { CAMERATYPE_PCO4000,        "libDualAreaGray16.so", FG_CL_SINGLETAP_16_BIT,    FG_GRAY16 },
+    { CAMERATYPE_PCO_DIMAX_STD,  "libDualAreaGray16.so", FG_CL_SINGLETAP_16_BIT,    FG_GRAY16 },
+    { 0, NULL, 0, 0 }
+};
+
+/*
+ * Frames are kept in an array aligned to a cache line. The padding makes a
+ * frame exactly one cache line large, which keeps the reference counts of
+ * neighbouring frames aligned and on separate cache lines.
+ */
+struct pco_frame_t {
+    uint64_t number;
+    uint32_t refcount;
+    uint32_t index;
+    pco_acquisition acq;
+    uint16_t *data;
+    pco_timestamp timestamp;
+    bool has_timestamp;
+    uint8_t padding[15];
+};
+
+struct pco_acquisition_t {
+    /* Updated by several threads, kept first to be naturally aligned */
+    uint64_t num_frames;
+    uint64_t num_dropped;
+    uint64_t num_discarded;
+    uint64_t first_dropped;
+    uint64_t last_dropped;
+    uint64_t num_recent;
+    uint64_t recent[PCO_DROP_HISTORY];
+
+    pco_handle pco;
+    Fg_Struct *fg;
+    dma_mem *mem;
+    int port;
+    int num_buffers;
+    int timeout;
+
+    uint32_t width;
+    uint32_t height;
+    size_t frame_size;
+
+    /* Bytes of pixel data per frame, less than frame_size for raw 5x12 */
+    size_t data_size;
+
+    /**
+     * Re-order function for the pco.edge, NULL for cameras that deliver
+     * frames in display order.
+     */
+    pco_reorder_image_t reorder;
+
+    /* Keep frames as transferred and leave re-ordering to the reader */
+    bool raw;
+    pco_frame_format format;
+
+    pco_frame_func func;
+    void *user_data;
+    pco_writer writer;
+
+    pco_drop_policy policy;
+    int decimation;
+
+    /* Shift of the BCD digits of time stamps, -1 if time stamps are off */
+    int timestamp_shift;
+
+    int num_decode_threads;
+    int pool_size;
+    struct pco_frame_t *pool;
+    pco_pool pool_memory;
+
+    pco_queue *grabbed;     /* DMA frame numbers waiting to be decoded */
+    pco_queue *decoded;     /* pool indices waiting for the consumer */
+    pco_queue *unused;      /* pool indices free for decoding */
+
+    /* NUMA node of the buffers, -1 if unknown, and the CPUs of the node */
+    int numa_node;
+    cpu_set_t cpus;
+    bool pinned;
+
+    pthread_t threads[MAX_DECODE_THREADS + 2];
+    int num_threads;
+    bool running;
+    bool stop;
+};
+
+#define FG_ERROR (PCO_ERROR_DRIVER_IOFAILURE | PCO_ERROR_DRIVER_CAMERALINK)
+
+#define CHECK_FG(fg, code) \
+    if ((code) != FG_OK) { \
+        fprintf (stderr, "fg-error: %i at <%s:%i>\n", Fg_getLastErrorNumber (fg), __FILE__, __LINE__); \
+        return FG_ERROR; \
+    }
+
+static const pco_grabber_config *
+find_grabber_config (pco_handle pco)
+{
+    uint16_t type, subtype;
+
+    if (pco_get_camera_type (pco, &type, &subtype) != PCO_NOERROR)
+        return NULL;
+
+    for (const pco_grabber_config *config = pco_grabber_configs; config->applet != NULL; config++) {
+        if (config->camera_type == type)
+            return config;
+    }
+
+    return NULL;
+}
+
+/**
+ * Get the frame grabber setup that suits the camera.
+ *
+ * @param pco A #pco_handle
+ * @param applet Location for the file name of the applet to load with
+ * Fg_Init()
+ * @param cl_type Location for the value of FG_CAMERA_LINK_CAMTYP
+ * @param cl_format Location for the value of FG_FORMAT
+ * @return Error code or PCO_NOERROR. PCO_ERROR_SDKDLL_NOTAVAILABLE is returned
+ * for cameras that are not supported.
+ * @since 1.1
+ */
+unsigned int
+pco_get_grabber_config (pco_handle pco, const char **applet, int *cl_type, int *cl_format)
+{
+    const pco_grabber_config *config = find_grabber_config (pco);
+
+    if (config == NULL)
+        return PCO_ERROR_SDKDLL_NOTAVAILABLE;
+
+    *applet = config->applet;
+    *cl_type = config->cl_type;
+    *cl_format = config->cl_format;
+    return PCO_NOERROR;
+}
+
+static unsigned int
+setup_grabber (pco_acquisition acq, const pco_grabber_config *config)
+{
+    /* The pco.edge transfers 16 bit pixels as pairs of 8 bit pixels */
+    uint32_t fg_width = acq->reorder != NULL ? acq->width * 2 : acq->width;
+    uint32_t height = acq->height;
+    int val = FREE_RUN;
+
+    acq->fg = Fg_Init (config->applet, 0);
+
+    if (acq->fg == NULL) {
+        fprintf (stderr, "Could not initialize frame grabber with %s\n", config->applet);
+        return FG_ERROR;
+    }
+
+    CHECK_FG (acq->fg, Fg_setParameter (acq->fg, FG_CAMERA_LINK_CAMTYP, &config->cl_type, acq->port));
+    CHECK_FG (acq->fg, Fg_setParameter (acq->fg, FG_FORMAT, &config->cl_format, acq->port));
+    CHECK_FG (acq->fg, Fg_setParameter (acq->fg, FG_TRIGGERMODE, &val, acq->port));
+    CHECK_FG (acq->fg, Fg_setParameter (acq->fg, FG_WIDTH, &fg_width, acq->port));
+    CHECK_FG (acq->fg, Fg_setParameter (acq->fg, FG_HEIGHT, &height, acq->port));
+    return PCO_NOERROR;
+}
+
+static void
+set_numa_node (pco_acquisition acq, int node)
+{
+    acq->numa_node = node;
+    acq->pinned = pco_placement_get_node_cpus (node, &acq->cpus);
+}
+
+static unsigned int
+alloc_dma_buffers (pco_acquisition acq)
+{
+    pco_placement_policy policy;
+
+    pco_placement_prefer_node (acq->numa_node, &policy);
+    acq->mem = Fg_AllocMemEx (acq->fg, acq->num_buffers * acq->frame_size, acq->num_buffers);
+    pco_placement_restore (&policy);
+
+    if (acq->mem == NULL) {
+        fprintf (stderr, "Could not allocate %i DMA buffers\n", acq->num_buffers);
+        return PCO_ERROR_NOMEMORY;
+    }
+
+    return PCO_NOERROR;
+}
+
+static void
+free_pipeline (pco_acquisition acq)
+{
+    pco_queue_free (acq->grabbed);
+    pco_queue_free (acq->decoded);
+    pco_queue_free (acq->unused);
+    pco_pool_free (&acq->pool_memory);
+    free (acq->pool);
+
+    acq->grabbed = acq->decoded = acq->unused = NULL;
+    acq->pool = NULL;
+}
+
+/*
+ * Decoded frames are written into huge pages when available, see pool.c.
+ * Queues shared by several decode threads must allow concurrent access. The
+ * unused buffers are always shared, as they are returned by whichever thread
+ * releases the last reference to a frame.
+ */
+static unsigned int
+alloc_pipeline (pco_acquisition acq)
+{
+    bool concurrent = acq->num_decode_threads > 1;
+    size_t pool_bytes = acq->pool_size * sizeof(struct pco_frame_t);
+    pco_placement_policy policy;
+    void *pool;
+    bool success;
+
+    pco_placement_prefer_node (acq->numa_node, &policy);
+    acq->grabbed = pco_queue_new (acq->num_buffers, concurrent);
+    /* Decode threads take frames back from the consumer to drop the oldest */
+    acq->decoded = pco_queue_new (acq->pool_size, concurrent || acq->policy == PCO_DROP_OLDEST);
+    acq->unused = pco_queue_new (acq->pool_size, true);
+
+    if (posix_memalign (&pool, CACHE_LINE_SIZE, pool_bytes) == 0) {
+        memset (pool, 0, pool_bytes);
+        acq->pool = (struct pco_frame_t *) pool;
+    }
+
+    success = acq->grabbed != NULL && acq->decoded != NULL && acq->unused != NULL && acq->pool != NULL &&
+              pco_pool_init (&acq->pool_memory, acq->frame_size, acq->pool_size);
+    pco_placement_restore (&policy);
+
+    if (!success) {
+        free_pipeline (acq);
+        return PCO_ERROR_NOMEMORY;
+    }
+
+    for (int i = 0; i < acq->pool_size; i++) {
+        acq->pool[i].index = i;
+        acq->pool[i].acq = acq;
+        acq->pool[i].data = (uint16_t *) pco_pool_get_slot (&acq->pool_memory, i);
+        pco_queue_push (acq->unused, (uint64_t) i);
+    }
+
+    return PCO_NOERROR;
+}
+
+/*
+ * The pool outlives pco_acquisition_stop() because frames may still be leased.
+ * It can only be replaced when all frames have been released.
+ */
+static bool
+is_leased (pco_acquisition acq)
+{
+    for (int i = 0; acq->pool != NULL && i < acq->pool_size; i++) {
+        if (__atomic_load_n (&acq->pool[i].refcount, __ATOMIC_ACQUIRE) > 0)
+            return true;
+    }
+
+    return false;
+}
+
+/**
+ * Create an acquisition for a camera. The frame grabber is set up for the
+ * camera type with a ring of #num_buffers DMA buffers, which must hold the
+ * frames that arrive while the consumer is busy. The frame size is taken
+ * from the current ROI, so it must be set before.
+ *
+ * @param pco A #pco_handle
+ * @param num_buffers Number of DMA buffers, at least 2
+ * @return A new #pco_acquisition or NULL on error
+ * @since 1.1
+ */
+pco_acquisition
+pco_acquisition_init (pco_handle pco, int num_buffers)
+{
+    const pco_grabber_config *config;
+    pco_acquisition acq;
+    uint16_t type, subtype;
+    uint32_t width, height;
+
+    if (num_buffers < 2)
+        return NULL;
+
+    config = find_grabber_config (pco);
+
+    if (config == NULL) {
+        fprintf (stderr, "No frame grabber setup for this camera type\n");
+        return NULL;
+    }
+
+    acq = (pco_acquisition) calloc (1, sizeof(struct pco_acquisition_t));
+
+    if (acq == NULL)
+        return NULL;
+
+    acq->pco = pco;
+    acq->port = PORT_A;
+    acq->num_buffers = num_buffers;
+    acq->timeout = 10;
+    acq->timestamp_shift = -1;
+    acq->num_decode_threads = 1;
+    acq->pool_size = 4;
+    acq->policy = PCO_DROP_BLOCK;
+    acq->decimation = 1;
+
+    if (pco_get_actual_size (pco, &width, &height) != PCO_NOERROR ||
+        pco_get_camera_type (pco, &type, &subtype) != PCO_NOERROR)
+        goto no_acquisition;
+
+    acq->width = width;
+    acq->height = height;
+    acq->frame_size = (size_t) acq->width * acq->height * sizeof(uint16_t);
+
+    if (type == CAMERATYPE_PCO_EDGE)
+        acq->reorder = pco_get_reorder_func (pco);
+
+    set_numa_node (acq, pco_placement_find_grabber_node (0));
+
+    if (setup_grabber (acq, config) != PCO_NOERROR || alloc_dma_buffers (acq) != PCO_NOERROR)
+        goto no_acquisition;
+
+    return acq;
+
+no_acquisition:
+    pco_acquisition_destroy (acq);
+    return NULL;
+}
+
+/**
+ * Stop and release an acquisition.
+ *
+ * @param acq A #pco_acquisition
+ * @since 1.1
+ */
+void
+pco_acquisition_destroy (pco_acquisition acq)
+{
+    if (acq == NULL)
+        return;
+
+    pco_acquisition_stop (acq);
+    free_pipeline (acq);
+
+    if (acq->mem != NULL)
+        Fg_FreeMemEx (acq->fg, acq->mem);
+
+    if (acq->fg != NULL)
+        Fg_FreeGrabber (acq->fg);
+
+    free (acq);
+}
+
+/**
+ * Get the size of the frames delivered by an acquisition.
+ *
+ * @param acq A #pco_acquisition
+ * @param width Location for the width in pixels
+ * @param height Location for the height in pixels
+ * @return Error code or PCO_NOERROR.
+ * @since 1.1
+ */
+unsigned int
+pco_acquisition_get_size (pco_acquisition acq, uint32_t *width, uint32_t *height)
+{
+    *width = acq->width;
+    *height = acq->height;
+    return PCO_NOERROR;
+}
+
+/**
+ * Set a function that is called for each frame. The function is called from a
+ * thread of the acquisition while it is running. Frames can then not be
+ * pulled with pco_acquisition_get_frame() or pco_acquisition_grab().
+ *
+ * @param acq A #pco_acquisition
+ * @param func Function called with each re-ordered frame or NULL to pull frames
+ * @param user_data Data passed to #func
+ * @return Error code or PCO_NOERROR.
+ * @since 1.1
+ */
+unsigned int
+pco_acquisition_set_callback (pco_acquisition acq, pco_frame_func func, void *user_data)
+{
+    if (acq->running)
+        return PCO_ERROR_WRONGVALUE;
+
+    acq->func = func;
+    acq->user_data = user_data;
+    return PCO_NOERROR;
+}
+
+/**
+ * Pass each frame to a writer. Like a callback, this hands frames to a thread
+ * of the acquisition and frames can then not be pulled. The writer is called
+ * before the callback and must outlive the acquisition run. The camera is
+ * described to the writer for the headers of its recordings.
+ *
+ * @param acq A #pco_acquisition
+ * @param writer A #pco_writer or NULL to stop writing
+ * @return Error code or PCO_NOERROR.
+ * @since 1.1
+ */
+unsigned int
+pco_acquisition_set_writer (pco_acquisition acq, pco_writer writer)
+{
+    if (acq->running)
+        return PCO_ERROR_WRONGVALUE;
+
+    if (writer != NULL) {
+        pco_recording_info info;
+        uint16_t type = 0, subtype = 0, version[4];
+        uint32_t serial_number = 0;
+        char *name;
+
+        pco_get_camera_type (acq->pco, &type, &subtype);
+        pco_get_camera_version (acq->pco, &serial_number, &version[0], &version[1], &version[2], &version[3]);
+
+        memset (&info, 0, sizeof(info));
+        info.camera_type = type;
+        info.camera_subtype = subtype;
+        info.serial_number = serial_number;
+        info.bit_depth = (uint16_t) pco_get_dynamic_resolution (acq->pco);
+
+        if (pco_get_name (acq->pco, &name) == PCO_NOERROR && name != NULL) {
+            strncpy (info.name, name, sizeof(info.name) - 1);
+            free (name);
+        }
+
+        pco_writer_set_info (writer, &info);
+    }
+
+    acq->writer = writer;
+    return PCO_NOERROR;
+}
+
+/**
+ * Set how long to wait for a frame.
+ *
+ * @param acq A #pco_acquisition
+ * @param seconds Timeout in seconds
+ * @return Error code or PCO_NOERROR.
+ * @since 1.1
+ */
+unsigned int
+pco_acquisition_set_timeout (pco_acquisition acq, int seconds)
+{
+    if (seconds < 1)
+        return PCO_ERROR_WRONGVALUE;
+
+    acq->timeout = seconds;
+    return PCO_NOERROR;
+}
+
+/**
+ * Deliver pco.edge frames as transferred by the camera instead of re-ordering
+ * them. Frames then have the format #PCO_FRAME_FORMAT_EDGE_5X12 or
+ * #PCO_FRAME_FORMAT_EDGE_5X16, which saves the re-ordering on the acquiring
+ * machine when frames are only recorded and are decoded when read, see
+ * pco_reader_decode_frame(). Other cameras are not affected.
+ *
+ * @param acq A #pco_acquisition
+ * @param raw TRUE to deliver raw frames
+ * @return Error code or PCO_NOERROR.
+ * @since 1.1
+ */
+unsigned int
+pco_acquisition_set_raw (pco_acquisition acq, bool raw)
+{
+    if (acq->running)
+        return PCO_ERROR_WRONGVALUE;
+
+    acq->raw = raw;
+    return PCO_NOERROR;
+}
+
+/**
+ * Set up the decode stage. Several decode threads help when a single core
+ * cannot re-order frames at the frame rate, but frames may then be delivered
+ * out of order. Each decode thread needs at least one frame buffer of its
+ * own, the remaining buffers hold decoded frames while the consumer is busy
+ * or leases them. This fails while frames of a previous run are still leased.
+ *
+ * @param acq A #pco_acquisition
+ * @param num_threads Number of decode threads, 1 by default
+ * @param num_frames Number of decoded frame buffers, 4 by default
+ * @return Error code or PCO_NOERROR.
+ * @since 1.1
+ */
+unsigned int
+pco_acquisition_set_decoding (pco_acquisition acq, int num_threads, int num_frames)
+{
+    if (acq->running || num_threads < 1 || num_threads > MAX_DECODE_THREADS || num_frames <= num_threads)
+        return PCO_ERROR_WRONGVALUE;
+
+    if (is_leased (acq))
+        return PCO_ERROR_WRONGVALUE;
+
+    free_pipeline (acq);
+    acq->num_decode_threads = num_threads;
+    acq->pool_size = num_frames;
+    return PCO_NOERROR;
+}
+
+/**
+ * Set how the acquisition sheds load when frames arrive faster than they are
+ * decoded or consumed. The frame grabber cannot be paused, so frames that are
+ * not taken from the DMA ring in time are lost with any policy:
+ *
+ * - #PCO_DROP_BLOCK lets decode threads wait for free frame buffers. Frames
+ *   back up into the DMA ring, which adds latency and overflows under
+ *   sustained load. This is the default.
+ * - #PCO_DROP_NEWEST drops arriving frames while all frame buffers hold
+ *   frames for the consumer, which keeps the latency bounded by the number
+ *   of frame buffers.
+ * - #PCO_DROP_OLDEST replaces the oldest frame the consumer has not taken yet
+ *   with the arriving one, so that the consumer always gets the latest frames.
+ * - #PCO_DROP_DECIMATE drops frames like #PCO_DROP_NEWEST but waits for
+ *   frames whose number is a multiple of #decimation, so that every Nth frame
+ *   still gets through.
+ *
+ * Dropped frames are counted by pco_acquisition_get_counters() and described
+ * by pco_acquisition_get_drop_stats(). This fails while frames of a previous
+ * run are still leased.
+ *
+ * @param acq A #pco_acquisition
+ * @param policy A #pco_drop_policy
+ * @param decimation Frames passed by #PCO_DROP_DECIMATE, at least 2. Ignored
+ * by other policies.
+ * @return Error code or PCO_NOERROR.
+ * @since 1.1
+ */
+unsigned int
+pco_acquisition_set_drop_policy (pco_acquisition acq, pco_drop_policy policy, int decimation)
+{
+    if (acq->running || policy < PCO_DROP_BLOCK || policy > PCO_DROP_DECIMATE)
+        return PCO_ERROR_WRONGVALUE;
+
+    if ((policy == PCO_DROP_DECIMATE && decimation < 2) || is_leased (acq))
+        return PCO_ERROR_WRONGVALUE;
+
+    free_pipeline (acq);
+    acq->policy = policy;
+    acq->decimation = policy == PCO_DROP_DECIMATE ? decimation : 1;
+    return PCO_NOERROR;
+}
+
+/**
+ * Place the buffers of an acquisition on a NUMA node and run the grab and
+ * decode threads on its CPUs. By default the node of the frame grabber is
+ * used. This re-allocates the DMA buffers and fails while frames of a previous
+ * run are still leased.
+ *
+ * @param acq A #pco_acquisition
+ * @param node NUMA node or -1 to use the node of the frame grabber
+ * @return Error code or PCO_NOERROR. PCO_ERROR_WRONGVALUE is returned if the
+ * node does not exist.
+ * @since 1.1
+ */
+unsigned int
+pco_acquisition_set_numa_node (pco_acquisition acq, int node)
+{
+    cpu_set_t cpus;
+
+    if (acq->running || is_leased (acq))
+        return PCO_ERROR_WRONGVALUE;
+
+    if (node >= 0 && !pco_placement_get_node_cpus (node, &cpus))
+        return PCO_ERROR_WRONGVALUE;
+
+    free_pipeline (acq);
+
+    if (acq->mem != NULL)
+        Fg_FreeMemEx (acq->fg, acq->mem);
+
+    acq->mem = NULL;
+    set_numa_node (acq, node >= 0 ? node : pco_placement_find_grabber_node (0));
+    return alloc_dma_buffers (acq);
+}
+
+/**
+ * Get where the buffers and threads of an acquisition are placed.
+ *
+ * @param acq A #pco_acquisition
+ * @param node Location for the NUMA node of the buffers, -1 if the node of
+ * the frame grabber is unknown and the buffers are placed by the system
+ * @param pinned Location for whether the grab and decode threads are pinned
+ * to the CPUs of #node
+ * @return Error code or PCO_NOERROR.
+ * @since 1.1
+ */
+unsigned int
+pco_acquisition_get_placement (pco_acquisition acq, int *node, bool *pinned)
+{
+    *node = acq->numa_node;
+    *pinned = acq->pinned;
+    return PCO_NOERROR;
+}
+
+static bool
+is_stopped (pco_acquisition acq)
+{
+    return __atomic_load_n (&acq->stop, __ATOMIC_ACQUIRE);
+}
+
+/*
+ * The grabber may be writing into the buffer that follows the last frame,
+ * which is the buffer of the frame num_buffers - 1 before it.
+ */
+static bool
+is_overwritten (pco_acquisition acq, frameindex_t number)
+{
+    frameindex_t last = Fg_getLastPicNumberEx (acq->fg, acq->port, acq->mem);
+
+    return last - number >= acq->num_buffers - 1;
+}
+
+/*
+ * Drops of consecutive frames are recorded by several threads. The history is
+ * a ring indexed by the running number of dropped frames.
+ */
+static void
+record_drops (pco_acquisition acq, frameindex_t first, frameindex_t n, bool discarded)
+{
+    uint64_t expected = 0;
+
+    COUNT (acq->num_dropped, n);
+
+    if (discarded)
+        COUNT (acq->num_discarded, n);
+
+    __atomic_compare_exchange_n (&acq->first_dropped, &expected, (uint64_t) first, false,
+                                 __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+    __atomic_store_n (&acq->last_dropped, (uint64_t) (first + n - 1), __ATOMIC_RELAXED);
+
+    for (frameindex_t number = n > PCO_DROP_HISTORY ? first + n - PCO_DROP_HISTORY : first; number < first + n; number++) {
+        uint64_t position = COUNT (acq->num_recent, 1);
+
+        __atomic_store_n (&acq->recent[position % PCO_DROP_HISTORY], (uint64_t) number, __ATOMIC_RELAXED);
+    }
+}
+
+static void *
+grab_frames (void *data)
+{
+    pco_acquisition acq = (pco_acquisition) data;
+    frameindex_t next = 1;
+
+    while (!is_stopped (acq)) {
+        frameindex_t last;
+
+        last = Fg_getLastPicNumberBlockingEx (acq->fg, next, acq->port, acq->timeout, acq->mem);
+
+        if (last < 0)
+            continue;
+
+        /* Skip what the grabber has overwritten already */
+        if (last - next >= acq->num_buffers - 1) {
+            frameindex_t oldest = last - acq->num_buffers + 2;
+
+            record_drops (acq, next, oldest - next, false);
+            next = oldest;
+        }
+
+        for (; next <= last; next++) {
+            if (!pco_queue_push (acq->grabbed, (uint64_t) next))
+                record_drops (acq, next, 1, false);
+        }
+    }
+
+    return NULL;
+}
+
+static bool
+parse_timestamp (pco_acquisition acq, pco_frame frame)
+{
+    if (acq->timestamp_shift < 0)
+        return false;
+
+    /* Raw 5x16 frames start with the top row like decoded ones */
+    if (acq->format == PCO_FRAME_FORMAT_EDGE_5X12)
+        return pco_parse_timestamp_5x12 (frame->data, acq->timestamp_shift, &frame->timestamp) == PCO_NOERROR;
+
+    return pco_parse_timestamp (frame->data, acq->timestamp_shift, &frame->timestamp) == PCO_NOERROR;
+}
+
+/*
+ * Get a free frame buffer for a frame, or none if the drop policy discards it.
+ */
+static bool
+take_buffer (pco_acquisition acq, frameindex_t number, uint64_t *index)
+{
+    while (pco_queue_pop (acq->unused, index, 1) == 0) {
+        if (is_stopped (acq))
+            return false;
+
+        if (acq->policy == PCO_DROP_NEWEST ||
+            (acq->policy == PCO_DROP_DECIMATE && number % acq->decimation != 0)) {
+            record_drops (acq, number, 1, true);
+            return false;
+        }
+
+        /* Buffers leased by the consumer cannot be taken back */
+        if (acq->policy == PCO_DROP_OLDEST && pco_queue_pop (acq->decoded, index, 1) == 1) {
+            __atomic_fetch_sub (&acq->num_frames, 1, __ATOMIC_RELAXED);
+            record_drops (acq, (frameindex_t) acq->pool[*index].number, 1, true);
+            return true;
+        }
+
+        /* Sleep until a buffer is released or the acquisition stops */
+        if (pco_queue_pop_wait (acq->unused, index, 1, -1) == 1)
+            return true;
+    }
+
+    return true;
+}
+
+static void
+decode_frame (pco_acquisition acq, frameindex_t number)
+{
+    pco_frame frame;
+    uint16_t *raw;
+    uint64_t index;
+
+    if (!take_buffer (acq, number, &index))
+        return;
+
+    frame = &acq->pool[index];
+
+    if (!is_overwritten (acq, number)) {
+        raw = (uint16_t *) Fg_getImagePtrEx (acq->fg, number, acq->port, acq->mem);
+
+        if (raw != NULL) {
+            if (acq->reorder != NULL && !acq->raw)
+                acq->reorder (frame->data, raw, acq->width, acq->height);
+            else
+                memcpy (frame->data, raw, acq->data_size);
+
+            /* The grabber may have caught up while decoding */
+            if (!is_overwritten (acq, number)) {
+                frame->number = (uint64_t) number;
+                frame->has_timestamp = parse_timestamp (acq, frame);
+                pco_queue_push (acq->decoded, index);
+                COUNT (acq->num_frames, 1);
+                return;
+            }
+        }
+    }
+
+    record_drops (acq, number, 1, false);
+    pco_queue_push (acq->unused, index);
+}
+
+static void *
+decode_frames (void *data)
+{
+    pco_acquisition acq = (pco_acquisition) data;
+    uint64_t numbers[FRAME_BATCH_SIZE];
+
+    while (!is_stopped (acq)) {
+        uint32_t n = pco_queue_pop_wait (acq->grabbed, numbers, FRAME_BATCH_SIZE, -1);
+
+        for (uint32_t i = 0; i < n; i++)
+            decode_frame (acq, (frameindex_t) numbers[i]);
+    }
+
+    return NULL;
+}
+
+static void *
+consume_frames (void *data)
+{
+    pco_acquisition acq = (pco_acquisition) data;
+    uint64_t indices[FRAME_BATCH_SIZE];
+
+    while (!is_stopped (acq)) {
+        uint32_t n = pco_queue_pop_wait (acq->decoded, indices, FRAME_BATCH_SIZE, -1);
+
+        for (uint32_t i = 0; i < n; i++) {
+            pco_frame frame = &acq->pool[indices[i]];
+
+            frame->refcount = 1;
+
+            if (acq->writer != NULL)
+                pco_writer_write (acq->writer, frame);
+
+            if (acq->func != NULL)
+                acq->func (frame, acq->user_data);
+
+            pco_frame_unref (frame);
+        }
+    }
+
+    return NULL;
+}
+
+/*
+ * Frames that were grabbed or decoded but not consumed are discarded, their
+ * buffers are returned to the pool.
+ */
+static void
+drain_pipeline (pco_acquisition acq)
+{
+    uint64_t values[FRAME_BATCH_SIZE];
+    uint32_t n;
+
+    while (pco_queue_pop (acq->grabbed, values, FRAME_BATCH_SIZE) > 0)
+        ;
+
+    while ((n = pco_queue_pop (acq->decoded, values, FRAME_BATCH_SIZE)) > 0) {
+        for (uint32_t i = 0; i < n; i++)
+            pco_queue_push (acq->unused, values[i]);
+    }
+}
+
+static pco_frame_format
+find_frame_format (pco_acquisition acq)
+{
+    if (acq->reorder == NULL || !acq->raw)
+        return PCO_FRAME_FORMAT_GRAY16;
+
+    if (acq->reorder == pco_reorder_image_5x12 || acq->reorder == pco_reorder_image_5x12_nt)
+        return PCO_FRAME_FORMAT_EDGE_5X12;
+
+    return PCO_FRAME_FORMAT_EDGE_5X16;
+}
+
+static unsigned int
+find_timestamp_shift (pco_acquisition acq)
+{
+    uint16_t mode;
+    bool msb_aligned;
+    unsigned int err;
+
+    acq->timestamp_shift = -1;
+    err = pco_get_timestamp_mode (acq->pco, &mode);
+
+    if (err != PCO_NOERROR || (mode != TIMESTAMP_MODE_BINARY && mode != TIMESTAMP_MODE_BINARYANDASCII))
+        return err;
+
+    err = pco_get_bit_alignment (acq->pco, &msb_aligned);
+
+    if (err == PCO_NOERROR)
+        acq->timestamp_shift = msb_aligned ? 16 - (int) pco_get_dynamic_resolution (acq->pco) : 0;
+
+    return err;
+}
+
+static bool
+start_thread (pco_acquisition acq, void *(*func) (void *), bool pin)
+{
+    pthread_attr_t attr;
+    pthread_t thread;
+    int err;
+
+    pthread_attr_init (&attr);
+
+    if (pin && acq->pinned)
+        pthread_attr_setaffinity_np (&attr, sizeof(cpu_set_t), &acq->cpus);
+
+    err = pthread_create (&thread, &attr, func, acq);
+    pthread_attr_destroy (&attr);
+
+    if (err != 0)
+        return false;
+
+    acq->threads[acq->num_threads++] = thread;
+    return true;
+}
+
+/**
+ * Start the frame grabber, the camera and the threads of the acquisition. If a
+ * callback or writer is set, frames are delivered to it from now on,
+ * otherwise they must be pulled with pco_acquisition_get_frame().
+ *
+ * @param acq A #pco_acquisition
+ * @return Error code or PCO_NOERROR.
+ * @since 1.1
+ */
+unsigned int
+pco_acquisition_start (pco_acquisition acq)
+{
+    unsigned int err;
+    bool started;
+
+    if (acq->running)
+        return PCO_ERROR_WRONGVALUE;
+
+    if (acq->mem == NULL)
+        return PCO_ERROR_NOMEMORY;
+
+    /* The re-order function depends on the scan mode, which may have changed */
+    if (acq->reorder != NULL)
+        acq->reorder = pco_get_reorder_func (acq->pco);
+
+    acq->format = find_frame_format (acq);
+    acq->data_size = acq->frame_size;
+
+    if (acq->format == PCO_FRAME_FORMAT_EDGE_5X12)
+        acq->data_size = pco_get_raw_pitch_5x12 ((int) acq->width) * acq->height;
+
+    if (acq->pool == NULL) {
+        err = alloc_pipeline (acq);
+
+        if (err != PCO_NOERROR)
+            return err;
+    }
+
+    err = find_timestamp_shift (acq);
+
+    if (err != PCO_NOERROR)
+        return err;
+
+    err = pco_arm_camera (acq->pco);
+
+    if (err != PCO_NOERROR)
+        return err;
+
+    acq->stop = false;
+    acq->num_frames = 0;
+    acq->num_dropped = 0;
+    acq->num_discarded = 0;
+    acq->first_dropped = 0;
+    acq->last_dropped = 0;
+    acq->num_recent = 0;
+    acq->num_threads = 0;
+
+    if (Fg_AcquireEx (acq->fg, acq->port, GRAB_INFINITE, ACQ_STANDARD, acq->mem) != FG_OK) {
+        fprintf (stderr, "fg-error: %i at <%s:%i>\n", Fg_getLastErrorNumber (acq->fg), __FILE__, __LINE__);
+        return FG_ERROR;
+    }
+
+    err = pco_start_recording (acq->pco);
+
+    if (err != PCO_NOERROR) {
+        Fg_stopAcquireEx (acq->fg, acq->port, acq->mem, STOP_ASYNC);
+        return err;
+    }
+
+    pco_queue_set_closed (acq->grabbed, false);
+    pco_queue_set_closed (acq->decoded, false);
+    pco_queue_set_closed (acq->unused, false);
+    acq->running = true;
+    started = start_thread (acq, grab_frames, true);
+
+    for (int i = 0; started && i < acq->num_decode_threads; i++)
+        started = start_thread (acq, decode_frames, true);
+
+    /* The consumer runs user code and is left to the scheduler */
+    if (started && (acq->func != NULL || acq->writer != NULL))
+        started = start_thread (acq, consume_frames, false);
+
+    if (!started) {
+        pco_acquisition_stop (acq);
+        return PCO_ERROR_NOMEMORY;
+    }
+
+    return PCO_NOERROR;
+}
+
+/**
+ * Stop the camera, the frame grabber and the threads of the acquisition. When
+ * this returns, the callback is not called anymore.
+ *
+ * @param acq A #pco_acquisition
+ * @return Error code or PCO_NOERROR.
+ * @since 1.1
+ */
+unsigned int
+pco_acquisition_stop (pco_acquisition acq)
+{
+    unsigned int err;
+
+    if (!acq->running)
+        return PCO_NOERROR;
+
+    __atomic_store_n (&acq->stop, true, __ATOMIC_RELEASE);
+    err = pco_stop_recording (acq->pco);
+
+    /* This also wakes up the grab thread waiting for a frame */
+    Fg_stopAcquireEx (acq->fg, acq->port, acq->mem, STOP_ASYNC);
+
+    /* And this the threads waiting for frames or buffers */
+    pco_queue_set_closed (acq->grabbed, true);
+    pco_queue_set_closed (acq->decoded, true);
+    pco_queue_set_closed (acq->unused, true);
+
+    for (int i = 0; i < acq->num_threads; i++)
+        pthread_join (acq->threads[i], NULL);
+
+    drain_pipeline (acq);
+    acq->num_threads = 0;
+    acq->running = false;
+    return err;
+}
+
+/**
+ * Wait for the next decoded frame and lease it. With a single decode thread,
+ * frames are returned in the order they were acquired. Only one thread may
+ * pull frames.
+ *
+ * @param acq A running #pco_acquisition without callback or writer
+ * @param frame Location for the frame, which must be released with
+ * pco_frame_unref()
+ * @return Error code or PCO_NOERROR. PCO_ERROR_TIMEOUT is returned if no frame
+ * arrived in time.
+ * @since 1.1
+ */
+unsigned int
+pco_acquisition_get_frame (pco_acquisition acq, pco_frame *frame)
+{
+    uint64_t index;
+
+    if (!acq->running || acq->func != NULL || acq->writer != NULL)
+        return PCO_ERROR_WRONGVALUE;
+
+    if (pco_queue_pop_wait (acq->decoded, &index, 1, acq->timeout * 1000) == 0)
+        return PCO_ERROR_TIMEOUT;
+
+    *frame = &acq->pool[index];
+    (*frame)->refcount = 1;
+    return PCO_NOERROR;
+}
+
+/**
+ * Wait for the next decoded frame and copy it into #frame. Use
+ * pco_acquisition_get_frame() to avoid the copy.
+ *
+ * @param acq A running #pco_acquisition without callback
+ * @param frame Memory for width * height 16 bit pixels
+ * @param frame_number Location for the number of the frame or NULL
+ * @return Error code or PCO_NOERROR. PCO_ERROR_TIMEOUT is returned if no frame
+ * arrived in time.
+ * @since 1.1
+ */
+unsigned int
+pco_acquisition_grab (pco_acquisition acq, uint16_t *frame, uint64_t *frame_number)
+{
+    pco_frame leased;
+    unsigned int err;
+
+    err = pco_acquisition_get_frame (acq, &leased);
+
+    if (err != PCO_NOERROR)
+        return err;
+
+    memcpy (frame, leased->data, acq->data_size);
+
+    if (frame_number != NULL)
+        *frame_number = leased->number;
+
+    pco_frame_unref (leased);
+    return PCO_NOERROR;
+}
+
+/**
+ * Get the number of frames decoded so far and the number of frames that were
+ * dropped, either because the grabber overwrote them in the DMA ring or by the
+ * drop policy, see pco_acquisition_set_drop_policy().
+ *
+ * @param acq A #pco_acquisition
+ * @param num_frames Location for the number of frames
+ * @param num_dropped Location for the number of dropped frames
+ * @return Error code or PCO_NOERROR.
+ * @since 1.1
+ */
+unsigned int
+pco_acquisition_get_counters (pco_acquisition acq, uint64_t *num_frames, uint64_t *num_dropped)
+{
+    *num_frames = __atomic_load_n (&acq->num_frames, __ATOMIC_RELAXED);
+    *num_dropped = __atomic_load_n (&acq->num_dropped, __ATOMIC_RELAXED);
+    return PCO_NOERROR;
+}
+
+/**
+ * Get which frames were dropped since the acquisition was started, either
+ * because the grabber overwrote them in the DMA ring or by the drop policy set
+ * with pco_acquisition_set_drop_policy(). Frames that the camera lost before
+ * the grabber are not seen here, their time stamps reveal them, see
+ * pco_track_frame(). While the acquisition is running, the fields are updated
+ * independently and may be slightly out of step.
+ *
+ * @param acq A #pco_acquisition
+ * @param stats Location for the #pco_drop_stats
+ * @return Error code or PCO_NOERROR.
+ * @since 1.1
+ */
+unsigned int
+pco_acquisition_get_drop_stats (pco_acquisition acq, pco_drop_stats *stats)
+{
+    uint64_t num_recent = __atomic_load_n (&acq->num_recent, __ATOMIC_RELAXED);
+    uint64_t num_dropped = __atomic_load_n (&acq->num_dropped, __ATOMIC_RELAXED);
+
+    stats->num_discarded = __atomic_load_n (&acq->num_discarded, __ATOMIC_RELAXED);
+    stats->num_overwritten = num_dropped > stats->num_discarded ? num_dropped - stats->num_discarded : 0;
+    stats->first_dropped = __atomic_load_n (&acq->first_dropped, __ATOMIC_RELAXED);
+    stats->last_dropped = __atomic_load_n (&acq->last_dropped, __ATOMIC_RELAXED);
+    stats->num_recent = num_recent < PCO_DROP_HISTORY ? (uint32_t) num_recent : PCO_DROP_HISTORY;
+    stats->reserved = 0;
+
+    for (uint32_t i = 0; i < stats->num_recent; i++) {
+        uint64_t position = num_recent - stats->num_recent + i;
+
+        stats->recent[i] = __atomic_load_n (&acq->recent[position % PCO_DROP_HISTORY], __ATOMIC_RELAXED);
+    }
+
+    return PCO_NOERROR;
+}
+
+/**
+ * Get the number of frames waiting between the stages of a running
+ * acquisition. A growing number of grabbed frames means that decoding cannot
+ * keep up, a growing number of decoded frames means that the consumer cannot.
+ *
+ * @param acq A #pco_acquisition
+ * @param num_grabbed Location for the number of frames waiting to be decoded
+ * @param num_decoded Location for the number of frames waiting for the
+ * consumer
+ * @return Error code or PCO_NOERROR.
+ * @since 1.1
+ */
+unsigned int
+pco_acquisition_get_queue_depths (pco_acquisition acq, uint32_t *num_grabbed, uint32_t *num_decoded)
+{
+    if (!acq->running) {
+        *num_grabbed = *num_decoded = 0;
+        return PCO_NOERROR;
+    }
+
+    *num_grabbed = pco_queue_get_depth (acq->grabbed);
+    *num_decoded = pco_queue_get_depth (acq->decoded);
+    return PCO_NOERROR;
+}
+
+/**
+ * Get how the decoded frame buffers of an acquisition are backed. They are
+ * allocated when the acquisition is started for the first time.
+ *
+ * @param acq A #pco_acquisition
+ * @param page_size Location for the size of the pages backing the buffers,
+ * e.g. 2 MB if huge pages are used, 0 if not allocated yet
+ * @param locked Location for whether the buffers are locked into memory
+ * @return Error code or PCO_NOERROR.
+ * @since 1.1
+ */
+unsigned int
+pco_acquisition_get_buffer_info (pco_acquisition acq, size_t *page_size, bool *locked)
+{
+    *page_size = acq->pool_memory.page_size;
+    *locked = acq->pool_memory.locked;
+    return PCO_NOERROR;
+}
+
+/**
+ * Take another reference to a frame, e.g. to keep a frame passed to a
+ * #pco_frame_func or to share it with another thread.
+ *
+ * @param frame A #pco_frame
+ * @return #frame
+ * @since 1.1
+ */
+pco_frame
+pco_frame_ref (pco_frame frame)
+{
+    __atomic_fetch_add (&frame->refcount, 1, __ATOMIC_RELAXED);
+    return frame;
+}
+
+/**
+ * Release a reference to a frame. The frame buffer is returned to the
+ * acquisition when the last reference is released.
+ *
+ * @param frame A #pco_frame
+ * @since 1.1
+ */
+void
+pco_frame_unref (pco_frame frame)
+{
+    if (__atomic_sub_fetch (&frame->refcount, 1, __ATOMIC_ACQ_REL) == 0)
+        pco_queue_push (frame->acq->unused, frame->index);
+}
+
+/**
+ * Get the pixels of a frame. They stay valid as long as a reference is held.
+ *
+ * @param frame A #pco_frame
+ * @return Pointer to the first pixel.
+ * @since 1.1
+ */
+const uint16_t *
+pco_frame_get_data (pco_frame frame)
+{
+    return frame->data;
+}
+
+/**
+ * Get the size of a frame.
+ *
+ * @param frame A #pco_frame
+ * @param width Location for the width in pixels
+ * @param height Location for the height in pixels
+ * @return Error code or PCO_NOERROR.
+ * @since 1.1
+ */
+unsigned int
+pco_frame_get_size (pco_frame frame, uint32_t *width, uint32_t *height)
+{
+    *width = frame->acq->width;
+    *height = frame->acq->height;
+    return PCO_NOERROR;
+}
+
+/**
+ * Get the number of bytes of pixel data of a frame. This is width * height 16
+ * bit pixels except for raw 5x12 frames, which are packed.
+ *
+ * @param frame A #pco_frame
+ * @return Size of the data returned by pco_frame_get_data() in bytes.
+ * @since 1.1
+ */
+size_t
+pco_frame_get_data_size (pco_frame frame)
+{
+    return frame->acq->data_size;
+}
+
+/**
+ * Get the pixel layout of a frame.
+ *
+ * @param frame A #pco_frame
+ * @return The #pco_frame_format of the pixels.
+ * @since 1.1
+ */
+pco_frame_format
+pco_frame_get_format (pco_frame frame)
+{
+    return frame->acq->format;
+}
+
+/**
+ * Get the number of a frame, counted by the frame grabber from 1.
+ *
+ * @param frame A #pco_frame
+ * @return The frame number.
+ * @since 1.1
+ */
+uint64_t
+pco_frame_get_number (pco_frame frame)
+{
+    return frame->number;
+}
+
+/**
+ * Get the binary time stamp of a frame, which is parsed while decoding if time
+ * stamps are turned on.
+ *
+ * @param frame A #pco_frame
+ * @param timestamp Location for the time stamp
+ * @return Error code or PCO_NOERROR. PCO_ERROR_WRONGVALUE is returned if the
+ * frame does not carry a valid time stamp.
+ * @since 1.1
+ */
+unsigned int
+pco_frame_get_timestamp (pco_frame frame, pco_timestamp *timestamp)
+{
+    if (!frame->has_timestamp)
+        return PCO_ERROR_WRONGVALUE;
+
+    *timestamp = frame->timestamp;
+    return PCO_NOERROR;
+}
@@ -147,16 +147,65 @@
 #include "sc2_telegram.h"
 #include "sc2_add.h"
 #include "PCO_err.h"
+#include "reorder.h"
 #include "config.h"
 
+/**
+ * Image re-order functions for one data format of the pco.edge.
+ */
+typedef struct {
+    pco_reorder_image_t reorder_image;
+    pco_reorder_image_t reorder_image_nt;
+    pco_reorder_image_inplace_t reorder_image_inplace;
+    pco_reorder_image_lut8_t reorder_image_lut8;
+    pco_reorder_image_scale8_t reorder_image_scale8;
+    pco_reorder_image_binned_t reorder_image_binned;
+    pco_reorder_image_roi_t reorder_image_roi;
+    pco_reorder_flat_field_workers_t reorder_flat_field;
+    pco_reorder_stats_workers_t reorder_stats;
+    pco_reorder_image_stats_t reorder_image_stats;
+    pco_reorder_image_stream_t reorder_image_stream;
+    pco_reorder_image_strided_t reorder_image_strided;
+} pco_reorder_funcs;
+
+static const pco_reorder_funcs pco_reorder_funcs_5x16 = {
+    .reorder_image = &pco_reorder_image_5x16,
+    .reorder_image_nt = &pco_reorder_image_5x16_nt,
+    .reorder_image_inplace = &pco_reorder_image_5x16_inplace,
+    .reorder_image_lut8 = &pco_reorder_image_5x16_lut8,
+    .reorder_image_scale8 = &pco_reorder_image_5x16_scale8,
+    .reorder_image_binned = &pco_reorder_image_5x16_binned,
+    .reorder_image_roi = &pco_reorder_image_5x16_roi,
+    .reorder_flat_field = &pco_reorder_5x16_flat_field_workers,
+    .reorder_stats = &pco_reorder_5x16_stats_workers,
+    .reorder_image_stats = &pco_reorder_image_5x16_stats,
+    .reorder_image_stream = &pco_reorder_image_5x16_stream,
+    .reorder_image_strided = &pco_reorder_image_5x16_strided,
+};
+
+static const pco_reorder_funcs pco_reorder_funcs_5x12 = {
+    .reorder_image = &pco_reorder_image_5x12,
+    .reorder_image_nt = &pco_reorder_image_5x12_nt,
+    .reorder_image_inplace = &pco_reorder_image_5x12_inplace,
+    .reorder_image_lut8 = &pco_reorder_image_5x12_lut8,
+    .reorder_image_scale8 = &pco_reorder_image_5x12_scale8,
+    .reorder_image_binned = &pco_reorder_image_5x12_binned,
+    .reorder_image_roi = &pco_reorder_image_5x12_roi,
+    .reorder_flat_field = &pco_reorder_5x12_flat_field_workers,
+    .reorder_stats = &pco_reorder_5x12_stats_workers,
+    .reorder_image_stats = &pco_reorder_image_5x12_stats,
+    .reorder_image_stream = &pco_reorder_image_5x12_stream,
+    .reorder_image_strided = &pco_reorder_image_5x12_strided,
+};
+
 struct pco_t {
     unsigned int num_ports;
 
     /**
-     * Pointer to image correction function. This is automatically set to the
-     * correct internal function, when pco_set_scan_mode() is called.
+     * Pointer to image correction functions. This is automatically set to the
+     * correct internal functions, when pco_set_scan_mode() is called.
      */
-    void (*reorder_image)(uint16_t *bufout, uint16_t *bufin, int width, int height);
+    const pco_reorder_funcs *reorder;
 
     void *serial_refs[4];
     void *serial_ref;
@@ -169,6 +218,23 @@ struct pco_t {
     uint32_t exposure;
 
     size_t extra_timeout;
+
+    /**
+     * Flat-field correction applied by pco_reorder_image_flat_field(). Both
+     * arrays are in display order and NULL if no correction is set.
+     */
+    float *flat_field_dark;
+    float *flat_field_gain;
+    int flat_field_width;
+    int flat_field_height;
+
+    /**
+     * Threads of the re-order functions that work on the handle, started on
+     * first use and kept until the number of threads changes.
+     */
+    pco_workers *reorder_workers;
+    int reorder_threads;
+    bool reorder_nontemporal;
 };
 
 #define CHECK_ERR_CL(code) \
@@ -186,79 +252,6 @@ struct pco_t {
         return (code);              \
     }
 
-/* Courtesy of PCO AG */
-static void
-decode_line (int width, void *bufout, void* bufin)
-{
-    uint32_t *lineadr_in = (uint32_t *) bufin;
-    uint32_t *lineadr_out = (uint32_t *) bufout;
-    uint32_t a;
-
-    for (int x = 0; x < (width*12) / 32; x += 3) {
-        a = (*lineadr_in & 0x0000FFF0) >> 4;
-        a |= (*lineadr_in & 0x0000000F) << 24;
-        a |= (*lineadr_in & 0xFF000000) >> 8;
-        *lineadr_out = a;
-        lineadr_out++;
-
-        a = (*lineadr_in & 0x00FF0000) >> 12;
-        lineadr_in++;
-        a |= (*lineadr_in & 0x0000F000) >> 12;
-        a |= (*lineadr_in & 0x00000FFF) << 16;
-        *lineadr_out = a;
-        lineadr_out++;
-
-        a = (*lineadr_in & 0xFFF00000) >> 20;
-        a |= (*lineadr_in & 0x000F0000) << 8;
-        lineadr_in++;
-        a |= (*lineadr_in & 0x0000FF00) << 8;
-        *lineadr_out = a;
-        lineadr_out++;
-
-        a = (*lineadr_in & 0x000000FF) << 4;
-        a |= (*lineadr_in & 0xF0000000) >> 28;
-        a |= (*lineadr_in & 0x0FFF0000);
-        *lineadr_out = a;
-        lineadr_out++;
-        lineadr_in++;
-    }
-}
-
-static void
-pco_reorder_image_5x12 (uint16_t *bufout, uint16_t *bufin, int width, int height)
-{
-    uint16_t *line_top = bufout;
-    uint16_t *line_bottom = bufout + (height-1)*width;
-    uint16_t *line_in = bufin;
-    int off = (width*12) / 16;
-
-    for (int y = 0; y < height/2; y++) {
-        decode_line (width, line_top, line_in);
-        line_in += off;
-        decode_line (width, line_bottom, line_in);
-        line_in += off;
-        line_top += width;
-        line_bottom -= width;
-    }
-}
-
-static void
-pco_reorder_image_5x16 (uint16_t *bufout, uint16_t *bufin, int width, int height)
-{
-    uint16_t *line_top = bufout;
-    uint16_t *line_bottom = bufout + (height-1)*width;
-    uint16_t *line_in = bufin;
-
-    for (int y = 0; y < height/2; y++) {
-        memcpy (line_top, line_in, width * sizeof(uint16_t));
-        line_in += width;
-        memcpy (line_bottom, line_in, width * sizeof(uint16_t));
-        line_in += width;
-        line_top += width;
-        line_bottom -= width;
-    }
-}
-
 static uint32_t
 pco_build_checksum (unsigned char *buffer, int *size)
 {
@@ -1014,6 +1007,19 @@ pco_get_maximum_number_of_adcs (pco_handle pco)
     return pco->description.wNumADCsDESC;
 }
 
+/**
+ * Get dynamic resolution of the sensor
+ *
+ * @param pco A #pco_handle.
+ * @return The number of valid bits per pixel.
+ * @since 1.1
+ */
+unsigned int
+pco_get_dynamic_resolution (pco_handle pco)
+{
+    return pco->description.wDynResDESC;
+}
+
 /**
  * Read current pixel rate.
  *
@@ -1117,11 +1123,11 @@ pco_set_scan_mode (pco_handle pco, uint32_t mode)
         return PCO_ERROR_IS_ERROR;
 
     if (mode == PCO_SCANMODE_SLOW) {
-        pco->reorder_image = &pco_reorder_image_5x16;
+        pco->reorder = &pco_reorder_funcs_5x16;
         pco->transfer.DataFormat = SCCMOS_FORMAT_TOP_CENTER_BOTTOM_CENTER | PCO_CL_DATAFORMAT_5x16;
     }
     else if (mode == PCO_SCANMODE_FAST) {
-        pco->reorder_image = &pco_reorder_image_5x12;
+        pco->reorder = &pco_reorder_funcs_5x12;
         pco->transfer.DataFormat = SCCMOS_FORMAT_TOP_CENTER_BOTTOM_CENTER | PCO_CL_DATAFORMAT_5x12;
     }
 
@@ -1488,6 +1494,75 @@ pco_get_timestamp_mode (pco_handle pco, uint16_t *mode)
     return err;
 }
 
+/**
+ * Check if the camera can append metadata to each frame.
+ *
+ * @param pco A #pco_handle.
+ * @return true if metadata mode is available.
+ * @since 1.1
+ */
+bool
+pco_is_metadata_mode_available (pco_handle pco)
+{
+    return (pco->description.dwGeneralCaps1 & GENERALCAPS1_METADATA) != 0;
+}
+
+/**
+ * Set metadata mode. If this is METADATA_MODE_ON, the camera appends a block of
+ * metadata to each frame, which can be read with pco_get_metadata_view() and
+ * pco_parse_metadata(). The frame grabber must then transfer enough additional
+ * pixels, see pco_get_metadata_mode().
+ *
+ * @param pco A #pco_handle.
+ * @param mode The metadata mode:
+ *    - METADATA_MODE_OFF
+ *    - METADATA_MODE_ON
+ * @return Error code or PCO_NOERROR.
+ * @since 1.1
+ */
+unsigned int
+pco_set_metadata_mode (pco_handle pco, uint16_t mode)
+{
+    SC2_Metadata_Mode_Response resp;
+    SC2_Set_Metadata_Mode com = {
+        .wCode = SET_METADATA_MODE,
+        .wSize = sizeof(com),
+        .wMode = mode,
+        .wReserved1 = 0,
+        .wReserved2 = 0
+    };
+    return pco_control_command (pco, &com, sizeof(com), &resp, sizeof(resp));
+}
+
+/**
+ * Get metadata mode.
+ *
+ * @param pco A #pco_handle.
+ * @param mode Location for the metadata mode
+ * @param size Location for the size of the metadata block in pixels or NULL
+ * @param version Location for the version of the metadata block or NULL
+ * @return Error code or PCO_NOERROR.
+ * @since 1.1
+ */
+unsigned int
+pco_get_metadata_mode (pco_handle pco, uint16_t *mode, uint16_t *size, uint16_t *version)
+{
+    SC2_Metadata_Mode_Response resp;
+    unsigned int err = pco_read_property (pco, GET_METADATA_MODE, &resp, sizeof(resp));
+
+    if (err == PCO_NOERROR) {
+        *mode = resp.wMode;
+
+        if (size != NULL)
+            *size = resp.wMetadataSize;
+
+        if (version != NULL)
+            *version = resp.wMetadataVersion;
+    }
+
+    return err;
+}
+
 /**
  * Set time scale of delay and exposure. Parameter values for delay and exposure can be:
  *    - TIMEBASE_NS
@@ -2289,9 +2364,406 @@ pco_set_date_time (pco_handle pco)
 pco_reorder_image_t
 pco_get_reorder_func (pco_handle pco)
 {
-    return pco->reorder_image;
+    if (pco->reorder_nontemporal)
+        return pco->reorder->reorder_image_nt;
+
+    return pco->reorder->reorder_image;
+}
+
+/**
+ * Return the currently used in-place re-order function. In contrast to
+ * pco_get_reorder_func(), the returned function re-orders the frame within the
+ * DMA buffer and does not require a second frame buffer.
+ *
+ * @param pco A #pco_handle
+ * @return Pointer to a #pco_reorder_image_inplace_t function.
+ * @since 1.1
+ */
+pco_reorder_image_inplace_t
+pco_get_reorder_inplace_func (pco_handle pco)
+{
+    return pco->reorder->reorder_image_inplace;
+}
+
+/**
+ * Return the currently used re-order function that maps the frame to 8 bit
+ * through a look-up table. The table must have 4096 entries in fast scan mode
+ * and 65536 entries in slow scan mode.
+ *
+ * @param pco A #pco_handle
+ * @return Pointer to a #pco_reorder_image_lut8_t function.
+ * @since 1.1
+ */
+pco_reorder_image_lut8_t
+pco_get_reorder_lut8_func (pco_handle pco)
+{
+    return pco->reorder->reorder_image_lut8;
+}
+
+/**
+ * Return the currently used re-order function that scales the frame linearly
+ * to 8 bit.
+ *
+ * @param pco A #pco_handle
+ * @return Pointer to a #pco_reorder_image_scale8_t function.
+ * @since 1.1
+ */
+pco_reorder_image_scale8_t
+pco_get_reorder_scale8_func (pco_handle pco)
+{
+    return pco->reorder->reorder_image_scale8;
 }
 
+/**
+ * Return the currently used re-order function that bins the frame in
+ * software. In contrast to pco_set_binning(), any binning can be used and the
+ * camera settings are not touched.
+ *
+ * @param pco A #pco_handle
+ * @return Pointer to a #pco_reorder_image_binned_t function.
+ * @since 1.1
+ */
+pco_reorder_image_binned_t
+pco_get_reorder_binned_func (pco_handle pco)
+{
+    return pco->reorder->reorder_image_binned;
+}
+
+/**
+ * Return the currently used re-order function for a rectangular region of the
+ * frame. Use this to track a small window of a full-sensor readout without
+ * decoding the whole frame.
+ *
+ * @param pco A #pco_handle
+ * @return Pointer to a #pco_reorder_image_roi_t function.
+ * @since 1.1
+ */
+pco_reorder_image_roi_t
+pco_get_reorder_roi_func (pco_handle pco)
+{
+    return pco->reorder->reorder_image_roi;
+}
+
+/**
+ * Return the currently used re-order function that computes minimum, maximum,
+ * mean, number of saturated pixels and a histogram while decoding. Use this
+ * for auto-exposure without another pass over the frame.
+ *
+ * @param pco A #pco_handle
+ * @return Pointer to a #pco_reorder_image_stats_t function.
+ * @since 1.1
+ */
+pco_reorder_image_stats_t
+pco_get_reorder_stats_func (pco_handle pco)
+{
+    return pco->reorder->reorder_image_stats;
+}
+
+/**
+ * Return the currently used re-order function that passes decoded rows in
+ * small batches to a callback. Row-wise processing can then run on rows that
+ * are still in the cache, without a full-frame intermediate buffer.
+ *
+ * @param pco A #pco_handle
+ * @return Pointer to a #pco_reorder_image_stream_t function.
+ * @since 1.1
+ */
+pco_reorder_image_stream_t
+pco_get_reorder_stream_func (pco_handle pco)
+{
+    return pco->reorder->reorder_image_stream;
+}
+
+/**
+ * Return the currently used re-order function that takes explicit line
+ * pitches, e.g. to decode frames into padded rows or a part of a larger image.
+ *
+ * @param pco A #pco_handle
+ * @return Pointer to a #pco_reorder_image_strided_t function.
+ * @since 1.1
+ */
+pco_reorder_image_strided_t
+pco_get_reorder_strided_func (pco_handle pco)
+{
+    return pco->reorder->reorder_image_strided;
+}
+
+/**
+ * Set the number of threads used by re-order functions that work on the
+ * handle, e.g. pco_reorder_image_flat_field(). The threads are started on first
+ * use and kept for subsequent frames.
+ *
+ * @param pco A #pco_handle
+ * @param num_threads Number of threads between 1 and #PCO_MAX_REORDER_THREADS
+ * @return Error code or PCO_NOERROR.
+ * @since 1.1
+ */
+unsigned int
+pco_set_reorder_threads (pco_handle pco, int num_threads)
+{
+    if (num_threads < 1 || num_threads > PCO_MAX_REORDER_THREADS)
+        return PCO_ERROR_WRONGVALUE;
+
+    if (pco->reorder_workers != NULL && num_threads != pco->reorder_threads) {
+        pco_workers_free (pco->reorder_workers);
+        pco->reorder_workers = NULL;
+    }
+
+    pco->reorder_threads = num_threads;
+    return PCO_NOERROR;
+}
+
+/**
+ * Get the number of threads used by re-order functions that work on the
+ * handle.
+ *
+ * @param pco A #pco_handle
+ * @param num_threads Location for the number of threads
+ * @return Error code or PCO_NOERROR.
+ * @since 1.1
+ */
+unsigned int
+pco_get_reorder_threads (pco_handle pco, int *num_threads)
+{
+    *num_threads = pco->reorder_threads;
+    return PCO_NOERROR;
+}
+
+/**
+ * Enable or disable non-temporal stores for the function returned by
+ * pco_get_reorder_func(). With non-temporal stores the re-ordered frame
+ * bypasses the cache, which keeps the working sets of other threads intact
+ * when frames are written to a ring buffer or to disk.
+ *
+ * @param pco A #pco_handle
+ * @param on true to use non-temporal stores
+ * @return Error code or PCO_NOERROR.
+ * @since 1.1
+ * @see pco_reorder_image_5x12_nt()
+ */
+unsigned int
+pco_set_reorder_nontemporal (pco_handle pco, bool on)
+{
+    pco->reorder_nontemporal = on;
+    return PCO_NOERROR;
+}
+
+/**
+ * Get whether pco_get_reorder_func() returns a function using non-temporal
+ * stores.
+ *
+ * @param pco A #pco_handle
+ * @param on Location for the current setting
+ * @return Error code or PCO_NOERROR.
+ * @since 1.1
+ */
+unsigned int
+pco_get_reorder_nontemporal (pco_handle pco, bool *on)
+{
+    *on = pco->reorder_nontemporal;
+    return PCO_NOERROR;
+}
+
+static unsigned int
+pco_alloc_flat_field (pco_handle pco, int width, int height)
+{
+    const size_t size = (size_t) width * height * sizeof(float);
+
+    if (width <= 0 || height <= 0)
+        return PCO_ERROR_WRONGVALUE;
+
+    pco_clear_flat_field (pco);
+    pco->flat_field_dark = (float *) malloc (size);
+    pco->flat_field_gain = (float *) malloc (size);
+
+    if (pco->flat_field_dark == NULL || pco->flat_field_gain == NULL) {
+        pco_clear_flat_field (pco);
+        return PCO_ERROR_NOMEMORY;
+    }
+
+    pco->flat_field_width = width;
+    pco->flat_field_height = height;
+    return PCO_NOERROR;
+}
+
+/**
+ * Attach a flat-field correction to the handle. Frames decoded with
+ * pco_reorder_image_flat_field() are normalized as (I - dark) / (flat - dark).
+ * The gain is pre-computed here, pixels where flat is not brighter than dark
+ * are set to zero.
+ *
+ * @param pco A #pco_handle
+ * @param dark Dark field with width * height pixels in display order
+ * @param flat Flat field with width * height pixels in display order
+ * @param width Width of the frames in pixels
+ * @param height Height of the frames in pixels
+ * @return Error code or PCO_NOERROR.
+ * @since 1.1
+ */
+unsigned int
+pco_set_flat_field (pco_handle pco, const uint16_t *dark, const uint16_t *flat, int width, int height)
+{
+    unsigned int err = pco_alloc_flat_field (pco, width, height);
+
+    if (err != PCO_NOERROR)
+        return err;
+
+    for (size_t i = 0; i < (size_t) width * height; i++) {
+        pco->flat_field_dark[i] = dark[i];
+        pco->flat_field_gain[i] = flat[i] > dark[i] ? 1.0f / (flat[i] - dark[i]) : 0.0f;
+    }
+
+    return PCO_NOERROR;
+}
+
+/**
+ * Attach a flat-field correction with a pre-computed gain to the handle.
+ * Frames decoded with pco_reorder_image_flat_field() are normalized as
+ * (I - dark) * gain.
+ *
+ * @param pco A #pco_handle
+ * @param dark Dark field with width * height pixels in display order
+ * @param gain Gain with width * height pixels in display order
+ * @param width Width of the frames in pixels
+ * @param height Height of the frames in pixels
+ * @return Error code or PCO_NOERROR.
+ * @since 1.1
+ */
+unsigned int
+pco_set_flat_field_gain (pco_handle pco, const float *dark, const float *gain, int width, int height)
+{
+    unsigned int err = pco_alloc_flat_field (pco, width, height);
+
+    if (err != PCO_NOERROR)
+        return err;
+
+    memcpy (pco->flat_field_dark, dark, (size_t) width * height * sizeof(float));
+    memcpy (pco->flat_field_gain, gain, (size_t) width * height * sizeof(float));
+    return PCO_NOERROR;
+}
+
+/**
+ * Remove the flat-field correction from the handle.
+ *
+ * @param pco A #pco_handle
+ * @return Error code or PCO_NOERROR.
+ * @since 1.1
+ */
+unsigned int
+pco_clear_flat_field (pco_handle pco)
+{
+    free (pco->flat_field_dark);
+    free (pco->flat_field_gain);
+    pco->flat_field_dark = NULL;
+    pco->flat_field_gain = NULL;
+    pco->flat_field_width = 0;
+    pco->flat_field_height = 0;
+    return PCO_NOERROR;
+}
+
+/*
+ * Start the threads of the handle's re-order functions on first use.
+ */
+static unsigned int
+pco_start_reorder_workers (pco_handle pco)
+{
+    if (pco->reorder_workers == NULL)
+        pco->reorder_workers = pco_workers_new (pco->reorder_threads);
+
+    return pco->reorder_workers != NULL ? PCO_NOERROR : PCO_ERROR_NOMEMORY;
+}
+
+static unsigned int
+pco_check_flat_field (pco_handle pco, int width, int height)
+{
+    if (pco->flat_field_gain == NULL)
+        return PCO_ERROR_WRONGVALUE;
+
+    if (width != pco->flat_field_width || height != pco->flat_field_height)
+        return PCO_ERROR_APPLICATION_WRONGRES;
+
+    return pco_start_reorder_workers (pco);
+}
+
+/**
+ * Decode, re-order and flat-field correct a frame in a single pass using the
+ * correction set with pco_set_flat_field() or pco_set_flat_field_gain() and
+ * the threads set with pco_set_reorder_threads().
+ *
+ * @param pco A #pco_handle
+ * @param bufout Memory for width * height float pixels
+ * @param bufin Raw frame as delivered by the frame grabber
+ * @param width Width of the frame in pixels
+ * @param height Height of the frame in pixels
+ * @return Error code or PCO_NOERROR.
+ * @since 1.1
+ */
+unsigned int
+pco_reorder_image_flat_field (pco_handle pco, float *bufout, uint16_t *bufin, int width, int height)
+{
+    unsigned int err = pco_check_flat_field (pco, width, height);
+
+    if (err == PCO_NOERROR)
+        err = pco->reorder->reorder_flat_field (pco->reorder_workers, bufout, bufin, width, height,
+                                                pco->flat_field_dark, pco->flat_field_gain,
+                                                1.0f, false);
+
+    return err;
+}
+
+/**
+ * Decode, re-order and flat-field correct a frame into 16 bit pixels. The
+ * corrected value is multiplied with #scale, rounded and clamped.
+ *
+ * @param pco A #pco_handle
+ * @param bufout Memory for width * height 16 bit pixels
+ * @param bufin Raw frame as delivered by the frame grabber
+ * @param width Width of the frame in pixels
+ * @param height Height of the frame in pixels
+ * @param scale Factor applied to the corrected value
+ * @return Error code or PCO_NOERROR.
+ * @since 1.1
+ * @see pco_reorder_image_flat_field()
+ */
+unsigned int
+pco_reorder_image_flat_field_u16 (pco_handle pco, uint16_t *bufout, uint16_t *bufin, int width, int height, float scale)
+{
+    unsigned int err = pco_check_flat_field (pco, width, height);
+
+    if (err == PCO_NOERROR)
+        err = pco->reorder->reorder_flat_field (pco->reorder_workers, bufout, bufin, width, height,
+                                                pco->flat_field_dark, pco->flat_field_gain,
+                                                scale, true);
+
+    return err;
+}
+
+/**
+ * Decode and re-order a frame and compute its statistics in the same pass,
+ * split across the threads set with pco_set_reorder_threads(). Each thread
+ * builds a partial histogram of the rows it decodes, which are merged at the
+ * end.
+ *
+ * @param pco A #pco_handle
+ * @param bufout Memory for width * height 16 bit pixels
+ * @param bufin Raw frame as delivered by the frame grabber
+ * @param width Width of the frame in pixels
+ * @param height Height of the frame in pixels
+ * @param stats Statistics to fill or NULL to just re-order the frame
+ * @return Error code or PCO_NOERROR.
+ * @since 1.1
+ * @see pco_reorder_image_5x12_stats()
+ */
+unsigned int
+pco_reorder_image_stats (pco_handle pco, uint16_t *bufout, uint16_t *bufin, int width, int height, pco_frame_stats *stats)
+{
+    unsigned int err = pco_start_reorder_workers (pco);
+
+    if (err == PCO_NOERROR)
+        err = pco->reorder->reorder_stats (pco->reorder_workers, bufout, bufin, width, height, stats);
+
+    return err;
+}
 /**
  * Initialize a PCO camera.
  *
@@ -2311,7 +2783,9 @@ pco_init (void)
 
     memset (pco, 0, sizeof (struct pco_t));
 
-    pco->reorder_image = &pco_reorder_image_5x16;
+    pco->reorder = &pco_reorder_funcs_5x16;
+    pco->reorder_threads = 1;
+    pco->reorder_nontemporal = false;
     pco->timeouts.command = PCO_SC2_COMMAND_TIMEOUT;
     pco->timeouts.image = PCO_SC2_IMAGE_TIMEOUT_L;
     pco->timeouts.transfer = PCO_SC2_COMMAND_TIMEOUT;
@@ -2396,6 +2870,8 @@ pco_destroy (pco_handle pco)
     for (int i = 0; i < pco->num_ports; i++)
         clSerialClose (pco->serial_refs[i]);
 
+    pco_clear_flat_field (pco);
+    pco_workers_free (pco->reorder_workers);
     free (pco);
 }
 
@@ -20,23 +20,291 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
 #include "sc2_defs.h"
 #include "PCO_err.h"
 
 #define PCO_SCANMODE_SLOW   0
 #define PCO_SCANMODE_FAST   1
 
+#define PCO_MAX_REORDER_THREADS 64
+#define PCO_HISTOGRAM_BINS      4096
+#define PCO_STREAM_BATCH_SIZE   (128 * 1024)
+#define PCO_TIMESTAMP_PIXELS    14
+
 /**
  * Opaque data structure that identifies a PCO camera 
  */
 typedef struct pco_t *pco_handle; 
 
+/**
+ * Possible ways to combine pixels when binning in software
+ */
+typedef enum {
+    PCO_BINNING_SUM_16,     /**< Sum into 16 bit pixels, saturating at 65535 */
+    PCO_BINNING_SUM_32,     /**< Sum into 32 bit pixels */
+    PCO_BINNING_MEAN_16     /**< Average into 16 bit pixels */
+} pco_binning_mode;
+
+/**
+ * Statistics of a decoded frame.
+ *
+ * @note libpco is built with -fpack-struct, so the members of public structures
+ * are ordered by decreasing size to yield the same layout with and without
+ * packing.
+ */
+typedef struct {
+    double mean;                /**< Mean pixel value */
+    uint64_t sum;               /**< Sum of all pixel values */
+    uint64_t num_pixels;        /**< Number of pixels */
+    uint64_t num_saturated;     /**< Number of saturated pixels */
+    uint32_t histogram[PCO_HISTOGRAM_BINS]; /**< Histogram of the 12 most significant bits */
+    uint16_t saturation_level;  /**< Set by the caller, pixels at or above are saturated */
+    uint16_t min;               /**< Smallest pixel value */
+    uint16_t max;               /**< Largest pixel value */
+    uint16_t reserved;
+} pco_frame_stats;
+
+/**
+ * Binary time stamp written by the camera into the first pixels of a frame.
+ */
+typedef struct {
+    uint32_t frame_number;      /**< Image counter */
+    uint32_t microseconds;      /**< Microseconds within the second */
+    uint16_t year;              /**< Year, e.g. 2013 */
+    uint8_t month;              /**< Month, 1 to 12 */
+    uint8_t day;                /**< Day, 1 to 31 */
+    uint8_t hour;               /**< Hour, 0 to 23 */
+    uint8_t minute;             /**< Minute, 0 to 59 */
+    uint8_t second;             /**< Second, 0 to 59 */
+    uint8_t reserved;
+} pco_timestamp;
+
+/**
+ * Tracks the image counters of a stream of frames to detect dropped and
+ * duplicated frames.
+ */
+typedef struct {
+    uint64_t num_frames;        /**< Number of frames seen */
+    uint64_t num_dropped;       /**< Number of frames missing from the sequence */
+    uint64_t num_duplicated;    /**< Number of frames whose counter repeated or came late */
+    uint32_t last_frame_number; /**< Highest image counter seen since the last restart */
+    uint32_t num_restarts;      /**< Number of times the counter jumped back, e.g. after re-arming */
+} pco_frame_tracker;
+
+/**
+ * Location of the metadata block appended by the camera to a frame. The block
+ * is not copied, #pixels points into the frame buffer.
+ */
+typedef struct {
+    const uint16_t *pixels;     /**< First pixel of the metadata block */
+    int shift;                  /**< Position of the metadata byte within a pixel */
+    uint16_t size;              /**< Size of the block in pixels */
+    uint16_t version;           /**< Version of the block */
+} pco_metadata_view;
+
+/**
+ * Metadata of a frame as parsed by pco_parse_metadata(). Fields that are not
+ * part of the block of the camera are zero.
+ */
+typedef struct {
+    uint32_t frame_number;      /**< Image counter */
+    uint32_t microseconds;      /**< Microseconds within the second */
+    uint32_t exposure_time;     /**< Exposure time in units of exposure_timebase */
+    uint32_t framerate_mhz;     /**< Frame rate in mHz, 0 if unknown */
+    uint32_t readout_frequency; /**< Sensor readout frequency in Hz, 0 if unknown */
+    uint32_t serial_number;     /**< Camera serial number, 0 if unknown */
+    uint16_t year;              /**< Year, e.g. 2013 */
+    uint16_t exposure_timebase; /**< TIMEBASE_NS, TIMEBASE_US or TIMEBASE_MS */
+    uint16_t width;             /**< Actual width of the frame */
+    uint16_t height;            /**< Actual height of the frame */
+    uint16_t conversion_factor; /**< Conversion factor in e-/ct, 0 if unknown */
+    uint16_t camera_type;       /**< Camera type, 0 if unknown */
+    uint16_t dark_offset;       /**< Nominal dark offset, 0xFFFF if unknown */
+    uint16_t color_pattern;     /**< Bayer pattern color mask, 0 if not applicable */
+    int16_t sensor_temperature; /**< Sensor temperature in 0.1 °C, -32768 if unknown */
+    uint16_t reserved;
+    uint8_t month;              /**< Month, 1 to 12 */
+    uint8_t day;                /**< Day, 1 to 31 */
+    uint8_t hour;               /**< Hour, 0 to 23 */
+    uint8_t minute;             /**< Minute, 0 to 59 */
+    uint8_t second;             /**< Second, 0 to 59 */
+    uint8_t time_status;        /**< 0 internal oscillator, 1 synced by IRIG, 2 synced by master */
+    uint8_t binning_x;          /**< Horizontal binning, 0 if unknown */
+    uint8_t binning_y;          /**< Vertical binning, 0 if unknown */
+    uint8_t bit_resolution;     /**< Number of valid bits per pixel */
+    uint8_t bit_alignment;      /**< 1 if MSB aligned, 0 if LSB aligned */
+    uint8_t trigger_mode;       /**< Trigger mode */
+    uint8_t double_image_mode;  /**< 1 in double image mode */
+    uint8_t sync_mode;          /**< Camera sync mode */
+    uint8_t image_type;         /**< 1 b/w, 2 color bayer pattern, 0x10 RGB */
+    uint8_t reserved2[2];
+} pco_metadata;
+
 /**
  * Specifies the type of function that is used to re-order images coming from a
  * pco.edge camera.
  */
 typedef void (*pco_reorder_image_t)(uint16_t *bufout, uint16_t *bufin, int width, int height);
 
+/**
+ * Specifies the type of function that is used to re-order images coming from a
+ * pco.edge camera within the DMA buffer itself.
+ */
+typedef unsigned int (*pco_reorder_image_inplace_t)(uint16_t *buf, int width, int height, uint16_t *scratch);
+
+/**
+ * Specifies the type of function that is used to re-order images coming from a
+ * pco.edge camera and map them to 8 bit through a look-up table.
+ */
+typedef void (*pco_reorder_image_lut8_t)(uint8_t *bufout, uint16_t *bufin, int width, int height, const uint8_t *lut);
+
+/**
+ * Specifies the type of function that is used to re-order images coming from a
+ * pco.edge camera and scale them linearly from [min, max] to 8 bit.
+ */
+typedef void (*pco_reorder_image_scale8_t)(uint8_t *bufout, uint16_t *bufin, int width, int height, uint16_t min, uint16_t max);
+
+/**
+ * Specifies the type of function that is used to re-order images coming from a
+ * pco.edge camera and bin them in software.
+ */
+typedef void (*pco_reorder_image_binned_t)(void *bufout, uint16_t *bufin, int width, int height, int bin_x, int bin_y, pco_binning_mode mode);
+
+/**
+ * Specifies the type of function that is used to re-order a rectangular region
+ * of images coming from a pco.edge camera.
+ */
+typedef void (*pco_reorder_image_roi_t)(uint16_t *bufout, uint16_t *bufin, int width, int height, int x, int y, int roi_width, int roi_height);
+
+/**
+ * Specifies the type of function that is used to re-order images coming from a
+ * pco.edge camera and flat-field correct them into float pixels.
+ */
+typedef unsigned int (*pco_reorder_image_flat_field_t)(float *bufout, uint16_t *bufin, int width, int height, const float *dark, const float *gain);
+
+/**
+ * Specifies the type of function that is used to re-order images coming from a
+ * pco.edge camera and flat-field correct them into 16 bit pixels.
+ */
+typedef unsigned int (*pco_reorder_image_flat_field_u16_t)(uint16_t *bufout, uint16_t *bufin, int width, int height, const float *dark, const float *gain, float scale);
+
+/**
+ * Specifies the type of function that is used to re-order images coming from a
+ * pco.edge camera and compute their statistics.
+ */
+typedef unsigned int (*pco_reorder_image_stats_t)(uint16_t *bufout, uint16_t *bufin, int width, int height, pco_frame_stats *stats);
+
+/**
+ * Function receiving num_rows consecutive rows of width pixels, starting with
+ * row first_row of the frame.
+ */
+typedef void (*pco_row_func)(const uint16_t *rows, int first_row, int num_rows, int width, void *user_data);
+
+/**
+ * Specifies the type of function that is used to re-order images coming from a
+ * pco.edge camera and pass them on in batches of rows.
+ */
+typedef void (*pco_reorder_image_stream_t)(uint16_t *bufin, int width, int height, int batch_rows, pco_row_func func, void *user_data);
+
+/**
+ * Specifies the type of function that is used to re-order images coming from a
+ * pco.edge camera with explicit input and output line pitches in bytes.
+ */
+typedef void (*pco_reorder_image_strided_t)(uint16_t *bufout, size_t out_pitch, const uint16_t *bufin, size_t in_pitch, int width, int height);
+
+/**
+ * Continuous acquisition through a frame grabber, see pco_acquisition_init().
+ */
+typedef struct pco_acquisition_t *pco_acquisition;
+
+/**
+ * Reference-counted lease on a frame of a #pco_acquisition. The frame buffer
+ * is returned to the acquisition when the last reference is released with
+ * pco_frame_unref().
+ */
+typedef struct pco_frame_t *pco_frame;
+
+/**
+ * Pixel layout of a #pco_frame
+ */
+typedef enum {
+    PCO_FRAME_FORMAT_GRAY16,    /**< 16 bit pixels in display order */
+    PCO_FRAME_FORMAT_EDGE_5X12, /**< pco.edge frame as transferred in 5x12 format */
+    PCO_FRAME_FORMAT_EDGE_5X16  /**< pco.edge frame as transferred in 5x16 format */
+} pco_frame_format;
+
+/**
+ * How a #pco_acquisition sheds load when the consumer or the decode stage
+ * falls behind, see pco_acquisition_set_drop_policy().
+ */
+typedef enum {
+    PCO_DROP_BLOCK,     /**< Wait for free frame buffers, frames are only lost when the DMA ring overflows */
+    PCO_DROP_NEWEST,    /**< Drop arriving frames while no frame buffer is free */
+    PCO_DROP_OLDEST,    /**< Replace the oldest frame that the consumer has not taken yet */
+    PCO_DROP_DECIMATE   /**< Drop arriving frames but every Nth while no frame buffer is free */
+} pco_drop_policy;
+
+/**
+ * Number of dropped frame numbers kept in #pco_drop_stats
+ */
+#define PCO_DROP_HISTORY 16
+
+/**
+ * Frames dropped by a #pco_acquisition since it was started. Frame numbers
+ * are those of pco_frame_get_number().
+ */
+typedef struct {
+    uint64_t num_overwritten;   /**< Frames overwritten in the DMA ring before they were decoded */
+    uint64_t num_discarded;     /**< Frames dropped by the drop policy */
+    uint64_t first_dropped;     /**< Number of the first dropped frame, 0 if none */
+    uint64_t last_dropped;      /**< Number of the latest dropped frame, 0 if none */
+    uint64_t recent[PCO_DROP_HISTORY];  /**< Numbers of the latest dropped frames in the order they were dropped */
+    uint32_t num_recent;        /**< Number of valid entries in recent */
+    uint32_t reserved;
+} pco_drop_stats;
+
+/**
+ * Camera and frame description stored in the header of a recording written
+ * by a #pco_writer.
+ */
+typedef struct {
+    uint32_t serial_number;     /**< Serial number of the camera */
+    uint32_t width;             /**< Frame width in pixels */
+    uint32_t height;            /**< Frame height in pixels */
+    uint32_t format;            /**< #pco_frame_format of the frames */
+    uint16_t camera_type;       /**< Camera type as defined in sc2_defs.h */
+    uint16_t camera_subtype;    /**< Camera sub type */
+    uint16_t bit_depth;         /**< Significant bits per pixel */
+    uint16_t reserved;
+    char name[40];              /**< Camera name */
+} pco_recording_info;
+
+/**
+ * Streaming writer for the frames of a #pco_acquisition, see pco_writer_new().
+ */
+typedef struct pco_writer_t *pco_writer;
+
+/**
+ * Memory-mapped recording written by a #pco_writer, see pco_reader_open().
+ */
+typedef struct pco_reader_t *pco_reader;
+
+/**
+ * Expected access pattern of a #pco_reader
+ */
+typedef enum {
+    PCO_READER_ACCESS_SEQUENTIAL,   /**< Frames are read in order, once */
+    PCO_READER_ACCESS_RANDOM        /**< Frames are read in any order */
+} pco_reader_access;
+
+/**
+ * Function receiving each frame of a #pco_acquisition. The frame is only valid
+ * until the function returns, unless a reference is taken with
+ * pco_frame_ref().
+ */
+typedef void (*pco_frame_func)(pco_frame frame, void *user_data);
+
 /**
  * Possible values for ADC mode
  */
@@ -71,6 +339,7 @@ unsigned int pco_get_available_conversion_factors(pco_handle pco, uint16_t facto
 unsigned int pco_set_adc_mode(pco_handle pco, pco_adc_mode mode);
 unsigned int pco_get_adc_mode(pco_handle pco, pco_adc_mode *mode);
 unsigned int pco_get_maximum_number_of_adcs(pco_handle pco);
+unsigned int pco_get_dynamic_resolution(pco_handle pco);
 
 unsigned int pco_get_cooling_range(pco_handle pco, int16_t *default_temp, int16_t *min_temp, int16_t *max_temp);
 unsigned int pco_set_cooling_temperature(pco_handle pco, int16_t temperature);
@@ -101,6 +370,9 @@ unsigned int pco_get_num_images(pco_handle pco, uint16_t segment, uint32_t *num_
 unsigned int pco_force_trigger(pco_handle pco, uint32_t *success);
 unsigned int pco_set_timestamp_mode(pco_handle pco, uint16_t mode);
 unsigned int pco_get_timestamp_mode(pco_handle pco, uint16_t *mode);
+bool pco_is_metadata_mode_available(pco_handle pco);
+unsigned int pco_set_metadata_mode(pco_handle pco, uint16_t mode);
+unsigned int pco_get_metadata_mode(pco_handle pco, uint16_t *mode, uint16_t *size, uint16_t *version);
 unsigned int pco_set_timebase(pco_handle pco, uint16_t delay, uint16_t expos);
 unsigned int pco_get_timebase(pco_handle pco, uint16_t *delay, uint16_t *expos);
 unsigned int pco_get_delay_time(pco_handle pco, uint32_t *delay);
@@ -140,5 +412,113 @@ unsigned int pco_edge_set_shutter(pco_handle pco, pco_edge_shutter shutter);
 unsigned int pco_control_command(pco_handle pco, void *buffer_in, uint32_t size_in, void *buffer_out, uint32_t size_out);
 
 pco_reorder_image_t pco_get_reorder_func(pco_handle pco);
+pco_reorder_image_inplace_t pco_get_reorder_inplace_func(pco_handle pco);
+pco_reorder_image_lut8_t pco_get_reorder_lut8_func(pco_handle pco);
+pco_reorder_image_scale8_t pco_get_reorder_scale8_func(pco_handle pco);
+pco_reorder_image_binned_t pco_get_reorder_binned_func(pco_handle pco);
+pco_reorder_image_roi_t pco_get_reorder_roi_func(pco_handle pco);
+pco_reorder_image_stats_t pco_get_reorder_stats_func(pco_handle pco);
+pco_reorder_image_stream_t pco_get_reorder_stream_func(pco_handle pco);
+pco_reorder_image_strided_t pco_get_reorder_strided_func(pco_handle pco);
+
+unsigned int pco_set_reorder_threads(pco_handle pco, int num_threads);
+unsigned int pco_get_reorder_threads(pco_handle pco, int *num_threads);
+unsigned int pco_set_reorder_nontemporal(pco_handle pco, bool on);
+unsigned int pco_get_reorder_nontemporal(pco_handle pco, bool *on);
+unsigned int pco_set_flat_field(pco_handle pco, const uint16_t *dark, const uint16_t *flat, int width, int height);
+unsigned int pco_set_flat_field_gain(pco_handle pco, const float *dark, const float *gain, int width, int height);
+unsigned int pco_clear_flat_field(pco_handle pco);
+unsigned int pco_reorder_image_flat_field(pco_handle pco, float *bufout, uint16_t *bufin, int width, int height);
+unsigned int pco_reorder_image_flat_field_u16(pco_handle pco, uint16_t *bufout, uint16_t *bufin, int width, int height, float scale);
+unsigned int pco_reorder_image_stats(pco_handle pco, uint16_t *bufout, uint16_t *bufin, int width, int height, pco_frame_stats *stats);
+
+void pco_reorder_image_5x12(uint16_t *bufout, uint16_t *bufin, int width, int height);
+void pco_reorder_image_5x16(uint16_t *bufout, uint16_t *bufin, int width, int height);
+size_t pco_get_raw_pitch_5x12(int width);
+size_t pco_get_raw_pitch_5x16(int width);
+void pco_reorder_image_5x12_strided(uint16_t *bufout, size_t out_pitch, const uint16_t *bufin, size_t in_pitch, int width, int height);
+void pco_reorder_image_5x16_strided(uint16_t *bufout, size_t out_pitch, const uint16_t *bufin, size_t in_pitch, int width, int height);
+void pco_reorder_image_5x12_nt(uint16_t *bufout, uint16_t *bufin, int width, int height);
+void pco_reorder_image_5x16_nt(uint16_t *bufout, uint16_t *bufin, int width, int height);
+unsigned int pco_reorder_image_5x12_inplace(uint16_t *buf, int width, int height, uint16_t *scratch);
+unsigned int pco_reorder_image_5x16_inplace(uint16_t *buf, int width, int height, uint16_t *scratch);
+size_t pco_get_inplace_scratch_size(int width, int height);
+void pco_reorder_image_5x12_lut8(uint8_t *bufout, uint16_t *bufin, int width, int height, const uint8_t *lut);
+void pco_reorder_image_5x16_lut8(uint8_t *bufout, uint16_t *bufin, int width, int height, const uint8_t *lut);
+void pco_reorder_image_5x12_scale8(uint8_t *bufout, uint16_t *bufin, int width, int height, uint16_t min, uint16_t max);
+void pco_reorder_image_5x16_scale8(uint8_t *bufout, uint16_t *bufin, int width, int height, uint16_t min, uint16_t max);
+void pco_reorder_image_5x12_binned(void *bufout, uint16_t *bufin, int width, int height, int bin_x, int bin_y, pco_binning_mode mode);
+void pco_reorder_image_5x16_binned(void *bufout, uint16_t *bufin, int width, int height, int bin_x, int bin_y, pco_binning_mode mode);
+void pco_reorder_image_5x12_roi(uint16_t *bufout, uint16_t *bufin, int width, int height, int x, int y, int roi_width, int roi_height);
+void pco_reorder_image_5x16_roi(uint16_t *bufout, uint16_t *bufin, int width, int height, int x, int y, int roi_width, int roi_height);
+unsigned int pco_reorder_image_5x12_flat_field(float *bufout, uint16_t *bufin, int width, int height, const float *dark, const float *gain);
+unsigned int pco_reorder_image_5x16_flat_field(float *bufout, uint16_t *bufin, int width, int height, const float *dark, const float *gain);
+unsigned int pco_reorder_image_5x12_flat_field_u16(uint16_t *bufout, uint16_t *bufin, int width, int height, const float *dark, const float *gain, float scale);
+unsigned int pco_reorder_image_5x16_flat_field_u16(uint16_t *bufout, uint16_t *bufin, int width, int height, const float *dark, const float *gain, float scale);
+unsigned int pco_reorder_image_5x12_stats(uint16_t *bufout, uint16_t *bufin, int width, int height, pco_frame_stats *stats);
+unsigned int pco_reorder_image_5x16_stats(uint16_t *bufout, uint16_t *bufin, int width, int height, pco_frame_stats *stats);
+void pco_reorder_image_5x12_stream(uint16_t *bufin, int width, int height, int batch_rows, pco_row_func func, void *user_data);
+void pco_reorder_image_5x16_stream(uint16_t *bufin, int width, int height, int batch_rows, pco_row_func func, void *user_data);
+void pco_reorder_image_5x12_packed(uint8_t *bufout, uint16_t *bufin, int width, int height);
+
+void pco_unpack12(uint16_t *bufout, const uint8_t *bufin, size_t num_pixels);
+void pco_pack12(uint8_t *bufout, const uint16_t *bufin, size_t num_pixels);
+
+unsigned int pco_parse_timestamp(const uint16_t *pixels, int shift, pco_timestamp *timestamp);
+unsigned int pco_parse_timestamp_5x12(const uint16_t *bufin, int shift, pco_timestamp *timestamp);
+void pco_init_frame_tracker(pco_frame_tracker *tracker);
+int64_t pco_track_frame(pco_frame_tracker *tracker, uint32_t frame_number);
+
+unsigned int pco_get_metadata_view(const uint16_t *frame, int width, int height, pco_frame_format format, int shift, pco_metadata_view *view);
+unsigned int pco_parse_metadata(const pco_metadata_view *view, pco_metadata *metadata);
+
+unsigned int pco_get_grabber_config(pco_handle pco, const char **applet, int *cl_type, int *cl_format);
+pco_acquisition pco_acquisition_init(pco_handle pco, int num_buffers);
+void pco_acquisition_destroy(pco_acquisition acq);
+unsigned int pco_acquisition_get_size(pco_acquisition acq, uint32_t *width, uint32_t *height);
+unsigned int pco_acquisition_set_callback(pco_acquisition acq, pco_frame_func func, void *user_data);
+unsigned int pco_acquisition_set_writer(pco_acquisition acq, pco_writer writer);
+unsigned int pco_acquisition_set_timeout(pco_acquisition acq, int seconds);
+unsigned int pco_acquisition_set_raw(pco_acquisition acq, bool raw);
+unsigned int pco_acquisition_set_decoding(pco_acquisition acq, int num_threads, int num_frames);
+unsigned int pco_acquisition_set_drop_policy(pco_acquisition acq, pco_drop_policy policy, int decimation);
+unsigned int pco_acquisition_set_numa_node(pco_acquisition acq, int node);
+unsigned int pco_acquisition_get_placement(pco_acquisition acq, int *node, bool *pinned);
+unsigned int pco_acquisition_start(pco_acquisition acq);
+unsigned int pco_acquisition_stop(pco_acquisition acq);
+unsigned int pco_acquisition_grab(pco_acquisition acq, uint16_t *frame, uint64_t *frame_number);
+unsigned int pco_acquisition_get_frame(pco_acquisition acq, pco_frame *frame);
+unsigned int pco_acquisition_get_counters(pco_acquisition acq, uint64_t *num_frames, uint64_t *num_dropped);
+unsigned int pco_acquisition_get_drop_stats(pco_acquisition acq, pco_drop_stats *stats);
+unsigned int pco_acquisition_get_queue_depths(pco_acquisition acq, uint32_t *num_grabbed, uint32_t *num_decoded);
+unsigned int pco_acquisition_get_buffer_info(pco_acquisition acq, size_t *page_size, bool *locked);
+
+pco_frame pco_frame_ref(pco_frame frame);
+void pco_frame_unref(pco_frame frame);
+const uint16_t *pco_frame_get_data(pco_frame frame);
+unsigned int pco_frame_get_size(pco_frame frame, uint32_t *width, uint32_t *height);
+size_t pco_frame_get_data_size(pco_frame frame);
+pco_frame_format pco_frame_get_format(pco_frame frame);
+uint64_t pco_frame_get_number(pco_frame frame);
+unsigned int pco_frame_get_timestamp(pco_frame frame, pco_timestamp *timestamp);
+
+pco_writer pco_writer_new(const char *prefix, uint64_t max_file_size, size_t max_memory);
+void pco_writer_destroy(pco_writer writer);
+unsigned int pco_writer_write(pco_writer writer, pco_frame frame);
+unsigned int pco_writer_set_info(pco_writer writer, const pco_recording_info *info);
+unsigned int pco_writer_flush(pco_writer writer);
+unsigned int pco_writer_get_counters(pco_writer writer, uint64_t *num_frames, uint64_t *num_bytes, uint64_t *num_dropped);
+unsigned int pco_writer_get_info(pco_writer writer, bool *io_uring, bool *direct);
+
+pco_reader pco_reader_open(const char *filename);
+void pco_reader_close(pco_reader reader);
+unsigned int pco_reader_get_info(pco_reader reader, pco_recording_info *info);
+uint64_t pco_reader_get_num_frames(pco_reader reader);
+unsigned int pco_reader_set_access(pco_reader reader, pco_reader_access access);
+const uint16_t *pco_reader_get_frame(pco_reader reader, uint64_t index);
+unsigned int pco_reader_get_frame_number(pco_reader reader, uint64_t index, uint64_t *number);
+unsigned int pco_reader_get_timestamp(pco_reader reader, uint64_t index, pco_timestamp *timestamp);
+unsigned int pco_reader_find_range(pco_reader reader, const pco_timestamp *begin, const pco_timestamp *end, uint64_t *first, uint64_t *num_frames);
+unsigned int pco_reader_decode_frame(pco_reader reader, uint64_t index, uint16_t *frame);
 
 #endif
@@ -0,0 +1,199 @@
+/* Copyright (C) 2011, 2012 Matthias Vogelgesang <matthias.vogelgesang@kit.edu>
+   (Karlsruhe Institute of Technology)
+
+   This library is free software; you can redistribute it and/or modify it
+   under the terms of the GNU Lesser General Public License as published by the
+   Free Software Foundation; either version 2.1 of the License, or (at your
+   option) any later version.
+
+   This library is distributed in the hope that it will be useful, but WITHOUT
+   ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+   FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+   details.
+
+   You should have received a copy of the GNU Lesser General Public License along
+   with this library; if not, write to the Free Software Foundation, Inc., 51
+   Franklin St, Fifth Floor, Boston, MA 02110, USA */
+
+/*
+ * Metadata blocks. With METADATA_MODE_ON the camera appends a
+ * PCO_METADATA_STRUCT to each frame. Every byte of the structure is stored in
+ * a pixel of its own, so the block is read in place from the frame buffer
+ * rather than copied into the structure.
+ */
+
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "libpco.h"
+#include "sc2_common.h"
+
+#define FIELD(name)  offsetof(PCO_METADATA_STRUCT, name)
+
+static inline uint8_t
+get_byte (const pco_metadata_view *view, size_t offset)
+{
+    return (uint8_t) (view->pixels[offset] >> view->shift);
+}
+
+static inline uint16_t
+get_u16 (const pco_metadata_view *view, size_t offset)
+{
+    return get_byte (view, offset) | (uint16_t) get_byte (view, offset + 1) << 8;
+}
+
+static inline uint32_t
+get_u32 (const pco_metadata_view *view, size_t offset)
+{
+    return get_u16 (view, offset) | (uint32_t) get_u16 (view, offset + 2) << 16;
+}
+
+/*
+ * Convert `count` BCD bytes starting with the least significant one. Returns
+ * false if a digit is not a valid BCD digit.
+ */
+static bool
+get_bcd (const pco_metadata_view *view, size_t offset, int count, uint32_t *value)
+{
+    bool valid = true;
+
+    *value = 0;
+
+    for (int i = count - 1; i >= 0; i--) {
+        const uint8_t bcd = get_byte (view, offset + i);
+
+        valid = valid && (bcd >> 4) <= 9 && (bcd & 0x0F) <= 9;
+        *value = *value * 100 + (bcd >> 4) * 10 + (bcd & 0x0F);
+    }
+
+    return valid;
+}
+
+static inline bool
+has_field (const pco_metadata_view *view, size_t offset, size_t size)
+{
+    return offset + size <= view->size;
+}
+
+/**
+ * Locate the metadata block appended to a frame. The block follows the pixels
+ * of the frame, so the frame grabber has to transfer
+ * (size + width - 1) / width additional lines, where size is returned by
+ * pco_get_metadata_mode(). Nothing is copied, the view refers to the frame
+ * buffer and is only valid as long as it.
+ *
+ * The block is only found in frames with one 16 bit pixel per byte in display
+ * order. pco.edge frames as transferred interleave and, in 5x12 format, pack
+ * the metadata lines like all others. Decode them together with the frame,
+ * i.e. with the height including the metadata lines, and pass the decoded
+ * frame as #PCO_FRAME_FORMAT_GRAY16.
+ *
+ * @param frame Frame with the metadata lines after its last row
+ * @param width Width of the frame in pixels
+ * @param height Height of the frame in pixels without the metadata lines
+ * @param format Format of #frame, only #PCO_FRAME_FORMAT_GRAY16 is accepted
+ * @param shift Number of bits the metadata bytes are shifted to the left
+ * within a pixel, 0 for LSB aligned pixels
+ * @param view Location for the view of the metadata block
+ * @return Error code or PCO_NOERROR. PCO_ERROR_WRONGVALUE is returned for
+ * frames that are not decoded or if there is no valid metadata block after the
+ * frame.
+ * @since 1.1
+ */
+unsigned int
+pco_get_metadata_view (const uint16_t *frame, int width, int height, pco_frame_format format, int shift,
+                       pco_metadata_view *view)
+{
+    if (format != PCO_FRAME_FORMAT_GRAY16) {
+        fprintf (stderr, "Metadata can only be read from decoded frames\n");
+        return PCO_ERROR_WRONGVALUE;
+    }
+
+    view->pixels = frame + (size_t) width * height;
+    view->shift = shift;
+    view->size = get_u16 (view, FIELD(wSize));
+    view->version = get_u16 (view, FIELD(wVersion));
+
+    if (view->size < FIELD(bIMAGE_COUNTER_BCD) || view->version == 0)
+        return PCO_ERROR_WRONGVALUE;
+
+    return PCO_NOERROR;
+}
+
+/**
+ * Parse the fields of a metadata block. Only the pixels of the block are read.
+ * Fields beyond the size of the block, e.g. of an older version, are set to
+ * zero.
+ *
+ * @param view View of the metadata block from pco_get_metadata_view()
+ * @param metadata Location for the parsed metadata
+ * @return Error code or PCO_NOERROR. PCO_ERROR_WRONGVALUE is returned if the
+ * time stamp of the block is not valid BCD.
+ * @since 1.1
+ */
+unsigned int
+pco_parse_metadata (const pco_metadata_view *view, pco_metadata *metadata)
+{
+    uint32_t value;
+    bool valid = true;
+
+    memset (metadata, 0, sizeof(pco_metadata));
+
+    if (has_field (view, FIELD(bIMAGE_TIME_STATUS), 1)) {
+        valid = get_bcd (view, FIELD(bIMAGE_COUNTER_BCD), 4, &value) && valid;
+        metadata->frame_number = value;
+        valid = get_bcd (view, FIELD(bIMAGE_TIME_US_BCD), 3, &value) && valid;
+        metadata->microseconds = value;
+        valid = get_bcd (view, FIELD(bIMAGE_TIME_SEC_BCD), 1, &value) && valid;
+        metadata->second = (uint8_t) value;
+        valid = get_bcd (view, FIELD(bIMAGE_TIME_MIN_BCD), 1, &value) && valid;
+        metadata->minute = (uint8_t) value;
+        valid = get_bcd (view, FIELD(bIMAGE_TIME_HOUR_BCD), 1, &value) && valid;
+        metadata->hour = (uint8_t) value;
+        valid = get_bcd (view, FIELD(bIMAGE_TIME_DAY_BCD), 1, &value) && valid;
+        metadata->day = (uint8_t) value;
+        valid = get_bcd (view, FIELD(bIMAGE_TIME_MON_BCD), 1, &value) && valid;
+        metadata->month = (uint8_t) value;
+        valid = get_bcd (view, FIELD(bIMAGE_TIME_YEAR_BCD), 1, &value) && valid;
+        metadata->year = (uint16_t) (2000 + value);
+        metadata->time_status = get_byte (view, FIELD(bIMAGE_TIME_STATUS));
+    }
+
+    if (has_field (view, FIELD(sSENSOR_TEMPERATURE), 2)) {
+        metadata->exposure_timebase = get_u16 (view, FIELD(wEXPOSURE_TIME_BASE));
+        metadata->exposure_time = get_u32 (view, FIELD(dwEXPOSURE_TIME));
+        metadata->framerate_mhz = get_u32 (view, FIELD(dwFRAMERATE_MILLIHZ));
+        metadata->sensor_temperature = (int16_t) get_u16 (view, FIELD(sSENSOR_TEMPERATURE));
+    }
+
+    if (has_field (view, FIELD(bBINNING_Y), 1)) {
+        metadata->width = get_u16 (view, FIELD(wIMAGE_SIZE_X));
+        metadata->height = get_u16 (view, FIELD(wIMAGE_SIZE_Y));
+        metadata->binning_x = get_byte (view, FIELD(bBINNING_X));
+        metadata->binning_y = get_byte (view, FIELD(bBINNING_Y));
+    }
+
+    if (has_field (view, FIELD(wSENSOR_CONV_FACTOR), 2)) {
+        metadata->readout_frequency = get_u32 (view, FIELD(dwSENSOR_READOUT_FREQUENCY));
+        metadata->conversion_factor = get_u16 (view, FIELD(wSENSOR_CONV_FACTOR));
+    }
+
+    if (has_field (view, FIELD(wDARK_OFFSET), 2)) {
+        metadata->serial_number = get_u32 (view, FIELD(dwCAMERA_SERIAL_NO));
+        metadata->camera_type = get_u16 (view, FIELD(wCAMERA_TYPE));
+        metadata->bit_resolution = get_byte (view, FIELD(bBIT_RESOLUTION));
+        metadata->bit_alignment = get_byte (view, FIELD(bBIT_ALIGNMENT));
+        metadata->dark_offset = get_u16 (view, FIELD(wDARK_OFFSET));
+    }
+
+    if (has_field (view, FIELD(wCOLOR_PATTERN), 2)) {
+        metadata->trigger_mode = get_byte (view, FIELD(bTRIGGER_MODE));
+        metadata->double_image_mode = get_byte (view, FIELD(bDOUBLE_IMAGE_MODE));
+        metadata->sync_mode = get_byte (view, FIELD(bCAMERA_SYNC_MODE));
+        metadata->image_type = get_byte (view, FIELD(bIMAGE_TYPE));
+        metadata->color_pattern = get_u16 (view, FIELD(wCOLOR_PATTERN));
+    }
+
+    return valid ? PCO_NOERROR : PCO_ERROR_WRONGVALUE;
+}
@@ -0,0 +1,180 @@
+/* Copyright (C) 2011, 2012 Matthias Vogelgesang <matthias.vogelgesang@kit.edu>
+   (Karlsruhe Institute of Technology)
+
+   This library is free software; you can redistribute it and/or modify it
+   under the terms of the GNU Lesser General Public License as published by the
+   Free Software Foundation; either version 2.1 of the License, or (at your
+   option) any later version.
+
+   This library is distributed in the hope that it will be useful, but WITHOUT
+   ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+   FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+   details.
+
+   You should have received a copy of the GNU Lesser General Public License along
+   with this library; if not, write to the Free Software Foundation, Inc., 51
+   Franklin St, Fifth Floor, Boston, MA 02110, USA */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/mempolicy.h>
+
+#include "placement.h"
+
+#define PCI_DEVICES             "/sys/bus/pci/devices"
+#define SILICON_SOFTWARE_VENDOR 0x1ae8
+
+static bool
+read_line (const char *path, char *line, size_t size)
+{
+    FILE *fp = fopen (path, "r");
+    bool success;
+
+    if (fp == NULL)
+        return false;
+
+    success = fgets (line, size, fp) != NULL;
+    fclose (fp);
+    return success;
+}
+
+static bool
+is_grabber (const char *device)
+{
+    char path[512];
+    char line[32];
+
+    snprintf (path, sizeof(path), PCI_DEVICES "/%s/vendor", device);
+    return read_line (path, line, sizeof(line)) && strtol (line, NULL, 16) == SILICON_SOFTWARE_VENDOR;
+}
+
+/**
+ * Find the NUMA node of a frame grabber. Boards are numbered in the order of
+ * their PCI addresses, as done by the frame grabber driver.
+ *
+ * @param board Index of the board as passed to Fg_Init()
+ * @return The node or -1 if it is unknown, e.g. on machines with one node
+ */
+int
+pco_placement_find_grabber_node (unsigned int board)
+{
+    struct dirent **devices;
+    char path[512];
+    char line[32];
+    bool found = false;
+    int num_devices;
+    int node = -1;
+
+    num_devices = scandir (PCI_DEVICES, &devices, NULL, alphasort);
+
+    if (num_devices < 0)
+        return -1;
+
+    for (int i = 0; i < num_devices; i++) {
+        const char *device = devices[i]->d_name;
+
+        if (!found && device[0] != '.' && is_grabber (device) && board-- == 0) {
+            found = true;
+            snprintf (path, sizeof(path), PCI_DEVICES "/%s/numa_node", device);
+
+            if (read_line (path, line, sizeof(line)))
+                node = atoi (line);
+        }
+
+        free (devices[i]);
+    }
+
+    free (devices);
+    return node < 0 ? -1 : node;
+}
+
+/**
+ * Get the CPUs of a NUMA node from its CPU list, e.g. "0-7,16-23".
+ *
+ * @return false if the node does not exist
+ */
+bool
+pco_placement_get_node_cpus (int node, cpu_set_t *cpus)
+{
+    char path[128];
+    char line[4096];
+    char *p = line;
+
+    snprintf (path, sizeof(path), "/sys/devices/system/node/node%i/cpulist", node);
+
+    if (node < 0 || !read_line (path, line, sizeof(line)))
+        return false;
+
+    CPU_ZERO (cpus);
+
+    while (*p >= '0' && *p <= '9') {
+        long first = strtol (p, &p, 10);
+        long last = first;
+
+        if (*p == '-')
+            last = strtol (p + 1, &p, 10);
+
+        for (long cpu = first; cpu <= last && cpu < CPU_SETSIZE; cpu++)
+            CPU_SET (cpu, cpus);
+
+        if (*p == ',')
+            p++;
+    }
+
+    return CPU_COUNT (cpus) > 0;
+}
+
+/**
+ * Make memory that the calling thread faults in from now on come from #node if
+ * possible. The policy is per thread, the one it had before is stored in
+ * #saved and must be put back with pco_placement_restore(). Nothing changes
+ * for node -1.
+ *
+ * @return false if the policy could not be set
+ */
+bool
+pco_placement_prefer_node (int node, pco_placement_policy *saved)
+{
+    unsigned long mask[PCO_PLACEMENT_MASK_WORDS] = { 0 };
+
+    saved->valid = false;
+
+    if (node < 0)
+        return true;
+
+    if (node >= PCO_PLACEMENT_MAX_NODES)
+        return false;
+
+    /* Without the previous policy it could not be restored */
+    if (syscall (SYS_get_mempolicy, &saved->mode, saved->mask, PCO_PLACEMENT_MAX_NODES, NULL, 0) != 0)
+        return false;
+
+    mask[node / (8 * sizeof(unsigned long))] = 1UL << (node % (8 * sizeof(unsigned long)));
+
+    if (syscall (SYS_set_mempolicy, MPOL_PREFERRED, mask, PCO_PLACEMENT_MAX_NODES + 1) != 0)
+        return false;
+
+    saved->valid = true;
+    return true;
+}
+
+/**
+ * Put back the memory policy of the calling thread that
+ * pco_placement_prefer_node() replaced.
+ */
+void
+pco_placement_restore (const pco_placement_policy *saved)
+{
+    if (!saved->valid)
+        return;
+
+    /* The mode includes flags such as MPOL_F_STATIC_NODES, which are kept */
+    if (syscall (SYS_set_mempolicy, saved->mode, saved->mask, PCO_PLACEMENT_MAX_NODES + 1) != 0)
+        fprintf (stderr, "Could not restore the memory policy\n");
+}
@@ -0,0 +1,42 @@
+/* Copyright (C) 2011, 2012 Matthias Vogelgesang <matthias.vogelgesang@kit.edu>
+   (Karlsruhe Institute of Technology)
+
+   This library is free software; you can redistribute it and/or modify it
+   under the terms of the GNU Lesser General Public License as published by the
+   Free Software Foundation; either version 2.1 of the License, or (at your
+   option) any later version.
+
+   This library is distributed in the hope that it will be useful, but WITHOUT
+   ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+   FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+   details.
+
+   You should have received a copy of the GNU Lesser General Public License along
+   with this library; if not, write to the Free Software Foundation, Inc., 51
+   Franklin St, Fifth Floor, Boston, MA 02110, USA */
+
+#ifndef __PCO_PLACEMENT_H
+#define __PCO_PLACEMENT_H
+
+#include <stdbool.h>
+#include <sched.h>
+
+/*
+ * NUMA placement of the acquisition. Requires _GNU_SOURCE for cpu_set_t.
+ */
+#define PCO_PLACEMENT_MAX_NODES     1024
+#define PCO_PLACEMENT_MASK_WORDS    (PCO_PLACEMENT_MAX_NODES / (8 * sizeof(unsigned long)))
+
+/* Memory policy of a thread, saved by pco_placement_prefer_node() */
+typedef struct {
+    unsigned long mask[PCO_PLACEMENT_MASK_WORDS];
+    int mode;
+    bool valid;
+} pco_placement_policy;
+
+int pco_placement_find_grabber_node (unsigned int board);
+bool pco_placement_get_node_cpus (int node, cpu_set_t *cpus);
+bool pco_placement_prefer_node (int node, pco_placement_policy *saved);
+void pco_placement_restore (const pco_placement_policy *saved);
+
+#endif
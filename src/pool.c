@@ -0,0 +1,137 @@
+/* Copyright (C) 2011, 2012 Matthias Vogelgesang <matthias.vogelgesang@kit.edu>
+   (Karlsruhe Institute of Technology)
+
+   This library is free software; you can redistribute it and/or modify it
+   under the terms of the GNU Lesser General Public License as published by the
+   Free Software Foundation; either version 2.1 of the License, or (at your
+   option) any later version.
+
+   This library is distributed in the hope that it will be useful, but WITHOUT
+   ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+   FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+   details.
+
+   You should have received a copy of the GNU Lesser General Public License along
+   with this library; if not, write to the Free Software Foundation, Inc., 51
+   Franklin St, Fifth Floor, Boston, MA 02110, USA */
+
+#define _GNU_SOURCE
+
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "pool.h"
+
+#define SLOT_ALIGNMENT  4096
+#define HUGE_PAGE_2MB   (2UL << 20)
+#define HUGE_PAGE_1GB   (1UL << 30)
+
+#ifndef MAP_HUGE_SHIFT
+#define MAP_HUGE_SHIFT  26
+#endif
+
+static size_t
+round_up (size_t size, size_t multiple)
+{
+    return (size + multiple - 1) / multiple * multiple;
+}
+
+static void *
+map_pages (size_t size, int flags)
+{
+    void *memory = mmap (NULL, size, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS | flags, -1, 0);
+
+    return memory == MAP_FAILED ? NULL : memory;
+}
+
+#ifdef MAP_HUGETLB
+/*
+ * Huge pages must be reserved by the administrator, e.g. through
+ * /proc/sys/vm/nr_hugepages, so mapping them fails on most systems. They are
+ * not used if rounding up to whole pages would waste more than an eighth of
+ * the pool.
+ */
+static bool
+map_huge_pages (pco_pool *pool, size_t size, size_t page_size, int page_shift)
+{
+    size_t mapped_size = round_up (size, page_size);
+
+    if (mapped_size - size > size / 8)
+        return false;
+
+    pool->memory = map_pages (mapped_size, MAP_HUGETLB | MAP_POPULATE | (page_shift << MAP_HUGE_SHIFT));
+
+    if (pool->memory == NULL)
+        return false;
+
+    pool->mapped_size = mapped_size;
+    pool->page_size = page_size;
+    return true;
+}
+#endif
+
+/**
+ * Map memory for #num_slots slots of at least #slot_size bytes. 1 GB and 2 MB
+ * huge pages are tried first, then regular pages, for which transparent huge
+ * pages are requested. The memory is pre-faulted and, if the memory lock limit
+ * permits, locked.
+ *
+ * @return false if no memory could be mapped
+ */
+bool
+pco_pool_init (pco_pool *pool, size_t slot_size, uint32_t num_slots)
+{
+    size_t size;
+
+    memset (pool, 0, sizeof(pco_pool));
+
+    if (slot_size == 0 || num_slots == 0)
+        return false;
+
+    pool->slot_size = round_up (slot_size, SLOT_ALIGNMENT);
+    pool->num_slots = num_slots;
+    size = pool->slot_size * num_slots;
+
+#ifdef MAP_HUGETLB
+    if (!map_huge_pages (pool, size, HUGE_PAGE_1GB, 30))
+        map_huge_pages (pool, size, HUGE_PAGE_2MB, 21);
+#endif
+
+    if (pool->memory == NULL) {
+        pool->mapped_size = round_up (size, (size_t) sysconf (_SC_PAGESIZE));
+        pool->page_size = (size_t) sysconf (_SC_PAGESIZE);
+        pool->memory = map_pages (pool->mapped_size, 0);
+
+        if (pool->memory == NULL)
+            return false;
+
+        /* Ask for transparent huge pages before the pages are faulted in */
+#ifdef MADV_HUGEPAGE
+        madvise (pool->memory, pool->mapped_size, MADV_HUGEPAGE);
+#endif
+    }
+
+    /* Fault in every page now rather than while decoding */
+    for (size_t offset = 0; offset < pool->mapped_size; offset += pool->page_size)
+        pool->memory[offset] = 0;
+
+    pool->locked = mlock (pool->memory, pool->mapped_size) == 0;
+    return true;
+}
+
+void
+pco_pool_free (pco_pool *pool)
+{
+    if (pool->memory != NULL)
+        munmap (pool->memory, pool->mapped_size);
+
+    memset (pool, 0, sizeof(pco_pool));
+}
+
+void *
+pco_pool_get_slot (pco_pool *pool, uint32_t index)
+{
+    return pool->memory + index * pool->slot_size;
+}
@@ -0,0 +1,43 @@
+/* Copyright (C) 2011, 2012 Matthias Vogelgesang <matthias.vogelgesang@kit.edu>
+   (Karlsruhe Institute of Technology)
+
+   This library is free software; you can redistribute it and/or modify it
+   under the terms of the GNU Lesser General Public License as published by the
+   Free Software Foundation; either version 2.1 of the License, or (at your
+   option) any later version.
+
+   This library is distributed in the hope that it will be useful, but WITHOUT
+   ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+   FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+   details.
+
+   You should have received a copy of the GNU Lesser General Public License along
+   with this library; if not, write to the Free Software Foundation, Inc., 51
+   Franklin St, Fifth Floor, Boston, MA 02110, USA */
+
+#ifndef __PCO_POOL_H
+#define __PCO_POOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Fixed-size frame slots in one mapping that is backed by huge pages when
+ * possible, pre-faulted and locked into memory. Slots are recycled by the
+ * owner, the memory is only returned to the system by pco_pool_free().
+ */
+typedef struct {
+    uint8_t *memory;
+    size_t mapped_size;
+    size_t slot_size;       /* distance between slots, a multiple of 4 KB */
+    size_t page_size;       /* size of the pages backing the mapping */
+    uint32_t num_slots;
+    bool locked;
+} pco_pool;
+
+bool pco_pool_init (pco_pool *pool, size_t slot_size, uint32_t num_slots);
+void pco_pool_free (pco_pool *pool);
+void *pco_pool_get_slot (pco_pool *pool, uint32_t index);
+
+#endif
@@ -0,0 +1,354 @@
+/* Copyright (C) 2011, 2012 Matthias Vogelgesang <matthias.vogelgesang@kit.edu>
+   (Karlsruhe Institute of Technology)
+
+   This library is free software; you can redistribute it and/or modify it
+   under the terms of the GNU Lesser General Public License as published by the
+   Free Software Foundation; either version 2.1 of the License, or (at your
+   option) any later version.
+
+   This library is distributed in the hope that it will be useful, but WITHOUT
+   ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+   FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+   details.
+
+   You should have received a copy of the GNU Lesser General Public License along
+   with this library; if not, write to the Free Software Foundation, Inc., 51
+   Franklin St, Fifth Floor, Boston, MA 02110, USA */
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdlib.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "queue.h"
+
+#define CACHE_LINE_SIZE 64
+
+/*
+ * Head and tail are written by different threads and are kept on cache lines
+ * of their own. The structure is packed, the padding is therefore explicit.
+ */
+struct pco_queue_t {
+    uint64_t *values;
+    uint64_t *sequences;    /* NULL for single producer, single consumer */
+    uint32_t mask;
+    uint32_t capacity;
+    uint8_t pad0[CACHE_LINE_SIZE - 24];
+
+    uint64_t head;          /* next position to pop */
+    uint8_t pad1[CACHE_LINE_SIZE - 8];
+
+    uint64_t tail;          /* next position to push */
+    uint8_t pad2[CACHE_LINE_SIZE - 8];
+
+    /* Only taken while a consumer waits, see pco_queue_pop_wait() */
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    uint32_t num_waiters;
+    bool closed;
+};
+
+/**
+ * Create a queue for at least #capacity values. The capacity is rounded up to
+ * the next power of two.
+ *
+ * @param capacity Number of values the queue must hold
+ * @param concurrent true if more than one thread pushes or pops
+ * @return A new queue or NULL
+ */
+pco_queue *
+pco_queue_new (uint32_t capacity, bool concurrent)
+{
+    pthread_condattr_t attr;
+    pco_queue *queue;
+    uint32_t size = 1;
+
+    if (capacity == 0 || capacity > (1U << 31))
+        return NULL;
+
+    while (size < capacity)
+        size <<= 1;
+
+    if (posix_memalign ((void **) &queue, CACHE_LINE_SIZE, sizeof(pco_queue)))
+        return NULL;
+
+    /* Timeouts must not depend on changes of the wall clock */
+    pthread_condattr_init (&attr);
+    pthread_condattr_setclock (&attr, CLOCK_MONOTONIC);
+    pthread_mutex_init (&queue->lock, NULL);
+    pthread_cond_init (&queue->cond, &attr);
+    pthread_condattr_destroy (&attr);
+    queue->num_waiters = 0;
+    queue->closed = false;
+    queue->values = (uint64_t *) malloc (size * sizeof(uint64_t));
+    queue->sequences = NULL;
+    queue->mask = size - 1;
+    queue->capacity = size;
+    queue->head = 0;
+    queue->tail = 0;
+
+    if (concurrent) {
+        queue->sequences = (uint64_t *) malloc (size * sizeof(uint64_t));
+
+        if (queue->sequences != NULL) {
+            for (uint32_t i = 0; i < size; i++)
+                queue->sequences[i] = i;
+        }
+    }
+
+    if (queue->values == NULL || (concurrent && queue->sequences == NULL)) {
+        pco_queue_free (queue);
+        return NULL;
+    }
+
+    return queue;
+}
+
+void
+pco_queue_free (pco_queue *queue)
+{
+    if (queue == NULL)
+        return;
+
+    pthread_cond_destroy (&queue->cond);
+    pthread_mutex_destroy (&queue->lock);
+    free (queue->values);
+    free (queue->sequences);
+    free (queue);
+}
+
+static bool
+push_single (pco_queue *queue, uint64_t value)
+{
+    uint64_t tail = __atomic_load_n (&queue->tail, __ATOMIC_RELAXED);
+
+    if (tail - __atomic_load_n (&queue->head, __ATOMIC_ACQUIRE) == queue->capacity)
+        return false;
+
+    queue->values[tail & queue->mask] = value;
+    __atomic_store_n (&queue->tail, tail + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+static uint32_t
+pop_single (pco_queue *queue, uint64_t *values, uint32_t max_values)
+{
+    uint64_t head = __atomic_load_n (&queue->head, __ATOMIC_RELAXED);
+    uint64_t available = __atomic_load_n (&queue->tail, __ATOMIC_ACQUIRE) - head;
+    uint32_t n = available < max_values ? (uint32_t) available : max_values;
+
+    for (uint32_t i = 0; i < n; i++)
+        values[i] = queue->values[(head + i) & queue->mask];
+
+    __atomic_store_n (&queue->head, head + n, __ATOMIC_RELEASE);
+    return n;
+}
+
+/*
+ * A cell at position pos is free for the producer when its sequence is pos and
+ * holds a value for the consumer when its sequence is pos + 1. Popping sets
+ * the sequence to pos + capacity, the position of the next lap.
+ */
+static bool
+push_concurrent (pco_queue *queue, uint64_t value)
+{
+    uint64_t pos = __atomic_load_n (&queue->tail, __ATOMIC_RELAXED);
+
+    for (;;) {
+        uint64_t seq = __atomic_load_n (&queue->sequences[pos & queue->mask], __ATOMIC_ACQUIRE);
+        int64_t diff = (int64_t) (seq - pos);
+
+        if (diff == 0) {
+            if (__atomic_compare_exchange_n (&queue->tail, &pos, pos + 1, true,
+                                             __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+                break;
+        }
+        else if (diff < 0)
+            return false;
+        else
+            pos = __atomic_load_n (&queue->tail, __ATOMIC_RELAXED);
+    }
+
+    queue->values[pos & queue->mask] = value;
+    __atomic_store_n (&queue->sequences[pos & queue->mask], pos + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+static uint32_t
+pop_concurrent (pco_queue *queue, uint64_t *values, uint32_t max_values)
+{
+    uint64_t pos = __atomic_load_n (&queue->head, __ATOMIC_RELAXED);
+
+    for (;;) {
+        uint32_t n = 0;
+
+        /* Claim the run of filled cells at the head in one step */
+        while (n < max_values && n < queue->capacity &&
+               __atomic_load_n (&queue->sequences[(pos + n) & queue->mask], __ATOMIC_ACQUIRE) == pos + n + 1)
+            n++;
+
+        if (n == 0) {
+            uint64_t seq = __atomic_load_n (&queue->sequences[pos & queue->mask], __ATOMIC_ACQUIRE);
+
+            if ((int64_t) (seq - (pos + 1)) < 0)
+                return 0;
+
+            pos = __atomic_load_n (&queue->head, __ATOMIC_RELAXED);
+            continue;
+        }
+
+        if (__atomic_compare_exchange_n (&queue->head, &pos, pos + n, true,
+                                         __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+            for (uint32_t i = 0; i < n; i++) {
+                uint64_t cell = (pos + i) & queue->mask;
+
+                values[i] = queue->values[cell];
+                __atomic_store_n (&queue->sequences[cell], pos + i + queue->capacity, __ATOMIC_RELEASE);
+            }
+
+            return n;
+        }
+    }
+}
+
+/*
+ * A waiting consumer announces itself before it checks the queue for the last
+ * time, a producer checks for waiters after it has published its value. The
+ * full fences on both sides make sure that at least one of them sees the
+ * other, so that no wakeup is lost.
+ */
+static void
+wake_waiter (pco_queue *queue)
+{
+    __atomic_thread_fence (__ATOMIC_SEQ_CST);
+
+    if (__atomic_load_n (&queue->num_waiters, __ATOMIC_RELAXED) == 0)
+        return;
+
+    pthread_mutex_lock (&queue->lock);
+    pthread_cond_signal (&queue->cond);
+    pthread_mutex_unlock (&queue->lock);
+}
+
+/**
+ * Append a value to the queue and wake up a consumer waiting in
+ * pco_queue_pop_wait().
+ *
+ * @return false if the queue is full
+ */
+bool
+pco_queue_push (pco_queue *queue, uint64_t value)
+{
+    bool pushed;
+
+    if (queue->sequences == NULL)
+        pushed = push_single (queue, value);
+    else
+        pushed = push_concurrent (queue, value);
+
+    if (pushed)
+        wake_waiter (queue);
+
+    return pushed;
+}
+
+/**
+ * Take up to #max_values values from the queue without waiting.
+ *
+ * @return Number of values stored in #values, 0 if the queue is empty
+ */
+uint32_t
+pco_queue_pop (pco_queue *queue, uint64_t *values, uint32_t max_values)
+{
+    if (queue->sequences == NULL)
+        return pop_single (queue, values, max_values);
+
+    return pop_concurrent (queue, values, max_values);
+}
+
+/**
+ * Return the number of values in the queue. The result is only a snapshot
+ * while other threads push or pop.
+ */
+uint32_t
+pco_queue_get_depth (pco_queue *queue)
+{
+    uint64_t head = __atomic_load_n (&queue->head, __ATOMIC_RELAXED);
+    uint64_t tail = __atomic_load_n (&queue->tail, __ATOMIC_RELAXED);
+
+    if (tail <= head)
+        return 0;
+
+    return tail - head > queue->capacity ? queue->capacity : (uint32_t) (tail - head);
+}
+
+uint32_t
+pco_queue_get_capacity (pco_queue *queue)
+{
+    return queue->capacity;
+}
+
+/**
+ * Take up to #max_values values from the queue, waiting until there is at
+ * least one. A consumer that does not find a value sleeps until a producer
+ * pushes one, the queue is closed or the timeout expires.
+ *
+ * @param timeout_ms Time to wait in milliseconds, negative to wait until a
+ * value arrives or the queue is closed
+ * @return Number of values stored in #values, 0 on timeout or if the queue is
+ * closed and empty
+ */
+uint32_t
+pco_queue_pop_wait (pco_queue *queue, uint64_t *values, uint32_t max_values, int timeout_ms)
+{
+    struct timespec deadline;
+    uint32_t n;
+    int err = 0;
+
+    n = pco_queue_pop (queue, values, max_values);
+
+    if (n > 0 || timeout_ms == 0)
+        return n;
+
+    if (timeout_ms > 0) {
+        clock_gettime (CLOCK_MONOTONIC, &deadline);
+        deadline.tv_sec += timeout_ms / 1000;
+        deadline.tv_nsec += (long) (timeout_ms % 1000) * 1000000;
+
+        if (deadline.tv_nsec >= 1000000000) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000;
+        }
+    }
+
+    pthread_mutex_lock (&queue->lock);
+    __atomic_fetch_add (&queue->num_waiters, 1, __ATOMIC_SEQ_CST);
+    __atomic_thread_fence (__ATOMIC_SEQ_CST);
+
+    while ((n = pco_queue_pop (queue, values, max_values)) == 0 && !queue->closed && err != ETIMEDOUT) {
+        if (timeout_ms > 0)
+            err = pthread_cond_timedwait (&queue->cond, &queue->lock, &deadline);
+        else
+            pthread_cond_wait (&queue->cond, &queue->lock);
+    }
+
+    __atomic_fetch_sub (&queue->num_waiters, 1, __ATOMIC_RELAXED);
+    pthread_mutex_unlock (&queue->lock);
+    return n;
+}
+
+/**
+ * Close or reopen the queue. Values can still be pushed and popped while the
+ * queue is closed, but pco_queue_pop_wait() does not wait anymore. Closing
+ * wakes up all waiting consumers.
+ */
+void
+pco_queue_set_closed (pco_queue *queue, bool closed)
+{
+    pthread_mutex_lock (&queue->lock);
+    queue->closed = closed;
+    pthread_cond_broadcast (&queue->cond);
+    pthread_mutex_unlock (&queue->lock);
+}
@@ -0,0 +1,43 @@
+/* Copyright (C) 2011, 2012 Matthias Vogelgesang <matthias.vogelgesang@kit.edu>
+   (Karlsruhe Institute of Technology)
+
+   This library is free software; you can redistribute it and/or modify it
+   under the terms of the GNU Lesser General Public License as published by the
+   Free Software Foundation; either version 2.1 of the License, or (at your
+   option) any later version.
+
+   This library is distributed in the hope that it will be useful, but WITHOUT
+   ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+   FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+   details.
+
+   You should have received a copy of the GNU Lesser General Public License along
+   with this library; if not, write to the Free Software Foundation, Inc., 51
+   Franklin St, Fifth Floor, Boston, MA 02110, USA */
+
+#ifndef __PCO_QUEUE_H
+#define __PCO_QUEUE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Bounded lock-free ring queue of 64 bit values, used to pass frame and buffer
+ * indices between the stages of an acquisition. Queues created for a single
+ * producer and a single consumer only exchange head and tail, otherwise each
+ * cell carries a sequence number so that several threads can push and pop
+ * concurrently. Consumers can wait for values with pco_queue_pop_wait(), a
+ * producer then only takes a lock if a consumer is actually waiting.
+ */
+typedef struct pco_queue_t pco_queue;
+
+pco_queue *pco_queue_new (uint32_t capacity, bool concurrent);
+void pco_queue_free (pco_queue *queue);
+bool pco_queue_push (pco_queue *queue, uint64_t value);
+uint32_t pco_queue_pop (pco_queue *queue, uint64_t *values, uint32_t max_values);
+uint32_t pco_queue_get_depth (pco_queue *queue);
+uint32_t pco_queue_get_capacity (pco_queue *queue);
+uint32_t pco_queue_pop_wait (pco_queue *queue, uint64_t *values, uint32_t max_values, int timeout_ms);
+void pco_queue_set_closed (pco_queue *queue, bool closed);
+
+#endif
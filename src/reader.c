@@ -0,0 +1,458 @@
+/* Copyright (C) 2011, 2012 Matthias Vogelgesang <matthias.vogelgesang@kit.edu>
+   (Karlsruhe Institute of Technology)
+
+   This library is free software; you can redistribute it and/or modify it
+   under the terms of the GNU Lesser General Public License as published by the
+   Free Software Foundation; either version 2.1 of the License, or (at your
+   option) any later version.
+
+   This library is distributed in the hope that it will be useful, but WITHOUT
+   ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+   FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+   details.
+
+   You should have received a copy of the GNU Lesser General Public License along
+   with this library; if not, write to the Free Software Foundation, Inc., 51
+   Franklin St, Fifth Floor, Boston, MA 02110, USA */
+
+/*
+ * Reader for the recordings of pco_writer. The whole file is mapped and frames
+ * are handed out as pointers into the mapping, so reading a frame costs no
+ * more than the page faults bringing it in. The index is used for frame
+ * numbers and time stamps only, frames are found at their fixed stride.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "libpco.h"
+#include "recording.h"
+
+/*
+ * Positions by which frames decoded by several threads can be away from their
+ * place in order, see FRAME_BATCH_SIZE and MAX_DECODE_THREADS in acquisition.c
+ */
+#define MAX_DISORDER    128
+
+struct pco_reader_t {
+    uint8_t *map;
+    size_t size;
+    const pco_recording_header *header;
+    const pco_recording_record *records;
+    uint64_t num_frames;
+    pco_reader_access access;
+};
+
+/*
+ * Microseconds since the epoch, for comparing time stamps. Days are counted
+ * with the usual proleptic Gregorian calendar arithmetic.
+ */
+static uint64_t
+get_timestamp_key (const pco_timestamp *timestamp)
+{
+    int64_t year = timestamp->year - (timestamp->month <= 2);
+    int64_t era = (year >= 0 ? year : year - 399) / 400;
+    int64_t year_of_era = year - era * 400;
+    int64_t day_of_year = (153 * (timestamp->month + (timestamp->month > 2 ? -3 : 9)) + 2) / 5 + timestamp->day - 1;
+    int64_t day_of_era = year_of_era * 365 + year_of_era / 4 - year_of_era / 100 + day_of_year;
+    int64_t days = era * 146097 + day_of_era - 719468;
+    int64_t seconds = days * 86400 + timestamp->hour * 3600 + timestamp->minute * 60 + timestamp->second;
+
+    return (uint64_t) seconds * 1000000 + timestamp->microseconds;
+}
+
+static bool
+is_valid (pco_reader reader)
+{
+    const pco_recording_header *header;
+    const pco_recording_trailer *trailer;
+    uint64_t index_size;
+
+    if (reader->size < sizeof(pco_recording_header) + sizeof(pco_recording_trailer))
+        return false;
+
+    header = (const pco_recording_header *) reader->map;
+    trailer = (const pco_recording_trailer *) (reader->map + reader->size - sizeof(pco_recording_trailer));
+
+    if (memcmp (header->magic, PCO_RECORDING_MAGIC, sizeof(header->magic)) != 0 ||
+        header->version != PCO_RECORDING_VERSION ||
+        header->header_size < sizeof(pco_recording_header) ||
+        header->header_size % PCO_RECORDING_ALIGNMENT != 0 ||
+        header->frame_stride < header->frame_size || header->frame_stride == 0)
+        return false;
+
+    /* Without trailer the file was not closed and its index is missing */
+    if (memcmp (trailer->magic, PCO_RECORDING_INDEX_MAGIC, sizeof(trailer->magic)) != 0)
+        return false;
+
+    /* Bound the offsets and counts by the file size so that the sums below cannot wrap */
+    if (trailer->num_frames > reader->size / sizeof(pco_recording_record) ||
+        trailer->index_offset > reader->size ||
+        trailer->index_offset < header->header_size)
+        return false;
+
+    index_size = trailer->num_frames * sizeof(pco_recording_record);
+
+    if (trailer->index_offset + index_size + sizeof(pco_recording_trailer) != reader->size ||
+        trailer->num_frames > (trailer->index_offset - header->header_size) / header->frame_stride)
+        return false;
+
+    reader->header = header;
+    reader->records = (const pco_recording_record *) (reader->map + trailer->index_offset);
+    reader->num_frames = trailer->num_frames;
+    return true;
+}
+
+/**
+ * Open a recording written by a #pco_writer. The file is mapped into memory
+ * and frames are read as they are accessed.
+ *
+ * @param filename Name of a .pcoraw file
+ * @return A new #pco_reader or NULL on error
+ * @since 1.1
+ */
+pco_reader
+pco_reader_open (const char *filename)
+{
+    pco_reader reader;
+    struct stat st;
+    int fd;
+
+    fd = open (filename, O_RDONLY);
+
+    if (fd < 0) {
+        fprintf (stderr, "Could not open %s: %s\n", filename, strerror (errno));
+        return NULL;
+    }
+
+    reader = (pco_reader) calloc (1, sizeof(struct pco_reader_t));
+
+    if (reader == NULL || fstat (fd, &st) != 0 || st.st_size == 0)
+        goto no_reader;
+
+    reader->size = (size_t) st.st_size;
+    reader->map = (uint8_t *) mmap (NULL, reader->size, PROT_READ, MAP_SHARED, fd, 0);
+
+    if (reader->map == MAP_FAILED) {
+        reader->map = NULL;
+        goto no_reader;
+    }
+
+    if (!is_valid (reader)) {
+        fprintf (stderr, "%s is not a complete recording\n", filename);
+        goto no_reader;
+    }
+
+    /* The mapping stays valid without the descriptor */
+    close (fd);
+    pco_reader_set_access (reader, PCO_READER_ACCESS_SEQUENTIAL);
+    return reader;
+
+no_reader:
+    close (fd);
+    pco_reader_close (reader);
+    return NULL;
+}
+
+/**
+ * Unmap the recording. Frames returned by pco_reader_get_frame() become
+ * invalid.
+ *
+ * @param reader A #pco_reader
+ * @since 1.1
+ */
+void
+pco_reader_close (pco_reader reader)
+{
+    if (reader == NULL)
+        return;
+
+    if (reader->map != NULL)
+        munmap (reader->map, reader->size);
+
+    free (reader);
+}
+
+/**
+ * Get the description of the camera and the frames of the recording.
+ *
+ * @param reader A #pco_reader
+ * @param info Location for the description
+ * @return Error code or PCO_NOERROR.
+ * @since 1.1
+ */
+unsigned int
+pco_reader_get_info (pco_reader reader, pco_recording_info *info)
+{
+    *info = reader->header->info;
+    return PCO_NOERROR;
+}
+
+/**
+ * Get the number of frames in the recording.
+ *
+ * @param reader A #pco_reader
+ * @return Number of frames
+ * @since 1.1
+ */
+uint64_t
+pco_reader_get_num_frames (pco_reader reader)
+{
+    return reader->num_frames;
+}
+
+/**
+ * Tell the kernel how the frames will be read. Sequential access reads ahead
+ * and drops pages once they were read, random access reads each frame in one
+ * go but nothing beyond it. Sequential access is the default.
+ *
+ * @param reader A #pco_reader
+ * @param access The expected #pco_reader_access
+ * @return Error code or PCO_NOERROR.
+ * @since 1.1
+ */
+unsigned int
+pco_reader_set_access (pco_reader reader, pco_reader_access access)
+{
+    uint8_t *index;
+    int advice;
+
+    switch (access) {
+        case PCO_READER_ACCESS_SEQUENTIAL:
+            advice = MADV_SEQUENTIAL;
+            break;
+        case PCO_READER_ACCESS_RANDOM:
+            advice = MADV_RANDOM;
+            break;
+        default:
+            return PCO_ERROR_WRONGVALUE;
+    }
+
+    if (madvise (reader->map, reader->size, advice) != 0)
+        return PCO_ERROR_WRONGVALUE;
+
+    /* The index is small and used for every lookup */
+    index = (uint8_t *) ((uintptr_t) reader->records & ~(uintptr_t) (PCO_RECORDING_ALIGNMENT - 1));
+    madvise (index, reader->map + reader->size - index, MADV_WILLNEED);
+
+    reader->access = access;
+    return PCO_NOERROR;
+}
+
+static const uint8_t *
+get_frame_data (pco_reader reader, uint64_t index)
+{
+    return reader->map + reader->header->header_size + index * reader->header->frame_stride;
+}
+
+static void
+advise_frame (pco_reader reader, uint64_t index)
+{
+    /* Frames are page aligned, the last one may be shorter than the stride */
+    madvise ((void *) get_frame_data (reader, index), reader->header->frame_size, MADV_WILLNEED);
+}
+
+/**
+ * Get a frame of the recording without copying it. The frame is in the format
+ * given by pco_reader_get_info() and stays valid until the reader is closed.
+ *
+ * @param reader A #pco_reader
+ * @param index Position of the frame in the recording, from 0
+ * @return Pointer to the frame or NULL if it does not exist or could not be
+ * written
+ * @since 1.1
+ */
+const uint16_t *
+pco_reader_get_frame (pco_reader reader, uint64_t index)
+{
+    if (index >= reader->num_frames || (reader->records[index].flags & PCO_RECORD_MISSING))
+        return NULL;
+
+    /* Fault in the whole frame at once, or the next one while this is used */
+    if (reader->access == PCO_READER_ACCESS_RANDOM)
+        advise_frame (reader, index);
+    else if (index + 1 < reader->num_frames)
+        advise_frame (reader, index + 1);
+
+    return (const uint16_t *) get_frame_data (reader, index);
+}
+
+/**
+ * Get the number the acquisition gave a frame.
+ *
+ * @param reader A #pco_reader
+ * @param index Position of the frame in the recording, from 0
+ * @param number Location for the frame number
+ * @return Error code or PCO_NOERROR.
+ * @since 1.1
+ */
+unsigned int
+pco_reader_get_frame_number (pco_reader reader, uint64_t index, uint64_t *number)
+{
+    if (index >= reader->num_frames)
+        return PCO_ERROR_WRONGVALUE;
+
+    *number = reader->records[index].number;
+    return PCO_NOERROR;
+}
+
+/**
+ * Get the time stamp of a frame.
+ *
+ * @param reader A #pco_reader
+ * @param index Position of the frame in the recording, from 0
+ * @param timestamp Location for the time stamp
+ * @return Error code or PCO_NOERROR. PCO_ERROR_WRONGVALUE is returned if the
+ * frame has no time stamp.
+ * @since 1.1
+ */
+unsigned int
+pco_reader_get_timestamp (pco_reader reader, uint64_t index, pco_timestamp *timestamp)
+{
+    if (index >= reader->num_frames || !(reader->records[index].flags & PCO_RECORD_HAS_TIMESTAMP))
+        return PCO_ERROR_WRONGVALUE;
+
+    *timestamp = reader->records[index].timestamp;
+    return PCO_NOERROR;
+}
+
+static bool
+is_in_range (const pco_recording_record *record, uint64_t begin_key, uint64_t end_key)
+{
+    uint64_t key;
+
+    if (!(record->flags & PCO_RECORD_HAS_TIMESTAMP))
+        return false;
+
+    key = get_timestamp_key (&record->timestamp);
+    return key >= begin_key && key < end_key;
+}
+
+/*
+ * Binary search for the first frame taken at or after #key. The index is in
+ * the order of the frame numbers and thus of the time stamps, except for frames
+ * decoded out of order. Frames without time stamp are skipped in favour of the
+ * next one with a time stamp.
+ */
+static uint64_t
+find_position (pco_reader reader, uint64_t key)
+{
+    uint64_t low = 0;
+    uint64_t high = reader->num_frames;
+
+    while (low < high) {
+        uint64_t mid = low + (high - low) / 2;
+        uint64_t i = mid;
+
+        while (i < high && !(reader->records[i].flags & PCO_RECORD_HAS_TIMESTAMP))
+            i++;
+
+        if (i < high && get_timestamp_key (&reader->records[i].timestamp) < key)
+            low = i + 1;
+        else
+            high = mid;
+    }
+
+    return low;
+}
+
+/**
+ * Find the frames taken from #begin up to but not including #end. Frames
+ * decoded by several threads may have been recorded slightly out of order, so
+ * the range can contain a few frames from outside the time span, their time
+ * stamps tell them apart.
+ *
+ * @param reader A #pco_reader
+ * @param begin Earliest time stamp
+ * @param end Time stamp after the latest frame
+ * @param first Location for the index of the first frame
+ * @param num_frames Location for the number of frames in the range, 0 if no
+ * frame was taken in the time span
+ * @return Error code or PCO_NOERROR.
+ * @since 1.1
+ */
+unsigned int
+pco_reader_find_range (pco_reader reader, const pco_timestamp *begin, const pco_timestamp *end,
+                       uint64_t *first, uint64_t *num_frames)
+{
+    uint64_t begin_key = get_timestamp_key (begin);
+    uint64_t end_key = get_timestamp_key (end);
+    uint64_t low = find_position (reader, begin_key);
+    uint64_t high = find_position (reader, end_key);
+    uint64_t scan_begin = low > MAX_DISORDER ? low - MAX_DISORDER : 0;
+    uint64_t scan_end = high > low ? high : low;
+
+    scan_end = reader->num_frames - scan_end > MAX_DISORDER ? scan_end + MAX_DISORDER : reader->num_frames;
+    *first = 0;
+    *num_frames = 0;
+
+    /* Out of order frames are found close to where the searches ended */
+    while (scan_begin < scan_end && !is_in_range (&reader->records[scan_begin], begin_key, end_key))
+        scan_begin++;
+
+    if (scan_begin == scan_end)
+        return PCO_NOERROR;
+
+    while (!is_in_range (&reader->records[scan_end - 1], begin_key, end_key))
+        scan_end--;
+
+    *first = scan_begin;
+    *num_frames = scan_end - scan_begin;
+
+    return PCO_NOERROR;
+}
+
+/**
+ * Decode a frame into display order. Raw pco.edge frames are re-ordered with
+ * the same functions used while acquiring, other frames are copied.
+ *
+ * @param reader A #pco_reader
+ * @param index Position of the frame in the recording, from 0
+ * @param frame Memory for width * height 16 bit pixels
+ * @return Error code or PCO_NOERROR.
+ * @since 1.1
+ */
+unsigned int
+pco_reader_decode_frame (pco_reader reader, uint64_t index, uint16_t *frame)
+{
+    const uint16_t *data = pco_reader_get_frame (reader, index);
+    int width = (int) reader->header->info.width;
+    int height = (int) reader->header->info.height;
+    size_t size;
+
+    if (data == NULL)
+        return PCO_ERROR_WRONGVALUE;
+
+    switch (reader->header->info.format) {
+        case PCO_FRAME_FORMAT_GRAY16:
+        case PCO_FRAME_FORMAT_EDGE_5X16:
+            size = (size_t) width * height * sizeof(uint16_t);
+            break;
+        case PCO_FRAME_FORMAT_EDGE_5X12:
+            size = pco_get_raw_pitch_5x12 (width) * height;
+            break;
+        default:
+            return PCO_ERROR_WRONGVALUE;
+    }
+
+    if (size > reader->header->frame_size)
+        return PCO_ERROR_WRONGVALUE;
+
+    /* The re-order functions only read their input */
+    if (reader->header->info.format == PCO_FRAME_FORMAT_EDGE_5X12)
+        pco_reorder_image_5x12 (frame, (uint16_t *) data, width, height);
+    else if (reader->header->info.format == PCO_FRAME_FORMAT_EDGE_5X16)
+        pco_reorder_image_5x16 (frame, (uint16_t *) data, width, height);
+    else
+        memcpy (frame, data, size);
+
+    return PCO_NOERROR;
+}
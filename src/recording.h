@@ -0,0 +1,77 @@
+/* Copyright (C) 2011, 2012 Matthias Vogelgesang <matthias.vogelgesang@kit.edu>
+   (Karlsruhe Institute of Technology)
+
+   This library is free software; you can redistribute it and/or modify it
+   under the terms of the GNU Lesser General Public License as published by the
+   Free Software Foundation; either version 2.1 of the License, or (at your
+   option) any later version.
+
+   This library is distributed in the hope that it will be useful, but WITHOUT
+   ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+   FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+   details.
+
+   You should have received a copy of the GNU Lesser General Public License along
+   with this library; if not, write to the Free Software Foundation, Inc., 51
+   Franklin St, Fifth Floor, Boston, MA 02110, USA */
+
+#ifndef __PCO_RECORDING_H
+#define __PCO_RECORDING_H
+
+#include <stdint.h>
+
+#include "libpco.h"
+
+/*
+ * On-disk layout of the recordings written by pco_writer. All values are
+ * stored in host byte order, i.e. little endian.
+ *
+ *  offset 0            pco_recording_header, padded to header_size
+ *  header_size         frame 0, padded to frame_stride
+ *  + i * frame_stride  frame i
+ *  index_offset        num_frames pco_recording_record
+ *  end - 24            pco_recording_trailer
+ *
+ * Frames are written at a fixed stride that is a multiple of the page size, so
+ * frame i is found without reading the index and can be mapped directly. The
+ * index and trailer are appended when the file is closed, nothing written
+ * before is ever rewritten. A file without trailer was not closed properly.
+ * Its space was reserved up front, so neither its size nor its contents tell
+ * how many frames were written, and pco_reader_open() rejects it.
+ */
+
+#define PCO_RECORDING_MAGIC         "PCOREC\r\n"
+#define PCO_RECORDING_INDEX_MAGIC   "PCOIDX\r\n"
+#define PCO_RECORDING_VERSION       1
+#define PCO_RECORDING_ALIGNMENT     4096
+#define PCO_RECORDING_EXTENSION     ".pcoraw"
+
+enum {
+    PCO_RECORD_HAS_TIMESTAMP = 1 << 0,  /* timestamp is valid */
+    PCO_RECORD_MISSING       = 1 << 1,  /* the frame could not be written */
+};
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t header_size;       /* offset of the first frame */
+    uint64_t frame_size;        /* bytes of pixel data in each frame */
+    uint64_t frame_stride;      /* distance between frames */
+    pco_recording_info info;
+} pco_recording_header;
+
+typedef struct {
+    uint64_t number;            /* frame number of the acquisition */
+    uint64_t offset;            /* file offset of the pixel data */
+    pco_timestamp timestamp;
+    uint32_t flags;
+    uint32_t reserved;
+} pco_recording_record;
+
+typedef struct {
+    uint64_t num_frames;
+    uint64_t index_offset;
+    char magic[8];
+} pco_recording_trailer;
+
+#endif
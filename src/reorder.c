@@ -0,0 +1,1698 @@
+/* Copyright (C) 2011, 2012 Matthias Vogelgesang <matthias.vogelgesang@kit.edu>
+   (Karlsruhe Institute of Technology)
+
+   This library is free software; you can redistribute it and/or modify it
+   under the terms of the GNU Lesser General Public License as published by the
+   Free Software Foundation; either version 2.1 of the License, or (at your
+   option) any later version.
+
+   This library is distributed in the hope that it will be useful, but WITHOUT
+   ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+   FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+   details.
+
+   You should have received a copy of the GNU Lesser General Public License along
+   with this library; if not, write to the Free Software Foundation, Inc., 51
+   Franklin St, Fifth Floor, Boston, MA 02110, USA */
+
+/*
+ * Image re-ordering for the pco.edge. The camera reads out the sensor from the
+ * top and the bottom towards the center, so the frame grabber delivers line
+ * pairs: the first line of a pair belongs to the upper half of the image, the
+ * second line to the lower half in reverse order. In fast scan mode the pixels
+ * are additionally packed into 12 bits.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "libpco.h"
+#include "reorder.h"
+
+#ifndef __SSE2__
+/*
+ * Decode complete groups of eight pixels, width must be a multiple of 8.
+ * Courtesy of PCO AG.
+ */
+static void
+decode_groups (int width, void *bufout, void* bufin)
+{
+    uint32_t *lineadr_in = (uint32_t *) bufin;
+    uint32_t *lineadr_out = (uint32_t *) bufout;
+    uint32_t a;
+
+    for (int x = 0; x < (width*12) / 32; x += 3) {
+        a = (*lineadr_in & 0x0000FFF0) >> 4;
+        a |= (*lineadr_in & 0x0000000F) << 24;
+        a |= (*lineadr_in & 0xFF000000) >> 8;
+        *lineadr_out = a;
+        lineadr_out++;
+
+        a = (*lineadr_in & 0x00FF0000) >> 12;
+        lineadr_in++;
+        a |= (*lineadr_in & 0x0000F000) >> 12;
+        a |= (*lineadr_in & 0x00000FFF) << 16;
+        *lineadr_out = a;
+        lineadr_out++;
+
+        a = (*lineadr_in & 0xFFF00000) >> 20;
+        a |= (*lineadr_in & 0x000F0000) << 8;
+        lineadr_in++;
+        a |= (*lineadr_in & 0x0000FF00) << 8;
+        *lineadr_out = a;
+        lineadr_out++;
+
+        a = (*lineadr_in & 0x000000FF) << 4;
+        a |= (*lineadr_in & 0xF0000000) >> 28;
+        a |= (*lineadr_in & 0x0FFF0000);
+        *lineadr_out = a;
+        lineadr_out++;
+        lineadr_in++;
+    }
+}
+#endif
+
+/*
+ * Return the number of 16 bit words of a raw line. The 12 bit pixels of a 5x12
+ * line form a contiguous bit stream, the line is padded to a whole word.
+ */
+static inline int
+line_words (int width, bool packed)
+{
+    return packed ? (width*12 + 15) / 16 : width;
+}
+
+/*
+ * Return pixel `x` of a 5x12 line. Pixels are stored MSB first within the 16
+ * bit words and may straddle two words. The second word is only read if the
+ * pixel extends into it.
+ */
+static inline uint16_t
+get_pixel_5x12 (const uint16_t *line, int x)
+{
+    const int word = (x * 12) / 16;
+    const int shift = (x * 12) % 16;
+    uint32_t v = (uint32_t) line[word] << 16;
+
+    if (shift > 4)
+        v |= line[word + 1];
+
+    return (uint16_t) ((v >> (20 - shift)) & 0xFFF);
+}
+
+#ifdef __SSE2__
+/*
+ * Unpack the eight pixels stored in six words. Lane i combines the bits of two
+ * words shifted by the per-lane factors, which SSE2 can only express as
+ * multiplications: mullo by 2^s shifts left, mulhi by 2^(16-s) shifts right.
+ * Only the twelve bytes of the group are read.
+ */
+static inline __m128i
+unpack_group_sse2 (const uint16_t *in)
+{
+    const __m128i words = _mm_unpacklo_epi64 (_mm_loadl_epi64 ((const __m128i *) in),
+                                              _mm_loadl_epi64 ((const __m128i *) (in + 2)));
+    const __m128i a = _mm_shufflehi_epi16 (_mm_shufflelo_epi16 (words, _MM_SHUFFLE (2, 1, 0, 0)),
+                                           _MM_SHUFFLE (3, 2, 1, 1));
+    const __m128i b = _mm_shufflehi_epi16 (_mm_shufflelo_epi16 (words, _MM_SHUFFLE (2, 2, 1, 0)),
+                                           _MM_SHUFFLE (3, 3, 2, 1));
+    const __m128i left = _mm_mullo_epi16 (a, _mm_setr_epi16 (0, 256, 16, 1, 0, 256, 16, 1));
+    const __m128i right = _mm_mulhi_epu16 (b, _mm_setr_epi16 (4096, 256, 16, 0, 4096, 256, 16, 0));
+
+    return _mm_and_si128 (_mm_or_si128 (left, right), _mm_set1_epi16 (0x0FFF));
+}
+#endif
+
+/*
+ * Decode a 5x12 line of any width. Complete groups are decoded with SSE2 where
+ * available, the remaining pixels one by one. Exactly `width` pixels are
+ * written and only the words holding them are read.
+ */
+static void
+decode_line (int width, void *bufout, void *bufin)
+{
+    const uint16_t *in = (const uint16_t *) bufin;
+    uint16_t *out = (uint16_t *) bufout;
+    const int groups = width / 8;
+
+#ifdef __SSE2__
+    for (int x = 0; x < groups; x++)
+        _mm_storeu_si128 ((__m128i *) (out + 8 * x), unpack_group_sse2 (in + 6 * x));
+#else
+    decode_groups (groups * 8, out, (void *) in);
+#endif
+
+    for (int x = groups * 8; x < width; x++)
+        out[x] = get_pixel_5x12 (in, x);
+}
+
+/*
+ * Unpack a group of eight 12 bit pixels stored in three 32 bit words. This is
+ * the same bit shuffling as in decode_line() but keeps the pixels in
+ * registers, so that fused kernels can process them further before storing.
+ */
+static inline void
+unpack_group (const uint32_t *in, uint16_t *px)
+{
+    px[0] = (in[0] & 0x0000FFF0) >> 4;
+    px[1] = ((in[0] & 0x0000000F) << 8) | (in[0] >> 24);
+    px[2] = ((in[0] & 0x00FF0000) >> 12) | ((in[1] & 0x0000F000) >> 12);
+    px[3] = in[1] & 0x00000FFF;
+    px[4] = in[1] >> 20;
+    px[5] = ((in[1] & 0x000F0000) >> 8) | ((in[2] & 0x0000FF00) >> 8);
+    px[6] = ((in[2] & 0x000000FF) << 4) | (in[2] >> 28);
+    px[7] = (in[2] & 0x0FFF0000) >> 16;
+}
+
+/*
+ * Return the output row of input line `line`. Even lines fill the upper half
+ * from the top, odd lines the lower half from the bottom.
+ */
+static inline int
+target_row (int line, int height)
+{
+    return line % 2 == 0 ? line / 2 : height - 1 - line / 2;
+}
+
+/*
+ * Return the input line that ends up in output row `row`. Rows of the upper
+ * half come from the even lines, rows of the lower half from the odd lines.
+ * For odd heights the last input line is the center row.
+ */
+static inline int
+source_line (int row, int height)
+{
+    return row < (height + 1) / 2 ? 2 * row : 2 * (height - 1 - row) + 1;
+}
+
+/**
+ * Re-order a pco.edge frame transferred in 5x12 format, i.e. with 12 bit
+ * packed pixels. The width may be any number of pixels, the raw lines are
+ * expected at the pitch returned by pco_get_raw_pitch_5x12().
+ *
+ * @param bufout Memory for width * height 16 bit pixels
+ * @param bufin Raw frame as delivered by the frame grabber
+ * @param width Width of the frame in pixels
+ * @param height Height of the frame in pixels
+ */
+void
+pco_reorder_image_5x12 (uint16_t *bufout, uint16_t *bufin, int width, int height)
+{
+    uint16_t *line_top = bufout;
+    uint16_t *line_bottom = bufout + (height-1)*width;
+    uint16_t *line_in = bufin;
+    const int off = line_words (width, true);
+
+    for (int y = 0; y < height/2; y++) {
+        decode_line (width, line_top, line_in);
+        line_in += off;
+        decode_line (width, line_bottom, line_in);
+        line_in += off;
+        line_top += width;
+        line_bottom -= width;
+    }
+
+    /* With an odd height the last line is the center row */
+    if (height % 2 == 1)
+        decode_line (width, line_top, line_in);
+}
+
+/**
+ * Re-order a pco.edge frame transferred in 5x16 format.
+ *
+ * @param bufout Memory for width * height 16 bit pixels
+ * @param bufin Raw frame as delivered by the frame grabber
+ * @param width Width of the frame in pixels
+ * @param height Height of the frame in pixels
+ */
+void
+pco_reorder_image_5x16 (uint16_t *bufout, uint16_t *bufin, int width, int height)
+{
+    uint16_t *line_top = bufout;
+    uint16_t *line_bottom = bufout + (height-1)*width;
+    uint16_t *line_in = bufin;
+
+    for (int y = 0; y < height/2; y++) {
+        memcpy (line_top, line_in, width * sizeof(uint16_t));
+        line_in += width;
+        memcpy (line_bottom, line_in, width * sizeof(uint16_t));
+        line_in += width;
+        line_top += width;
+        line_bottom -= width;
+    }
+
+    if (height % 2 == 1)
+        memcpy (line_top, line_in, width * sizeof(uint16_t));
+}
+
+/**
+ * Return the size of a raw line of a frame transferred in 5x12 format. The
+ * line holds a contiguous stream of 12 bit pixels padded to a whole 16 bit
+ * word, i.e. the width does not need to be a multiple of 8.
+ *
+ * @param width Width of the frame in pixels
+ * @return Size of a raw line in bytes
+ * @since 1.1
+ */
+size_t
+pco_get_raw_pitch_5x12 (int width)
+{
+    return (size_t) line_words (width, true) * sizeof(uint16_t);
+}
+
+/**
+ * Return the size of a raw line of a frame transferred in 5x16 format.
+ *
+ * @param width Width of the frame in pixels
+ * @return Size of a raw line in bytes
+ * @since 1.1
+ */
+size_t
+pco_get_raw_pitch_5x16 (int width)
+{
+    return (size_t) line_words (width, false) * sizeof(uint16_t);
+}
+
+static void
+reorder_strided (uint16_t *bufout, size_t out_pitch, const uint16_t *bufin, size_t in_pitch,
+                 int width, int height, bool packed)
+{
+    const size_t line_size = width * sizeof(uint16_t);
+
+    if (in_pitch == 0)
+        in_pitch = line_words (width, packed) * sizeof(uint16_t);
+
+    if (out_pitch == 0)
+        out_pitch = line_size;
+
+    if (in_pitch < line_words (width, packed) * sizeof(uint16_t) || out_pitch < line_size ||
+        in_pitch % sizeof(uint16_t) != 0 || out_pitch % sizeof(uint16_t) != 0) {
+        fprintf (stderr, "Invalid pitch %zu/%zu for width %i\n", in_pitch, out_pitch, width);
+        return;
+    }
+
+    for (int y = 0; y < height; y++) {
+        const uint8_t *line_in = (const uint8_t *) bufin + (size_t) y * in_pitch;
+        uint8_t *line_out = (uint8_t *) bufout + (size_t) target_row (y, height) * out_pitch;
+
+        if (packed)
+            decode_line (width, line_out, (void *) line_in);
+        else
+            memcpy (line_out, line_in, line_size);
+    }
+}
+
+/**
+ * Decode and re-order a pco.edge frame transferred in 5x12 format with
+ * explicit line pitches. This allows to write the frame directly into padded
+ * rows, a part of a larger mosaic or a slot of a volume without copying it
+ * afterwards. Bytes between the end of a row and the next row are not touched.
+ *
+ * @param bufout Location of the first output row
+ * @param out_pitch Distance between output rows in bytes, a multiple of 2 and
+ * at least width * 2, or 0 for width * 2
+ * @param bufin Raw frame as delivered by the frame grabber
+ * @param in_pitch Distance between raw lines in bytes, a multiple of 2 and at
+ * least pco_get_raw_pitch_5x12(), or 0 for exactly that
+ * @param width Width of the frame in pixels
+ * @param height Height of the frame in pixels
+ * @since 1.1
+ */
+void
+pco_reorder_image_5x12_strided (uint16_t *bufout, size_t out_pitch, const uint16_t *bufin, size_t in_pitch,
+                                int width, int height)
+{
+    reorder_strided (bufout, out_pitch, bufin, in_pitch, width, height, true);
+}
+
+/**
+ * Re-order a pco.edge frame transferred in 5x16 format with explicit line
+ * pitches.
+ *
+ * @param bufout Location of the first output row
+ * @param out_pitch Distance between output rows in bytes, a multiple of 2 and
+ * at least width * 2, or 0 for width * 2
+ * @param bufin Raw frame as delivered by the frame grabber
+ * @param in_pitch Distance between raw lines in bytes, a multiple of 2 and at
+ * least width * 2, or 0 for width * 2
+ * @param width Width of the frame in pixels
+ * @param height Height of the frame in pixels
+ * @since 1.1
+ * @see pco_reorder_image_5x12_strided()
+ */
+void
+pco_reorder_image_5x16_strided (uint16_t *bufout, size_t out_pitch, const uint16_t *bufin, size_t in_pitch,
+                                int width, int height)
+{
+    reorder_strided (bufout, out_pitch, bufin, in_pitch, width, height, false);
+}
+
+#ifdef __SSE2__
+/*
+ * Same as decode_line() but writes the output with non-temporal stores that
+ * bypass the cache. bufout must be 16 byte aligned.
+ */
+static void
+decode_line_nt (int width, uint16_t *bufout, const uint16_t *bufin)
+{
+    __m128i *out = (__m128i *) bufout;
+
+    for (int x = 0; x < width / 8; x++)
+        _mm_stream_si128 (out++, unpack_group_sse2 (bufin + 6 * x));
+}
+
+/*
+ * Copy a line with non-temporal stores. bufout must be 16 byte aligned.
+ */
+static void
+copy_line_nt (int width, uint16_t *bufout, const uint16_t *bufin)
+{
+    const __m128i *in = (const __m128i *) bufin;
+    __m128i *out = (__m128i *) bufout;
+
+    for (int x = 0; x < width / 8; x++)
+        _mm_stream_si128 (out++, _mm_loadu_si128 (in++));
+}
+
+static void
+reorder_nt (uint16_t *bufout, uint16_t *bufin, int width, int height, bool packed)
+{
+    uint16_t *line_top = bufout;
+    uint16_t *line_bottom = bufout + (height-1)*width;
+    uint16_t *line_in = bufin;
+    const int off = line_words (width, packed);
+
+    for (int y = 0; y < height/2; y++) {
+        if (packed) {
+            decode_line_nt (width, line_top, line_in);
+            decode_line_nt (width, line_bottom, line_in + off);
+        }
+        else {
+            copy_line_nt (width, line_top, line_in);
+            copy_line_nt (width, line_bottom, line_in + off);
+        }
+
+        line_in += 2 * off;
+        line_top += width;
+        line_bottom -= width;
+    }
+
+    if (height % 2 == 1) {
+        if (packed)
+            decode_line_nt (width, line_top, line_in);
+        else
+            copy_line_nt (width, line_top, line_in);
+    }
+
+    /* Make the stores visible before the frame is handed to another thread */
+    _mm_sfence ();
+}
+
+static inline bool
+can_stream (const uint16_t *bufout, int width)
+{
+    return ((uintptr_t) bufout % 16) == 0 && width % 8 == 0;
+}
+#endif
+
+/**
+ * Re-order a pco.edge frame transferred in 5x12 format like
+ * pco_reorder_image_5x12() but write the output with non-temporal stores. The
+ * decoded frame does not pass through the cache and does not evict the data
+ * of other threads, which pays off when the frame goes to a large ring buffer
+ * or to disk and is not touched again soon. If the CPU does not support
+ * streaming stores or #bufout is not 16 byte aligned, regular stores are used.
+ *
+ * @param bufout Memory for width * height 16 bit pixels, preferably 16 byte
+ * aligned
+ * @param bufin Raw frame as delivered by the frame grabber
+ * @param width Width of the frame in pixels
+ * @param height Height of the frame in pixels
+ * @since 1.1
+ */
+void
+pco_reorder_image_5x12_nt (uint16_t *bufout, uint16_t *bufin, int width, int height)
+{
+#ifdef __SSE2__
+    if (can_stream (bufout, width)) {
+        reorder_nt (bufout, bufin, width, height, true);
+        return;
+    }
+#endif
+    pco_reorder_image_5x12 (bufout, bufin, width, height);
+}
+
+/**
+ * Re-order a pco.edge frame transferred in 5x16 format like
+ * pco_reorder_image_5x16() but write the output with non-temporal stores.
+ *
+ * @param bufout Memory for width * height 16 bit pixels, preferably 16 byte
+ * aligned
+ * @param bufin Raw frame as delivered by the frame grabber
+ * @param width Width of the frame in pixels
+ * @param height Height of the frame in pixels
+ * @since 1.1
+ * @see pco_reorder_image_5x12_nt()
+ */
+void
+pco_reorder_image_5x16_nt (uint16_t *bufout, uint16_t *bufin, int width, int height)
+{
+#ifdef __SSE2__
+    if (can_stream (bufout, width)) {
+        reorder_nt (bufout, bufin, width, height, false);
+        return;
+    }
+#endif
+    pco_reorder_image_5x16 (bufout, bufin, width, height);
+}
+
+/*
+ * Permute the rows of an image that is stored in transfer order into display
+ * order. Every row is moved exactly once by following the cycles of the
+ * permutation, so only a single line and one bit per row are needed on top of
+ * the image itself, both taken from `scratch`.
+ */
+static void
+permute_lines (uint16_t *buf, int width, int height, uint16_t *scratch)
+{
+    const size_t line_size = width * sizeof(uint16_t);
+    uint16_t *tmp = scratch;
+    uint8_t *visited = (uint8_t *) (tmp + width);
+
+    memset (visited, 0, (height + 7) / 8);
+
+    for (int start = 0; start < height; start++) {
+        int row = start;
+        int src;
+
+        if (visited[start / 8] & (1 << (start % 8)))
+            continue;
+
+        memcpy (tmp, buf + (size_t) start * width, line_size);
+
+        while ((src = source_line (row, height)) != start) {
+            memcpy (buf + (size_t) row * width, buf + (size_t) src * width, line_size);
+            visited[row / 8] |= 1 << (row % 8);
+            row = src;
+        }
+
+        memcpy (buf + (size_t) row * width, tmp, line_size);
+        visited[row / 8] |= 1 << (row % 8);
+    }
+}
+
+/*
+ * Expand the packed lines of a 5x12 frame back to front, so that no line is
+ * overwritten before it has been decoded.
+ */
+static void
+expand_lines_5x12 (uint16_t *buf, int width, int height, uint16_t *tmp)
+{
+    const int off = line_words (width, true);
+
+    /*
+     * Expanded line y overlaps packed line y itself only while y * (width - off)
+     * < off, i.e. for y < 3 if the width is a multiple of 4. All other packed
+     * lines it touches have already been decoded.
+     */
+    for (int y = height - 1; y >= 0; y--) {
+        if ((int64_t) y * (width - off) < off) {
+            decode_line (width, tmp, buf + (size_t) y * off);
+            memcpy (buf + (size_t) y * width, tmp, width * sizeof(uint16_t));
+        }
+        else
+            decode_line (width, buf + (size_t) y * width, buf + (size_t) y * off);
+    }
+}
+
+static unsigned int
+reorder_inplace (uint16_t *buf, int width, int height, uint16_t *scratch, bool packed)
+{
+    uint16_t *tmp = scratch;
+
+    if (width <= 0 || height <= 0)
+        return PCO_ERROR_WRONGVALUE;
+
+    if (tmp == NULL)
+        tmp = (uint16_t *) malloc (pco_get_inplace_scratch_size (width, height));
+
+    if (tmp == NULL) {
+        fprintf (stderr, "Unable to allocate line buffer for re-ordering\n");
+        return PCO_ERROR_NOMEMORY;
+    }
+
+    if (packed)
+        expand_lines_5x12 (buf, width, height, tmp);
+
+    permute_lines (buf, width, height, tmp);
+
+    if (tmp != scratch)
+        free (tmp);
+
+    return PCO_NOERROR;
+}
+
+/**
+ * Return the number of bytes of temporary storage needed by the in-place
+ * re-order functions for a frame.
+ *
+ * @param width Width of the frame in pixels
+ * @param height Height of the frame in pixels
+ * @return Size of the scratch buffer in bytes
+ * @since 1.1
+ */
+size_t
+pco_get_inplace_scratch_size (int width, int height)
+{
+    return (size_t) width * sizeof(uint16_t) + (height + 7) / 8;
+}
+
+/**
+ * Re-order a pco.edge frame transferred in 5x16 format in place. Instead of
+ * copying into a second frame, the lines are permuted within the DMA buffer.
+ *
+ * @param buf Raw frame as delivered by the frame grabber, re-ordered on return
+ * @param width Width of the frame in pixels
+ * @param height Height of the frame in pixels
+ * @param scratch Temporary storage of pco_get_inplace_scratch_size() bytes that
+ * can be reused across frames, or NULL to allocate it for this frame
+ * @return Error code or PCO_NOERROR.
+ * @since 1.1
+ */
+unsigned int
+pco_reorder_image_5x16_inplace (uint16_t *buf, int width, int height, uint16_t *scratch)
+{
+    return reorder_inplace (buf, width, height, scratch, false);
+}
+
+/**
+ * Decode and re-order a pco.edge frame transferred in 5x12 format in place.
+ * The packed lines are expanded back to front, so that no line is overwritten
+ * before it has been decoded, and then permuted like in
+ * pco_reorder_image_5x16_inplace(). Apart from the frame itself, only a single
+ * line of temporary storage is used.
+ *
+ * @param buf Raw frame as delivered by the frame grabber. The buffer must be
+ * large enough to hold width * height 16 bit pixels, which is the case for the
+ * DMA memory set up for 16 bit frames.
+ * @param width Width of the frame in pixels
+ * @param height Height of the frame in pixels
+ * @param scratch Temporary storage of pco_get_inplace_scratch_size() bytes that
+ * can be reused across frames, or NULL to allocate it for this frame
+ * @return Error code or PCO_NOERROR.
+ * @since 1.1
+ */
+unsigned int
+pco_reorder_image_5x12_inplace (uint16_t *buf, int width, int height, uint16_t *scratch)
+{
+    return reorder_inplace (buf, width, height, scratch, true);
+}
+
+/*
+ * Map a 16 bit value linearly from [min, max] to [0, 255]. Values outside the
+ * range are clamped.
+ */
+static inline uint8_t
+scale_pixel (uint16_t value, uint16_t min, float scale)
+{
+    float v = ((float) value - (float) min) * scale;
+
+    if (v <= 0.0f)
+        return 0;
+
+    return v >= 255.0f ? 255 : (uint8_t) v;
+}
+
+static inline float
+scale_factor (uint16_t min, uint16_t max)
+{
+    return max > min ? 255.0f / (float) (max - min) : 255.0f;
+}
+
+static void
+lut8_line_5x12 (int width, uint8_t *out, const uint16_t *in, const uint8_t *lut)
+{
+    uint16_t px[8];
+
+    /* Lines of odd widths are not 4 byte aligned, each group is copied */
+    for (int x = 0; x < width / 8; x++, out += 8) {
+        uint32_t group[3];
+
+        memcpy (group, in + 6 * x, sizeof(group));
+        unpack_group (group, px);
+
+        for (int i = 0; i < 8; i++)
+            out[i] = lut[px[i]];
+    }
+
+    for (int x = 0; x < width % 8; x++)
+        out[x] = lut[get_pixel_5x12 (in, width - width % 8 + x)];
+}
+
+/**
+ * Decode and re-order a pco.edge frame transferred in 5x12 format and map it
+ * to 8 bit through a look-up table in the same pass.
+ *
+ * @param bufout Memory for width * height 8 bit pixels
+ * @param bufin Raw frame as delivered by the frame grabber
+ * @param width Width of the frame in pixels
+ * @param height Height of the frame in pixels
+ * @param lut Look-up table with 4096 entries, one for each 12 bit value
+ * @since 1.1
+ */
+void
+pco_reorder_image_5x12_lut8 (uint8_t *bufout, uint16_t *bufin, int width, int height, const uint8_t *lut)
+{
+    const int off = line_words (width, true);
+
+    for (int y = 0; y < height; y++)
+        lut8_line_5x12 (width, bufout + (size_t) target_row (y, height) * width, bufin + (size_t) y * off, lut);
+}
+
+/**
+ * Re-order a pco.edge frame transferred in 5x16 format and map it to 8 bit
+ * through a look-up table in the same pass.
+ *
+ * @param bufout Memory for width * height 8 bit pixels
+ * @param bufin Raw frame as delivered by the frame grabber
+ * @param width Width of the frame in pixels
+ * @param height Height of the frame in pixels
+ * @param lut Look-up table with 65536 entries, one for each 16 bit value
+ * @since 1.1
+ */
+void
+pco_reorder_image_5x16_lut8 (uint8_t *bufout, uint16_t *bufin, int width, int height, const uint8_t *lut)
+{
+    for (int y = 0; y < height; y++) {
+        uint8_t *out = bufout + (size_t) target_row (y, height) * width;
+        const uint16_t *in = bufin + (size_t) y * width;
+
+        for (int x = 0; x < width; x++)
+            out[x] = lut[in[x]];
+    }
+}
+
+/**
+ * Decode and re-order a pco.edge frame transferred in 5x12 format and scale it
+ * linearly to 8 bit in the same pass. Values up to #min are mapped to 0, values
+ * from #max on to 255. The 12 bit values are mapped through a table computed
+ * once per frame, see pco_reorder_image_5x12_lut8().
+ *
+ * @param bufout Memory for width * height 8 bit pixels
+ * @param bufin Raw frame as delivered by the frame grabber
+ * @param width Width of the frame in pixels
+ * @param height Height of the frame in pixels
+ * @param min Value that is mapped to 0
+ * @param max Value that is mapped to 255
+ * @since 1.1
+ */
+void
+pco_reorder_image_5x12_scale8 (uint8_t *bufout, uint16_t *bufin, int width, int height, uint16_t min, uint16_t max)
+{
+    const float scale = scale_factor (min, max);
+    uint8_t lut[4096];
+
+    for (int i = 0; i < 4096; i++)
+        lut[i] = scale_pixel ((uint16_t) i, min, scale);
+
+    pco_reorder_image_5x12_lut8 (bufout, bufin, width, height, lut);
+}
+
+/**
+ * Re-order a pco.edge frame transferred in 5x16 format and scale it linearly to
+ * 8 bit in the same pass. The scaling is computed arithmetically rather than
+ * through a 64 KB look-up table, which would not stay in the L1 cache.
+ *
+ * @param bufout Memory for width * height 8 bit pixels
+ * @param bufin Raw frame as delivered by the frame grabber
+ * @param width Width of the frame in pixels
+ * @param height Height of the frame in pixels
+ * @param min Value that is mapped to 0
+ * @param max Value that is mapped to 255
+ * @since 1.1
+ */
+void
+pco_reorder_image_5x16_scale8 (uint8_t *bufout, uint16_t *bufin, int width, int height, uint16_t min, uint16_t max)
+{
+    const float scale = scale_factor (min, max);
+
+    for (int y = 0; y < height; y++) {
+        uint8_t *out = bufout + (size_t) target_row (y, height) * width;
+        const uint16_t *in = bufin + (size_t) y * width;
+
+        for (int x = 0; x < width; x++)
+            out[x] = scale_pixel (in[x], min, scale);
+    }
+}
+
+/*
+ * Decode `count` pixels of a packed line of `width` pixels starting at pixel
+ * `x`. Decoding starts at a group boundary and covers complete groups unless
+ * the line ends earlier, so `out` must have room for up to seven pixels before
+ * and after the span. Returns the location of pixel `x` within `out`.
+ */
+static uint16_t *
+decode_span (const uint16_t *line_in, int width, int x, int count, uint16_t *out)
+{
+    const int first = x / 8 * 8;
+    const int last = (x + count + 7) / 8 * 8;
+
+    decode_line ((last < width ? last : width) - first, out, (void *) (line_in + first / 8 * 6));
+    return out + x % 8;
+}
+
+/*
+ * Return `count` pixels starting at column `x` of display row `row` of a raw
+ * frame as 16 bit pixels. Unpacked lines are returned directly, packed lines
+ * are decoded into `scratch` which holds a single line and thus stays in the
+ * cache. Only the input words covering the span are read.
+ */
+static const uint16_t *
+fetch_row (const uint16_t *bufin, int width, int height, bool packed, int row, int x, int count, uint16_t *scratch)
+{
+    const int line = source_line (row, height);
+
+    if (!packed)
+        return bufin + (size_t) line * width + x;
+
+    return decode_span (bufin + (size_t) line * line_words (width, true), width, x, count, scratch);
+}
+
+static void
+bin_line_16 (uint16_t *acc, const uint16_t *line, int out_width, int bin_x)
+{
+    for (int x = 0; x < out_width; x++, line += bin_x) {
+        uint16_t sum = 0;
+
+        for (int i = 0; i < bin_x; i++)
+            sum += line[i];
+
+        acc[x] += sum;
+    }
+}
+
+static void
+bin_line_32 (uint32_t *acc, const uint16_t *line, int out_width, int bin_x)
+{
+    for (int x = 0; x < out_width; x++, line += bin_x) {
+        uint32_t sum = 0;
+
+        for (int i = 0; i < bin_x; i++)
+            sum += line[i];
+
+        acc[x] += sum;
+    }
+}
+
+static void
+reorder_binned (void *bufout, uint16_t *bufin, int width, int height, int bin_x, int bin_y,
+                pco_binning_mode mode, bool packed)
+{
+    const int out_width = bin_x > 0 ? width / bin_x : 0;
+    const int out_height = bin_y > 0 ? height / bin_y : 0;
+    const uint32_t n = (uint32_t) bin_x * bin_y;
+    const uint32_t max_value = packed ? 0xFFF : 0xFFFF;
+    const bool narrow = (uint64_t) n * max_value <= 0xFFFF;
+    const int acc_offset = (width + 1) / 2 * 2;
+    uint16_t *scratch;
+    void *acc;
+
+    if (out_width == 0 || out_height == 0) {
+        fprintf (stderr, "Invalid binning %ix%i for %ix%i frame\n", bin_x, bin_y, width, height);
+        return;
+    }
+
+    scratch = (uint16_t *) malloc (acc_offset * sizeof(uint16_t) + out_width * sizeof(uint32_t));
+
+    if (scratch == NULL) {
+        fprintf (stderr, "Unable to allocate line buffer for binning\n");
+        return;
+    }
+
+    /* The accumulator follows the line buffer, 32 bit aligned */
+    acc = scratch + acc_offset;
+
+    for (int y = 0; y < out_height; y++) {
+        uint16_t *out16 = ((uint16_t *) bufout) + (size_t) y * out_width;
+        uint32_t *out32 = ((uint32_t *) bufout) + (size_t) y * out_width;
+
+        memset (acc, 0, out_width * (narrow ? sizeof(uint16_t) : sizeof(uint32_t)));
+
+        /*
+         * Sums of at most 16 bits are accumulated in 16 bit, which halves the
+         * accumulator traffic.
+         */
+        for (int j = 0; j < bin_y; j++) {
+            const uint16_t *line = fetch_row (bufin, width, height, packed, y * bin_y + j, 0, width, scratch);
+
+            if (narrow)
+                bin_line_16 ((uint16_t *) acc, line, out_width, bin_x);
+            else
+                bin_line_32 ((uint32_t *) acc, line, out_width, bin_x);
+        }
+
+        for (int x = 0; x < out_width; x++) {
+            uint32_t sum = narrow ? ((uint16_t *) acc)[x] : ((uint32_t *) acc)[x];
+
+            switch (mode) {
+                case PCO_BINNING_SUM_16:
+                    out16[x] = sum > 0xFFFF ? 0xFFFF : sum;
+                    break;
+                case PCO_BINNING_SUM_32:
+                    out32[x] = sum;
+                    break;
+                case PCO_BINNING_MEAN_16:
+                    out16[x] = sum / n;
+                    break;
+                default:
+                    fprintf (stderr, "Invalid binning mode %i\n", (int) mode);
+                    free (scratch);
+                    return;
+            }
+        }
+    }
+
+    free (scratch);
+}
+
+/**
+ * Decode, re-order and bin a pco.edge frame transferred in 5x12 format. Each
+ * output pixel combines bin_x * bin_y input pixels. Lines and columns that do
+ * not fill a complete bin are dropped, i.e. the output frame is
+ * width / bin_x * height / bin_y pixels large.
+ *
+ * @param bufout Memory for the binned frame with 16 or 32 bit pixels
+ * depending on #mode
+ * @param bufin Raw frame as delivered by the frame grabber
+ * @param width Width of the frame in pixels
+ * @param height Height of the frame in pixels
+ * @param bin_x Horizontal binning
+ * @param bin_y Vertical binning
+ * @param mode How to combine the pixels of a bin
+ * @since 1.1
+ */
+void
+pco_reorder_image_5x12_binned (void *bufout, uint16_t *bufin, int width, int height, int bin_x, int bin_y, pco_binning_mode mode)
+{
+    reorder_binned (bufout, bufin, width, height, bin_x, bin_y, mode, true);
+}
+
+/**
+ * Re-order and bin a pco.edge frame transferred in 5x16 format.
+ *
+ * @param bufout Memory for the binned frame with 16 or 32 bit pixels
+ * depending on #mode
+ * @param bufin Raw frame as delivered by the frame grabber
+ * @param width Width of the frame in pixels
+ * @param height Height of the frame in pixels
+ * @param bin_x Horizontal binning
+ * @param bin_y Vertical binning
+ * @param mode How to combine the pixels of a bin
+ * @since 1.1
+ * @see pco_reorder_image_5x12_binned()
+ */
+void
+pco_reorder_image_5x16_binned (void *bufout, uint16_t *bufin, int width, int height, int bin_x, int bin_y, pco_binning_mode mode)
+{
+    reorder_binned (bufout, bufin, width, height, bin_x, bin_y, mode, false);
+}
+
+static void
+reorder_roi (uint16_t *bufout, uint16_t *bufin, int width, int height,
+             int x, int y, int roi_width, int roi_height, bool packed)
+{
+    uint16_t *scratch = NULL;
+
+    if (x < 0 || y < 0 || roi_width <= 0 || roi_height <= 0 ||
+        x + roi_width > width || y + roi_height > height) {
+        fprintf (stderr, "Invalid region %ix%i+%i+%i for %ix%i frame\n",
+                 roi_width, roi_height, x, y, width, height);
+        return;
+    }
+
+    /*
+     * Spans that start and end on a group boundary are decoded straight into
+     * the output, everything else goes through one line of scratch memory.
+     */
+    if (packed && (x % 8 != 0 || roi_width % 8 != 0)) {
+        scratch = (uint16_t *) malloc ((roi_width + 16) * sizeof(uint16_t));
+
+        if (scratch == NULL) {
+            fprintf (stderr, "Unable to allocate line buffer for re-ordering\n");
+            return;
+        }
+    }
+
+    for (int j = 0; j < roi_height; j++) {
+        uint16_t *out = bufout + (size_t) j * roi_width;
+
+        if (packed && scratch == NULL) {
+            fetch_row (bufin, width, height, packed, y + j, x, roi_width, out);
+            continue;
+        }
+
+        memcpy (out, fetch_row (bufin, width, height, packed, y + j, x, roi_width, scratch),
+                roi_width * sizeof(uint16_t));
+    }
+
+    free (scratch);
+}
+
+/**
+ * Decode and re-order a rectangular region of a pco.edge frame transferred in
+ * 5x12 format. Only the lines and input words needed for the region are read,
+ * so the cost scales with the region rather than the sensor size.
+ *
+ * @param bufout Memory for roi_width * roi_height 16 bit pixels
+ * @param bufin Raw frame as delivered by the frame grabber
+ * @param width Width of the frame in pixels
+ * @param height Height of the frame in pixels
+ * @param x Left column of the region in the re-ordered frame
+ * @param y Top row of the region in the re-ordered frame
+ * @param roi_width Width of the region in pixels
+ * @param roi_height Height of the region in pixels
+ * @since 1.1
+ */
+void
+pco_reorder_image_5x12_roi (uint16_t *bufout, uint16_t *bufin, int width, int height,
+                            int x, int y, int roi_width, int roi_height)
+{
+    reorder_roi (bufout, bufin, width, height, x, y, roi_width, roi_height, true);
+}
+
+/**
+ * Re-order a rectangular region of a pco.edge frame transferred in 5x16
+ * format.
+ *
+ * @param bufout Memory for roi_width * roi_height 16 bit pixels
+ * @param bufin Raw frame as delivered by the frame grabber
+ * @param width Width of the frame in pixels
+ * @param height Height of the frame in pixels
+ * @param x Left column of the region in the re-ordered frame
+ * @param y Top row of the region in the re-ordered frame
+ * @param roi_width Width of the region in pixels
+ * @param roi_height Height of the region in pixels
+ * @since 1.1
+ * @see pco_reorder_image_5x12_roi()
+ */
+void
+pco_reorder_image_5x16_roi (uint16_t *bufout, uint16_t *bufin, int width, int height,
+                            int x, int y, int roi_width, int roi_height)
+{
+    reorder_roi (bufout, bufin, width, height, x, y, roi_width, roi_height, false);
+}
+
+/*
+ * Function processing the output rows [first, last) of a frame. `thread` is the
+ * index of the calling thread and `scratch` holds one decoded line that is
+ * private to it.
+ */
+typedef void (*row_func) (void *data, int thread, int first, int last, uint16_t *scratch);
+
+typedef struct {
+    row_func func;
+    void *data;
+    int num_tasks;
+    int height;
+    uint16_t *scratch;
+    size_t scratch_pitch;
+} row_tasks;
+
+static void
+run_row_task (void *arg, int index)
+{
+    row_tasks *tasks = (row_tasks *) arg;
+    const int first = (int) ((int64_t) tasks->height * index / tasks->num_tasks);
+    const int last = (int) ((int64_t) tasks->height * (index + 1) / tasks->num_tasks);
+
+    tasks->func (tasks->data, index, first, last, tasks->scratch + index * tasks->scratch_pitch);
+}
+
+/*
+ * Return the number of threads actually used by run_rows().
+ */
+static int
+clamp_threads (int num_threads, int height)
+{
+    if (num_threads > PCO_MAX_REORDER_THREADS)
+        num_threads = PCO_MAX_REORDER_THREADS;
+
+    if (num_threads > height)
+        num_threads = height;
+
+    return num_threads < 1 ? 1 : num_threads;
+}
+
+/*
+ * Split the rows of a frame evenly across `num_threads` threads of `workers`,
+ * one of them being the caller. Rows are assigned in contiguous blocks so that
+ * every thread writes its own part of the output. Without workers, the caller
+ * processes all rows. Returns false without processing any row if the line
+ * buffers cannot be allocated.
+ */
+static bool
+run_rows (pco_workers *workers, row_func func, void *data, int width, int height, int num_threads)
+{
+    row_tasks tasks;
+
+    num_threads = clamp_threads (workers != NULL ? num_threads : 1, height);
+
+    /* Line buffers are a multiple of 64 bytes apart to not share cache lines */
+    tasks.func = func;
+    tasks.data = data;
+    tasks.num_tasks = num_threads;
+    tasks.height = height;
+    tasks.scratch_pitch = ((size_t) width + 8 + 31) & ~((size_t) 31);
+    tasks.scratch = (uint16_t *) malloc (num_threads * tasks.scratch_pitch * sizeof(uint16_t));
+
+    if (tasks.scratch == NULL)
+        return false;
+
+    if (workers != NULL)
+        pco_workers_run (workers, num_threads, run_row_task, &tasks);
+    else
+        run_row_task (&tasks, 0);
+
+    free (tasks.scratch);
+    return true;
+}
+
+typedef struct {
+    void *bufout;
+    const uint16_t *bufin;
+    int width;
+    int height;
+    bool packed;
+    const float *dark;
+    const float *gain;
+    float scale;
+} flat_field_data;
+
+static void
+flat_field_rows_f32 (void *data, int thread, int first, int last, uint16_t *scratch)
+{
+    flat_field_data *d = (flat_field_data *) data;
+    const int width = d->width;
+
+    for (int y = first; y < last; y++) {
+        const size_t offset = (size_t) y * width;
+        const uint16_t *line = fetch_row (d->bufin, width, d->height, d->packed, y, 0, width, scratch);
+        const float *dark = d->dark + offset;
+        const float *gain = d->gain + offset;
+        float *out = ((float *) d->bufout) + offset;
+
+        for (int x = 0; x < width; x++)
+            out[x] = ((float) line[x] - dark[x]) * gain[x];
+    }
+}
+
+static void
+flat_field_rows_u16 (void *data, int thread, int first, int last, uint16_t *scratch)
+{
+    flat_field_data *d = (flat_field_data *) data;
+    const int width = d->width;
+    const float scale = d->scale;
+
+    for (int y = first; y < last; y++) {
+        const size_t offset = (size_t) y * width;
+        const uint16_t *line = fetch_row (d->bufin, width, d->height, d->packed, y, 0, width, scratch);
+        const float *dark = d->dark + offset;
+        const float *gain = d->gain + offset;
+        uint16_t *out = ((uint16_t *) d->bufout) + offset;
+
+        for (int x = 0; x < width; x++) {
+            float v = ((float) line[x] - dark[x]) * gain[x] * scale + 0.5f;
+            out[x] = v <= 0.0f ? 0 : (v >= 65535.0f ? 65535 : (uint16_t) v);
+        }
+    }
+}
+
+static unsigned int
+reorder_flat_field (pco_workers *workers, void *bufout, uint16_t *bufin, int width, int height, bool packed,
+                    const float *dark, const float *gain, float scale, bool u16)
+{
+    const int num_threads = workers != NULL ? pco_workers_get_num_threads (workers) : 1;
+
+    flat_field_data data = {
+        .bufout = bufout, .bufin = bufin,
+        .width = width, .height = height, .packed = packed,
+        .dark = dark, .gain = gain, .scale = scale
+    };
+
+    if (!run_rows (workers, u16 ? flat_field_rows_u16 : flat_field_rows_f32, &data, width, height, num_threads)) {
+        fprintf (stderr, "Unable to allocate line buffers for flat-field correction\n");
+        return PCO_ERROR_NOMEMORY;
+    }
+
+    return PCO_NOERROR;
+}
+
+/*
+ * Flat-field correct a frame with the threads of #workers, used by
+ * pco_reorder_image_flat_field() to keep its threads across frames.
+ */
+unsigned int
+pco_reorder_5x12_flat_field_workers (pco_workers *workers, void *bufout, uint16_t *bufin, int width, int height,
+                                     const float *dark, const float *gain, float scale, bool u16)
+{
+    return reorder_flat_field (workers, bufout, bufin, width, height, true, dark, gain, scale, u16);
+}
+
+unsigned int
+pco_reorder_5x16_flat_field_workers (pco_workers *workers, void *bufout, uint16_t *bufin, int width, int height,
+                                     const float *dark, const float *gain, float scale, bool u16)
+{
+    return reorder_flat_field (workers, bufout, bufin, width, height, false, dark, gain, scale, u16);
+}
+
+/**
+ * Decode, re-order and flat-field correct a pco.edge frame transferred in 5x12
+ * format. Each output pixel is computed as (I - dark) * gain, where gain is
+ * typically 1 / (flat - dark), in a single pass over the raw frame. The frame
+ * is processed by the calling thread, use pco_reorder_image_flat_field() to
+ * split it across the threads of a handle.
+ *
+ * @param bufout Memory for width * height float pixels
+ * @param bufin Raw frame as delivered by the frame grabber
+ * @param width Width of the frame in pixels
+ * @param height Height of the frame in pixels
+ * @param dark Dark field with width * height pixels in display order
+ * @param gain Gain with width * height pixels in display order
+ * @return Error code or PCO_NOERROR.
+ * @since 1.1
+ */
+unsigned int
+pco_reorder_image_5x12_flat_field (float *bufout, uint16_t *bufin, int width, int height,
+                                   const float *dark, const float *gain)
+{
+    return reorder_flat_field (NULL, bufout, bufin, width, height, true, dark, gain, 1.0f, false);
+}
+
+/**
+ * Re-order and flat-field correct a pco.edge frame transferred in 5x16 format.
+ *
+ * @param bufout Memory for width * height float pixels
+ * @param bufin Raw frame as delivered by the frame grabber
+ * @param width Width of the frame in pixels
+ * @param height Height of the frame in pixels
+ * @param dark Dark field with width * height pixels in display order
+ * @param gain Gain with width * height pixels in display order
+ * @return Error code or PCO_NOERROR.
+ * @since 1.1
+ * @see pco_reorder_image_5x12_flat_field()
+ */
+unsigned int
+pco_reorder_image_5x16_flat_field (float *bufout, uint16_t *bufin, int width, int height,
+                                   const float *dark, const float *gain)
+{
+    return reorder_flat_field (NULL, bufout, bufin, width, height, false, dark, gain, 1.0f, false);
+}
+
+/**
+ * Decode, re-order and flat-field correct a pco.edge frame transferred in 5x12
+ * format into 16 bit pixels. The corrected value is multiplied with #scale,
+ * rounded and clamped to [0, 65535].
+ *
+ * @param bufout Memory for width * height 16 bit pixels
+ * @param bufin Raw frame as delivered by the frame grabber
+ * @param width Width of the frame in pixels
+ * @param height Height of the frame in pixels
+ * @param dark Dark field with width * height pixels in display order
+ * @param gain Gain with width * height pixels in display order
+ * @param scale Factor applied to the corrected value
+ * @return Error code or PCO_NOERROR.
+ * @since 1.1
+ */
+unsigned int
+pco_reorder_image_5x12_flat_field_u16 (uint16_t *bufout, uint16_t *bufin, int width, int height,
+                                       const float *dark, const float *gain, float scale)
+{
+    return reorder_flat_field (NULL, bufout, bufin, width, height, true, dark, gain, scale, true);
+}
+
+/**
+ * Re-order and flat-field correct a pco.edge frame transferred in 5x16 format
+ * into 16 bit pixels.
+ *
+ * @param bufout Memory for width * height 16 bit pixels
+ * @param bufin Raw frame as delivered by the frame grabber
+ * @param width Width of the frame in pixels
+ * @param height Height of the frame in pixels
+ * @param dark Dark field with width * height pixels in display order
+ * @param gain Gain with width * height pixels in display order
+ * @param scale Factor applied to the corrected value
+ * @return Error code or PCO_NOERROR.
+ * @since 1.1
+ * @see pco_reorder_image_5x12_flat_field_u16()
+ */
+unsigned int
+pco_reorder_image_5x16_flat_field_u16 (uint16_t *bufout, uint16_t *bufin, int width, int height,
+                                       const float *dark, const float *gain, float scale)
+{
+    return reorder_flat_field (NULL, bufout, bufin, width, height, false, dark, gain, scale, true);
+}
+
+typedef struct {
+    uint16_t *bufout;
+    const uint16_t *bufin;
+    int width;
+    int height;
+    bool packed;
+    uint16_t saturation;
+    int shift;
+    pco_frame_stats *partial;
+} stats_data;
+
+static void
+stats_rows (void *data, int thread, int first, int last, uint16_t *scratch)
+{
+    stats_data *d = (stats_data *) data;
+    pco_frame_stats *stats = &d->partial[thread];
+    const int width = d->width;
+    const int shift = d->shift;
+    const uint16_t saturation = d->saturation;
+    uint16_t min = 0xFFFF;
+    uint16_t max = 0;
+    uint64_t sum = 0;
+    uint64_t num_saturated = 0;
+
+    for (int y = first; y < last; y++) {
+        uint16_t *out = d->bufout + (size_t) y * width;
+
+        if (d->packed)
+            decode_line (width, out, (void *) (d->bufin + (size_t) source_line (y, d->height) * line_words (width, true)));
+        else
+            memcpy (out, fetch_row (d->bufin, width, d->height, false, y, 0, width, scratch), width * sizeof(uint16_t));
+
+        /* The line is still in the L1 cache at this point */
+        for (int x = 0; x < width; x++) {
+            const uint16_t v = out[x];
+
+            min = v < min ? v : min;
+            max = v > max ? v : max;
+            sum += v;
+            num_saturated += v >= saturation;
+            stats->histogram[v >> shift]++;
+        }
+    }
+
+    stats->min = min;
+    stats->max = max;
+    stats->sum = sum;
+    stats->num_saturated = num_saturated;
+}
+
+static unsigned int
+reorder_stats (pco_workers *workers, uint16_t *bufout, uint16_t *bufin, int width, int height, bool packed,
+               pco_frame_stats *stats)
+{
+    stats_data data;
+    pco_frame_stats single;
+    int num_threads;
+
+    if (stats == NULL) {
+        if (packed)
+            pco_reorder_image_5x12 (bufout, bufin, width, height);
+        else
+            pco_reorder_image_5x16 (bufout, bufin, width, height);
+        return PCO_NOERROR;
+    }
+
+    num_threads = clamp_threads (workers != NULL ? pco_workers_get_num_threads (workers) : 1, height);
+
+    data.bufout = bufout;
+    data.bufin = bufin;
+    data.width = width;
+    data.height = height;
+    data.packed = packed;
+    data.shift = packed ? 0 : 4;
+    data.saturation = stats->saturation_level != 0 ? stats->saturation_level : (packed ? 0xFFF : 0xFFFF);
+
+    /*
+     * Each thread fills its own histogram to avoid sharing cache lines, they
+     * are merged once all rows are done. If they cannot be allocated, a single
+     * thread fills one histogram on the stack.
+     */
+    data.partial = (pco_frame_stats *) calloc (num_threads, sizeof(pco_frame_stats));
+
+    if (data.partial == NULL) {
+        memset (&single, 0, sizeof(single));
+        data.partial = &single;
+        num_threads = 1;
+    }
+
+    if (!run_rows (workers, stats_rows, &data, width, height, num_threads)) {
+        fprintf (stderr, "Unable to allocate line buffers for statistics\n");
+
+        if (data.partial != &single)
+            free (data.partial);
+
+        return PCO_ERROR_NOMEMORY;
+    }
+
+    stats->min = 0xFFFF;
+    stats->max = 0;
+    stats->sum = 0;
+    stats->num_saturated = 0;
+    memset (stats->histogram, 0, sizeof(stats->histogram));
+
+    for (int i = 0; i < num_threads; i++) {
+        const pco_frame_stats *partial = &data.partial[i];
+
+        stats->min = partial->min < stats->min ? partial->min : stats->min;
+        stats->max = partial->max > stats->max ? partial->max : stats->max;
+        stats->sum += partial->sum;
+        stats->num_saturated += partial->num_saturated;
+
+        for (int j = 0; j < PCO_HISTOGRAM_BINS; j++)
+            stats->histogram[j] += partial->histogram[j];
+    }
+
+    stats->num_pixels = (uint64_t) width * height;
+    stats->mean = stats->num_pixels > 0 ? (double) stats->sum / stats->num_pixels : 0.0;
+
+    if (data.partial != &single)
+        free (data.partial);
+
+    return PCO_NOERROR;
+}
+
+/*
+ * Compute statistics with the threads of #workers, used by
+ * pco_reorder_image_stats() to keep its threads across frames.
+ */
+unsigned int
+pco_reorder_5x12_stats_workers (pco_workers *workers, uint16_t *bufout, uint16_t *bufin, int width, int height,
+                                pco_frame_stats *stats)
+{
+    return reorder_stats (workers, bufout, bufin, width, height, true, stats);
+}
+
+unsigned int
+pco_reorder_5x16_stats_workers (pco_workers *workers, uint16_t *bufout, uint16_t *bufin, int width, int height,
+                                pco_frame_stats *stats)
+{
+    return reorder_stats (workers, bufout, bufin, width, height, false, stats);
+}
+
+/**
+ * Decode and re-order a pco.edge frame transferred in 5x12 format and compute
+ * statistics of the frame in the same pass. The histogram has one bin per 12
+ * bit value. The frame is processed by the calling thread, use
+ * pco_reorder_image_stats() to split it across the threads of a handle.
+ *
+ * @param bufout Memory for width * height 16 bit pixels
+ * @param bufin Raw frame as delivered by the frame grabber
+ * @param width Width of the frame in pixels
+ * @param height Height of the frame in pixels
+ * @param stats Statistics to fill or NULL to just re-order the frame. Pixels
+ * at or above its saturation_level are counted as saturated, if it is zero the
+ * maximum 12 bit value is used.
+ * @return Error code or PCO_NOERROR.
+ * @since 1.1
+ */
+unsigned int
+pco_reorder_image_5x12_stats (uint16_t *bufout, uint16_t *bufin, int width, int height,
+                              pco_frame_stats *stats)
+{
+    return reorder_stats (NULL, bufout, bufin, width, height, true, stats);
+}
+
+/**
+ * Re-order a pco.edge frame transferred in 5x16 format and compute statistics
+ * of the frame in the same pass. Each histogram bin covers 16 values.
+ *
+ * @param bufout Memory for width * height 16 bit pixels
+ * @param bufin Raw frame as delivered by the frame grabber
+ * @param width Width of the frame in pixels
+ * @param height Height of the frame in pixels
+ * @param stats Statistics to fill or NULL to just re-order the frame. Pixels
+ * at or above its saturation_level are counted as saturated, if it is zero
+ * 65535 is used.
+ * @return Error code or PCO_NOERROR.
+ * @since 1.1
+ * @see pco_reorder_image_5x12_stats()
+ */
+unsigned int
+pco_reorder_image_5x16_stats (uint16_t *bufout, uint16_t *bufin, int width, int height,
+                              pco_frame_stats *stats)
+{
+    return reorder_stats (NULL, bufout, bufin, width, height, false, stats);
+}
+
+/*
+ * Pack eight 12 bit pixels into three little-endian 32 bit words, least
+ * significant bits first.
+ */
+static inline void
+pack12_group (const uint16_t *px, uint32_t *out)
+{
+    out[0] = px[0] | ((uint32_t) px[1] << 12) | ((uint32_t) (px[2] & 0xFF) << 24);
+    out[1] = (px[2] >> 8) | ((uint32_t) px[3] << 4) | ((uint32_t) px[4] << 16) | ((uint32_t) (px[5] & 0xF) << 28);
+    out[2] = (px[5] >> 4) | ((uint32_t) px[6] << 8) | ((uint32_t) px[7] << 20);
+}
+
+static inline void
+unpack12_group (const uint32_t *in, uint16_t *px)
+{
+    px[0] = in[0] & 0xFFF;
+    px[1] = (in[0] >> 12) & 0xFFF;
+    px[2] = (in[0] >> 24) | ((in[1] & 0xF) << 8);
+    px[3] = (in[1] >> 4) & 0xFFF;
+    px[4] = (in[1] >> 16) & 0xFFF;
+    px[5] = (in[1] >> 28) | ((in[2] & 0xFF) << 4);
+    px[6] = (in[2] >> 8) & 0xFFF;
+    px[7] = in[2] >> 20;
+}
+
+/**
+ * Re-order a pco.edge frame transferred in 5x12 format while keeping the
+ * pixels packed. The pixels are re-arranged into the common packed 12 bit
+ * layout (also known as Mono12p) in which pixel i occupies bits 12 * i to
+ * 12 * i + 11 of the little-endian byte stream, i.e. two pixels take three
+ * bytes. Compared to pco_reorder_image_5x12(), the output needs a quarter less
+ * memory and bandwidth. Rows with an odd width are padded to a whole byte.
+ *
+ * @param bufout Memory for (width * 3 + 1) / 2 * height bytes
+ * @param bufin Raw frame as delivered by the frame grabber
+ * @param width Width of the frame in pixels
+ * @param height Height of the frame in pixels
+ * @since 1.1
+ * @see pco_unpack12()
+ */
+void
+pco_reorder_image_5x12_packed (uint8_t *bufout, uint16_t *bufin, int width, int height)
+{
+    const int off = line_words (width, true);
+    const size_t pitch = ((size_t) width * 3 + 1) / 2;
+    uint16_t px[8];
+
+    for (int y = 0; y < height; y++) {
+        const uint16_t *line = bufin + (size_t) y * off;
+        const uint16_t *in = line;
+        uint8_t *out = bufout + target_row (y, height) * pitch;
+
+        /* Neither lines nor rows need to be 4 byte aligned, groups are copied */
+        for (int x = 0; x < width / 8; x++, in += 6, out += 12) {
+            uint32_t group[3];
+
+            memcpy (group, in, sizeof(group));
+            unpack_group (group, px);
+            pack12_group (px, group);
+            memcpy (out, group, sizeof(group));
+        }
+
+        if (width % 8 != 0) {
+            for (int x = 0; x < width % 8; x++)
+                px[x] = get_pixel_5x12 (line, width - width % 8 + x);
+
+            pco_pack12 (out, px, width % 8);
+        }
+    }
+}
+
+/**
+ * Unpack pixels stored in the packed 12 bit layout written by
+ * pco_reorder_image_5x12_packed() into 16 bit pixels.
+ *
+ * @param bufout Memory for num_pixels 16 bit pixels
+ * @param bufin Packed pixels, i.e. (num_pixels * 3 + 1) / 2 bytes
+ * @param num_pixels Number of pixels to unpack
+ * @since 1.1
+ */
+void
+pco_unpack12 (uint16_t *bufout, const uint8_t *bufin, size_t num_pixels)
+{
+    size_t i = 0;
+
+    for (; i + 8 <= num_pixels; i += 8, bufin += 12) {
+        uint32_t in[3];
+
+        memcpy (in, bufin, sizeof(in));
+        unpack12_group (in, bufout + i);
+    }
+
+    for (int k = 0; i < num_pixels; i++, k++) {
+        const uint8_t *b = bufin + (k / 2) * 3;
+
+        bufout[i] = k % 2 == 0 ? b[0] | ((b[1] & 0xF) << 8) : (b[1] >> 4) | (b[2] << 4);
+    }
+}
+
+/**
+ * Pack 16 bit pixels into the packed 12 bit layout used by
+ * pco_reorder_image_5x12_packed(). Only the 12 least significant bits of each
+ * pixel are stored.
+ *
+ * @param bufout Memory for (num_pixels * 3 + 1) / 2 bytes
+ * @param bufin Pixels to pack
+ * @param num_pixels Number of pixels to pack
+ * @since 1.1
+ */
+void
+pco_pack12 (uint8_t *bufout, const uint16_t *bufin, size_t num_pixels)
+{
+    size_t i = 0;
+
+    for (; i + 8 <= num_pixels; i += 8, bufout += 12) {
+        uint16_t px[8];
+        uint32_t out[3];
+
+        for (int j = 0; j < 8; j++)
+            px[j] = bufin[i + j] & 0xFFF;
+
+        pack12_group (px, out);
+        memcpy (bufout, out, sizeof(out));
+    }
+
+    for (int k = 0; i < num_pixels; i++, k++) {
+        uint8_t *b = bufout + (k / 2) * 3;
+        const uint16_t v = bufin[i] & 0xFFF;
+
+        if (k % 2 == 0) {
+            b[0] = v & 0xFF;
+            b[1] = v >> 8;
+        }
+        else {
+            b[1] |= (v & 0xF) << 4;
+            b[2] = v >> 4;
+        }
+    }
+}
+
+static void
+reorder_stream (uint16_t *bufin, int width, int height, int batch_rows, bool packed,
+                pco_row_func func, void *user_data)
+{
+    const size_t line_size = width * sizeof(uint16_t);
+    const int off = line_words (width, packed);
+    uint16_t *top;
+    uint16_t *bottom;
+    int k;
+
+    if (batch_rows <= 0)
+        batch_rows = PCO_STREAM_BATCH_SIZE / (2 * line_size);
+
+    if (batch_rows > height / 2)
+        batch_rows = height / 2;
+
+    if (batch_rows < 1)
+        batch_rows = 1;
+
+    top = (uint16_t *) malloc (2 * batch_rows * line_size);
+
+    if (top == NULL) {
+        fprintf (stderr, "Unable to allocate batch buffer for streaming\n");
+        return;
+    }
+
+    bottom = top + (size_t) batch_rows * width;
+
+    for (k = 0; k < height / 2; k += batch_rows) {
+        const int n = k + batch_rows <= height / 2 ? batch_rows : height / 2 - k;
+
+        /* The lower half is stored upside down to hand out ascending rows */
+        for (int j = 0; j < n; j++) {
+            const uint16_t *line = bufin + (size_t) 2 * (k + j) * off;
+            uint16_t *out_top = top + (size_t) j * width;
+            uint16_t *out_bottom = bottom + (size_t) (n - 1 - j) * width;
+
+            if (packed) {
+                decode_line (width, out_top, (void *) line);
+                decode_line (width, out_bottom, (void *) (line + off));
+            }
+            else {
+                memcpy (out_top, line, line_size);
+                memcpy (out_bottom, line + off, line_size);
+            }
+        }
+
+        func (top, k, n, width, user_data);
+        func (bottom, height - k - n, n, width, user_data);
+    }
+
+    if (height % 2 == 1) {
+        const uint16_t *line = bufin + (size_t) (height - 1) * off;
+
+        if (packed)
+            decode_line (width, top, (void *) line);
+        else
+            memcpy (top, line, line_size);
+
+        func (top, height / 2, 1, width, user_data);
+    }
+
+    free (top);
+}
+
+/**
+ * Decode and re-order a pco.edge frame transferred in 5x12 format and hand the
+ * rows to #func in small batches instead of writing a complete frame. Each
+ * batch decodes #batch_rows line pairs and calls #func twice, once with the
+ * rows of the upper half and once with the mirrored rows of the lower half.
+ * Rows within one call are consecutive and in ascending order, the calls
+ * proceed from the top and the bottom towards the center. As a batch is
+ * small, #func works on rows that are still in the cache.
+ *
+ * @param bufin Raw frame as delivered by the frame grabber
+ * @param width Width of the frame in pixels
+ * @param height Height of the frame in pixels
+ * @param batch_rows Number of line pairs per batch or 0 to choose a batch size
+ * of about #PCO_STREAM_BATCH_SIZE bytes
+ * @param func Function called with each block of rows. The rows are only valid
+ * during the call.
+ * @param user_data Data passed to #func
+ * @since 1.1
+ */
+void
+pco_reorder_image_5x12_stream (uint16_t *bufin, int width, int height, int batch_rows,
+                               pco_row_func func, void *user_data)
+{
+    reorder_stream (bufin, width, height, batch_rows, true, func, user_data);
+}
+
+/**
+ * Re-order a pco.edge frame transferred in 5x16 format and hand the rows to
+ * #func in small batches.
+ *
+ * @param bufin Raw frame as delivered by the frame grabber
+ * @param width Width of the frame in pixels
+ * @param height Height of the frame in pixels
+ * @param batch_rows Number of line pairs per batch or 0 to choose a batch size
+ * of about #PCO_STREAM_BATCH_SIZE bytes
+ * @param func Function called with each block of rows
+ * @param user_data Data passed to #func
+ * @since 1.1
+ * @see pco_reorder_image_5x12_stream()
+ */
+void
+pco_reorder_image_5x16_stream (uint16_t *bufin, int width, int height, int batch_rows,
+                               pco_row_func func, void *user_data)
+{
+    reorder_stream (bufin, width, height, batch_rows, false, func, user_data);
+}
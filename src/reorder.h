@@ -0,0 +1,50 @@
+/* Copyright (C) 2011, 2012 Matthias Vogelgesang <matthias.vogelgesang@kit.edu>
+   (Karlsruhe Institute of Technology)
+
+   This library is free software; you can redistribute it and/or modify it
+   under the terms of the GNU Lesser General Public License as published by the
+   Free Software Foundation; either version 2.1 of the License, or (at your
+   option) any later version.
+
+   This library is distributed in the hope that it will be useful, but WITHOUT
+   ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+   FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+   details.
+
+   You should have received a copy of the GNU Lesser General Public License along
+   with this library; if not, write to the Free Software Foundation, Inc., 51
+   Franklin St, Fifth Floor, Boston, MA 02110, USA */
+
+#ifndef __PCO_REORDER_H
+#define __PCO_REORDER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "libpco.h"
+#include "workers.h"
+
+/*
+ * Re-order functions that are only called through a handle and keep their
+ * threads in a #pco_workers.
+ */
+typedef unsigned int (*pco_reorder_flat_field_workers_t) (pco_workers *workers, void *bufout, uint16_t *bufin,
+                                                          int width, int height, const float *dark,
+                                                          const float *gain, float scale, bool u16);
+
+unsigned int pco_reorder_5x12_flat_field_workers (pco_workers *workers, void *bufout, uint16_t *bufin,
+                                                  int width, int height, const float *dark,
+                                                  const float *gain, float scale, bool u16);
+unsigned int pco_reorder_5x16_flat_field_workers (pco_workers *workers, void *bufout, uint16_t *bufin,
+                                                  int width, int height, const float *dark,
+                                                  const float *gain, float scale, bool u16);
+
+typedef unsigned int (*pco_reorder_stats_workers_t) (pco_workers *workers, uint16_t *bufout, uint16_t *bufin,
+                                                     int width, int height, pco_frame_stats *stats);
+
+unsigned int pco_reorder_5x12_stats_workers (pco_workers *workers, uint16_t *bufout, uint16_t *bufin,
+                                             int width, int height, pco_frame_stats *stats);
+unsigned int pco_reorder_5x16_stats_workers (pco_workers *workers, uint16_t *bufout, uint16_t *bufin,
+                                             int width, int height, pco_frame_stats *stats);
+
+#endif
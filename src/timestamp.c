@@ -0,0 +1,196 @@
+/* Copyright (C) 2011, 2012 Matthias Vogelgesang <matthias.vogelgesang@kit.edu>
+   (Karlsruhe Institute of Technology)
+
+   This library is free software; you can redistribute it and/or modify it
+   under the terms of the GNU Lesser General Public License as published by the
+   Free Software Foundation; either version 2.1 of the License, or (at your
+   option) any later version.
+
+   This library is distributed in the hope that it will be useful, but WITHOUT
+   ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+   FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+   details.
+
+   You should have received a copy of the GNU Lesser General Public License along
+   with this library; if not, write to the Free Software Foundation, Inc., 51
+   Franklin St, Fifth Floor, Boston, MA 02110, USA */
+
+/*
+ * Binary time stamps. With TIMESTAMP_MODE_BINARY or
+ * TIMESTAMP_MODE_BINARYANDASCII the camera replaces the first pixels of each
+ * frame with a BCD coded image counter and the time of the exposure. Each
+ * pixel holds two BCD digits:
+ *
+ *  pixel  0 -  3   image counter, 8 digits
+ *  pixel  4 -  5   year, 4 digits
+ *  pixel  6 - 11   month, day, hour, minute, second, 2 digits each
+ *  pixel 12 - 13   microseconds, 6 digits
+ */
+
+#include "libpco.h"
+
+/* The image counter has 8 BCD digits and wraps from 99999999 to 0 */
+#define FRAME_NUMBER_RANGE  100000000
+
+/*
+ * Counters at most this far behind the last one are late or repeated frames,
+ * counters further behind either wrapped or the camera started counting anew.
+ */
+#define FRAME_NUMBER_WINDOW 1024
+
+/*
+ * Accumulate the two digits of pixel `i` onto `value`. Returns false if one of
+ * the digits is not a valid BCD digit.
+ */
+static inline bool
+add_digits (const uint16_t *pixels, int i, int shift, uint32_t *value)
+{
+    const uint8_t bcd = (uint8_t) (pixels[i] >> shift);
+    const uint8_t high = bcd >> 4;
+    const uint8_t low = bcd & 0x0F;
+
+    *value = *value * 100 + high * 10 + low;
+    return high <= 9 && low <= 9;
+}
+
+static inline bool
+parse_field (const uint16_t *pixels, int first, int count, int shift, uint32_t *value)
+{
+    bool valid = true;
+
+    *value = 0;
+
+    for (int i = first; i < first + count; i++)
+        valid = add_digits (pixels, i, shift, value) && valid;
+
+    return valid;
+}
+
+/**
+ * Parse the binary time stamp of a frame. Only the first
+ * #PCO_TIMESTAMP_PIXELS pixels are read, so this is cheap enough to be done for
+ * every frame.
+ *
+ * @param pixels First row of a re-ordered frame or the raw frame in 5x16
+ * format, both start with the time stamp
+ * @param shift Number of bits the BCD digits are shifted to the left within a
+ * pixel, 0 for LSB aligned pixels
+ * @param timestamp Location for the parsed time stamp
+ * @return Error code or PCO_NOERROR. PCO_ERROR_WRONGVALUE is returned if the
+ * pixels do not hold a valid time stamp, e.g. because time stamps are turned
+ * off.
+ * @since 1.1
+ */
+unsigned int
+pco_parse_timestamp (const uint16_t *pixels, int shift, pco_timestamp *timestamp)
+{
+    uint32_t frame_number, year, month, day, hour, minute, second, microseconds;
+    bool valid;
+
+    valid = parse_field (pixels, 0, 4, shift, &frame_number);
+    valid = parse_field (pixels, 4, 2, shift, &year) && valid;
+    valid = parse_field (pixels, 6, 1, shift, &month) && valid;
+    valid = parse_field (pixels, 7, 1, shift, &day) && valid;
+    valid = parse_field (pixels, 8, 1, shift, &hour) && valid;
+    valid = parse_field (pixels, 9, 1, shift, &minute) && valid;
+    valid = parse_field (pixels, 10, 1, shift, &second) && valid;
+    valid = parse_field (pixels, 11, 3, shift, &microseconds) && valid;
+
+    if (!valid || month < 1 || month > 12 || day < 1 || day > 31 ||
+        hour > 23 || minute > 59 || second > 59)
+        return PCO_ERROR_WRONGVALUE;
+
+    timestamp->frame_number = frame_number;
+    timestamp->microseconds = microseconds;
+    timestamp->year = (uint16_t) year;
+    timestamp->month = (uint8_t) month;
+    timestamp->day = (uint8_t) day;
+    timestamp->hour = (uint8_t) hour;
+    timestamp->minute = (uint8_t) minute;
+    timestamp->second = (uint8_t) second;
+    timestamp->reserved = 0;
+    return PCO_NOERROR;
+}
+
+/**
+ * Parse the binary time stamp of a raw frame transferred in 5x12 format. Only
+ * the pixels holding the time stamp are decoded.
+ *
+ * @param bufin Raw frame as delivered by the frame grabber
+ * @param shift Number of bits the BCD digits are shifted to the left within a
+ * pixel, 0 for LSB aligned pixels
+ * @param timestamp Location for the parsed time stamp
+ * @return Error code or PCO_NOERROR.
+ * @since 1.1
+ * @see pco_parse_timestamp()
+ */
+unsigned int
+pco_parse_timestamp_5x12 (const uint16_t *bufin, int shift, pco_timestamp *timestamp)
+{
+    uint16_t pixels[PCO_TIMESTAMP_PIXELS];
+
+    /* The first raw line is the first row, so decode it as a one-line frame */
+    pco_reorder_image_5x12_roi (pixels, (uint16_t *) bufin, PCO_TIMESTAMP_PIXELS, 1,
+                                0, 0, PCO_TIMESTAMP_PIXELS, 1);
+
+    return pco_parse_timestamp (pixels, shift, timestamp);
+}
+
+/**
+ * Reset a frame tracker before the first frame of a stream.
+ *
+ * @param tracker A #pco_frame_tracker
+ * @since 1.1
+ */
+void
+pco_init_frame_tracker (pco_frame_tracker *tracker)
+{
+    tracker->num_frames = 0;
+    tracker->num_dropped = 0;
+    tracker->num_duplicated = 0;
+    tracker->last_frame_number = 0;
+    tracker->num_restarts = 0;
+}
+
+/**
+ * Check the image counter of the next frame of a stream against the previous
+ * one. Gaps in the sequence are counted as dropped frames. A counter that
+ * repeats the last one or is up to 1024 behind it is counted as a duplicated
+ * frame. The counter wraps from 99999999 to 0, a gap across the wrap is
+ * counted as usual. Any other jump back, e.g. after the camera was re-armed,
+ * restarts tracking from the new counter without counting dropped frames.
+ *
+ * @param tracker A #pco_frame_tracker initialized with pco_init_frame_tracker()
+ * @param frame_number Image counter of the frame, e.g. from pco_parse_timestamp()
+ * @return Number of frames dropped right before this one, 0 if the frame
+ * follows its predecessor or tracking restarted and -1 if it is a duplicate.
+ * @since 1.1
+ */
+int64_t
+pco_track_frame (pco_frame_tracker *tracker, uint32_t frame_number)
+{
+    const uint32_t last = tracker->last_frame_number;
+    int64_t gap = 0;
+
+    if (tracker->num_frames > 0) {
+        if (frame_number > last)
+            gap = (int64_t) frame_number - last - 1;
+        else if (last - frame_number <= FRAME_NUMBER_WINDOW)
+            gap = -1;
+        else if (last < FRAME_NUMBER_RANGE && (int64_t) FRAME_NUMBER_RANGE - last + frame_number <= FRAME_NUMBER_WINDOW)
+            gap = (int64_t) FRAME_NUMBER_RANGE - last + frame_number - 1;
+        else
+            tracker->num_restarts++;
+    }
+
+    if (gap > 0)
+        tracker->num_dropped += gap;
+
+    if (gap < 0)
+        tracker->num_duplicated++;
+    else
+        tracker->last_frame_number = frame_number;
+
+    tracker->num_frames++;
+    return gap;
+}
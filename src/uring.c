@@ -0,0 +1,230 @@
+/* Copyright (C) 2011, 2012 Matthias Vogelgesang <matthias.vogelgesang@kit.edu>
+   (Karlsruhe Institute of Technology)
+
+   This library is free software; you can redistribute it and/or modify it
+   under the terms of the GNU Lesser General Public License as published by the
+   Free Software Foundation; either version 2.1 of the License, or (at your
+   option) any later version.
+
+   This library is distributed in the hope that it will be useful, but WITHOUT
+   ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+   FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+   details.
+
+   You should have received a copy of the GNU Lesser General Public License along
+   with this library; if not, write to the Free Software Foundation, Inc., 51
+   Franklin St, Fifth Floor, Boston, MA 02110, USA */
+
+#define _GNU_SOURCE
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+
+#include "uring.h"
+
+struct pco_uring_t {
+    int fd;
+    unsigned int num_entries;
+    unsigned int num_pending;   /* queued but not submitted */
+
+    void *sq_map;
+    size_t sq_map_size;
+    void *cq_map;
+    size_t cq_map_size;
+    struct io_uring_sqe *sqes;
+
+    unsigned int *sq_head;
+    unsigned int *sq_tail;
+    unsigned int *sq_mask;
+    unsigned int *sq_array;
+
+    unsigned int *cq_head;
+    unsigned int *cq_tail;
+    unsigned int *cq_mask;
+    struct io_uring_cqe *cqes;
+};
+
+static void *
+map_ring (int fd, size_t size, off_t offset)
+{
+    void *map = mmap (NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, offset);
+
+    return map == MAP_FAILED ? NULL : map;
+}
+
+/**
+ * Create a ring for #entries requests in flight.
+ *
+ * @return A new ring or NULL if io_uring is not available, e.g. because the
+ * kernel is too old or io_uring is disabled
+ */
+pco_uring *
+pco_uring_new (unsigned int entries)
+{
+    struct io_uring_params params;
+    pco_uring *ring;
+    uint8_t *sq, *cq;
+
+    ring = (pco_uring *) calloc (1, sizeof(pco_uring));
+
+    if (ring == NULL)
+        return NULL;
+
+    memset (&params, 0, sizeof(params));
+    ring->fd = (int) syscall (__NR_io_uring_setup, entries, &params);
+
+    if (ring->fd < 0) {
+        free (ring);
+        return NULL;
+    }
+
+    ring->num_entries = params.sq_entries;
+    ring->sq_map_size = params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+    ring->cq_map_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        if (ring->cq_map_size > ring->sq_map_size)
+            ring->sq_map_size = ring->cq_map_size;
+
+        ring->cq_map_size = 0;
+    }
+
+    ring->sq_map = map_ring (ring->fd, ring->sq_map_size, IORING_OFF_SQ_RING);
+    ring->cq_map = ring->cq_map_size == 0 ? ring->sq_map : map_ring (ring->fd, ring->cq_map_size, IORING_OFF_CQ_RING);
+    ring->sqes = (struct io_uring_sqe *) map_ring (ring->fd, params.sq_entries * sizeof(struct io_uring_sqe), IORING_OFF_SQES);
+
+    if (ring->sq_map == NULL || ring->cq_map == NULL || ring->sqes == NULL) {
+        pco_uring_free (ring);
+        return NULL;
+    }
+
+    sq = (uint8_t *) ring->sq_map;
+    ring->sq_head = (unsigned int *) (sq + params.sq_off.head);
+    ring->sq_tail = (unsigned int *) (sq + params.sq_off.tail);
+    ring->sq_mask = (unsigned int *) (sq + params.sq_off.ring_mask);
+    ring->sq_array = (unsigned int *) (sq + params.sq_off.array);
+
+    cq = (uint8_t *) ring->cq_map;
+    ring->cq_head = (unsigned int *) (cq + params.cq_off.head);
+    ring->cq_tail = (unsigned int *) (cq + params.cq_off.tail);
+    ring->cq_mask = (unsigned int *) (cq + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe *) (cq + params.cq_off.cqes);
+    return ring;
+}
+
+void
+pco_uring_free (pco_uring *ring)
+{
+    if (ring == NULL)
+        return;
+
+    if (ring->sqes != NULL)
+        munmap (ring->sqes, ring->num_entries * sizeof(struct io_uring_sqe));
+
+    if (ring->cq_map != NULL && ring->cq_map != ring->sq_map)
+        munmap (ring->cq_map, ring->cq_map_size);
+
+    if (ring->sq_map != NULL)
+        munmap (ring->sq_map, ring->sq_map_size);
+
+    close (ring->fd);
+    free (ring);
+}
+
+/**
+ * Signal #eventfd whenever a write finishes, so that a thread can wait for
+ * finished writes together with other events.
+ *
+ * @return false if the eventfd could not be registered
+ */
+bool
+pco_uring_set_eventfd (pco_uring *ring, int eventfd)
+{
+    return syscall (__NR_io_uring_register, ring->fd, IORING_REGISTER_EVENTFD, &eventfd, 1) == 0;
+}
+
+/**
+ * Queue a write of #length bytes at #offset. It is started with
+ * pco_uring_submit().
+ *
+ * @return false if the submission queue is full
+ */
+bool
+pco_uring_write (pco_uring *ring, int fd, const void *buffer, size_t length, uint64_t offset, uint64_t user_data)
+{
+    unsigned int tail = *ring->sq_tail;
+    unsigned int index;
+    struct io_uring_sqe *sqe;
+
+    if (tail - __atomic_load_n (ring->sq_head, __ATOMIC_ACQUIRE) >= ring->num_entries)
+        return false;
+
+    index = tail & *ring->sq_mask;
+    sqe = &ring->sqes[index];
+    memset (sqe, 0, sizeof(struct io_uring_sqe));
+    sqe->opcode = IORING_OP_WRITE;
+    sqe->fd = fd;
+    sqe->addr = (uint64_t) (uintptr_t) buffer;
+    sqe->len = (uint32_t) length;
+    sqe->off = offset;
+    sqe->user_data = user_data;
+
+    ring->sq_array[index] = index;
+    __atomic_store_n (ring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+    ring->num_pending++;
+    return true;
+}
+
+/**
+ * Start all queued writes.
+ *
+ * @return Number of writes started or a negative errno
+ */
+int
+pco_uring_submit (pco_uring *ring)
+{
+    int submitted;
+
+    if (ring->num_pending == 0)
+        return 0;
+
+    submitted = (int) syscall (__NR_io_uring_enter, ring->fd, ring->num_pending, 0, 0, NULL, 0);
+
+    if (submitted > 0)
+        ring->num_pending -= submitted;
+
+    return submitted;
+}
+
+/**
+ * Collect up to #max_results finished writes. Each write yields its user data
+ * and the number of bytes written or a negative errno.
+ *
+ * @param wait true to wait for at least one write to finish
+ * @return Number of finished writes
+ */
+unsigned int
+pco_uring_reap (pco_uring *ring, uint64_t *user_data, int32_t *results, unsigned int max_results, bool wait)
+{
+    unsigned int head = *ring->cq_head;
+    unsigned int n = 0;
+
+    if (wait && head == __atomic_load_n (ring->cq_tail, __ATOMIC_ACQUIRE))
+        syscall (__NR_io_uring_enter, ring->fd, 0, 1, IORING_ENTER_GETEVENTS, NULL, 0);
+
+    while (n < max_results && head != __atomic_load_n (ring->cq_tail, __ATOMIC_ACQUIRE)) {
+        struct io_uring_cqe *cqe = &ring->cqes[head & *ring->cq_mask];
+
+        user_data[n] = cqe->user_data;
+        results[n] = cqe->res;
+        head++;
+        n++;
+    }
+
+    __atomic_store_n (ring->cq_head, head, __ATOMIC_RELEASE);
+    return n;
+}
@@ -0,0 +1,38 @@
+/* Copyright (C) 2011, 2012 Matthias Vogelgesang <matthias.vogelgesang@kit.edu>
+   (Karlsruhe Institute of Technology)
+
+   This library is free software; you can redistribute it and/or modify it
+   under the terms of the GNU Lesser General Public License as published by the
+   Free Software Foundation; either version 2.1 of the License, or (at your
+   option) any later version.
+
+   This library is distributed in the hope that it will be useful, but WITHOUT
+   ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+   FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+   details.
+
+   You should have received a copy of the GNU Lesser General Public License along
+   with this library; if not, write to the Free Software Foundation, Inc., 51
+   Franklin St, Fifth Floor, Boston, MA 02110, USA */
+
+#ifndef __PCO_URING_H
+#define __PCO_URING_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Minimal io_uring for asynchronous writes, using the system calls directly.
+ * A ring must only be used by one thread.
+ */
+typedef struct pco_uring_t pco_uring;
+
+pco_uring *pco_uring_new (unsigned int entries);
+void pco_uring_free (pco_uring *ring);
+bool pco_uring_set_eventfd (pco_uring *ring, int eventfd);
+bool pco_uring_write (pco_uring *ring, int fd, const void *buffer, size_t length, uint64_t offset, uint64_t user_data);
+int pco_uring_submit (pco_uring *ring);
+unsigned int pco_uring_reap (pco_uring *ring, uint64_t *user_data, int32_t *results, unsigned int max_results, bool wait);
+
+#endif
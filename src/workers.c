@@ -0,0 +1,196 @@
+/* Copyright (C) 2011, 2012 Matthias Vogelgesang <matthias.vogelgesang@kit.edu>
+   (Karlsruhe Institute of Technology)
+
+   This library is free software; you can redistribute it and/or modify it
+   under the terms of the GNU Lesser General Public License as published by the
+   Free Software Foundation; either version 2.1 of the License, or (at your
+   option) any later version.
+
+   This library is distributed in the hope that it will be useful, but WITHOUT
+   ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+   FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+   details.
+
+   You should have received a copy of the GNU Lesser General Public License along
+   with this library; if not, write to the Free Software Foundation, Inc., 51
+   Franklin St, Fifth Floor, Boston, MA 02110, USA */
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#include "workers.h"
+#include "libpco.h"
+
+typedef struct {
+    pco_workers *workers;
+    int index;
+} worker;
+
+/*
+ * Each call of pco_workers_run() starts a new generation. A worker runs the
+ * task with its index once it sees a generation it has not run yet, and the
+ * caller waits until all workers with a task are done.
+ */
+struct pco_workers_t {
+    pthread_mutex_t lock;
+    pthread_cond_t start;
+    pthread_cond_t done;
+    uint64_t generation;
+    pco_workers_func func;
+    void *data;
+    int num_tasks;
+    int num_pending;
+    int num_threads;        /* including the caller */
+    int num_started;        /* workers actually running, 1 .. num_started - 1 */
+    bool quit;
+    pthread_t threads[PCO_MAX_REORDER_THREADS];
+    worker workers[PCO_MAX_REORDER_THREADS];
+};
+
+static void *
+run_worker (void *arg)
+{
+    worker *self = (worker *) arg;
+    pco_workers *workers = self->workers;
+    uint64_t generation = 0;
+
+    pthread_mutex_lock (&workers->lock);
+
+    while (1) {
+        pco_workers_func func;
+        void *data;
+
+        while (!workers->quit && workers->generation == generation)
+            pthread_cond_wait (&workers->start, &workers->lock);
+
+        if (workers->quit)
+            break;
+
+        generation = workers->generation;
+
+        if (self->index >= workers->num_tasks)
+            continue;
+
+        func = workers->func;
+        data = workers->data;
+        pthread_mutex_unlock (&workers->lock);
+
+        func (data, self->index);
+
+        pthread_mutex_lock (&workers->lock);
+
+        if (--workers->num_pending == 0)
+            pthread_cond_signal (&workers->done);
+    }
+
+    pthread_mutex_unlock (&workers->lock);
+    return NULL;
+}
+
+/**
+ * Start #num_threads - 1 worker threads, the caller of pco_workers_run() being
+ * the last one. Threads that cannot be started are not an error, their tasks
+ * are run by the caller.
+ *
+ * @param num_threads Number of threads between 1 and #PCO_MAX_REORDER_THREADS
+ * @return New workers or NULL
+ */
+pco_workers *
+pco_workers_new (int num_threads)
+{
+    pco_workers *workers;
+
+    if (num_threads < 1 || num_threads > PCO_MAX_REORDER_THREADS)
+        return NULL;
+
+    workers = (pco_workers *) calloc (1, sizeof(pco_workers));
+
+    if (workers == NULL)
+        return NULL;
+
+    pthread_mutex_init (&workers->lock, NULL);
+    pthread_cond_init (&workers->start, NULL);
+    pthread_cond_init (&workers->done, NULL);
+    workers->num_threads = num_threads;
+    workers->num_started = 1;
+
+    for (int i = 1; i < num_threads; i++) {
+        pthread_t thread;
+
+        workers->workers[i].workers = workers;
+        workers->workers[i].index = i;
+
+        if (pthread_create (&thread, NULL, run_worker, &workers->workers[i]) != 0)
+            break;
+
+        workers->threads[i] = thread;
+        workers->num_started = i + 1;
+    }
+
+    return workers;
+}
+
+void
+pco_workers_free (pco_workers *workers)
+{
+    if (workers == NULL)
+        return;
+
+    pthread_mutex_lock (&workers->lock);
+    workers->quit = true;
+    pthread_cond_broadcast (&workers->start);
+    pthread_mutex_unlock (&workers->lock);
+
+    for (int i = 1; i < workers->num_started; i++)
+        pthread_join (workers->threads[i], NULL);
+
+    pthread_cond_destroy (&workers->done);
+    pthread_cond_destroy (&workers->start);
+    pthread_mutex_destroy (&workers->lock);
+    free (workers);
+}
+
+int
+pco_workers_get_num_threads (pco_workers *workers)
+{
+    return workers->num_threads;
+}
+
+/**
+ * Run #func for the indices 0 .. #num_tasks - 1 and return once all of them
+ * are done. Not to be called from several threads at the same time.
+ *
+ * @param workers Workers from pco_workers_new()
+ * @param num_tasks Number of tasks, at most the number of threads
+ * @param func Function called with #data and the task index
+ * @param data Passed to #func
+ */
+void
+pco_workers_run (pco_workers *workers, int num_tasks, pco_workers_func func, void *data)
+{
+    const int num_started = num_tasks < workers->num_started ? num_tasks : workers->num_started;
+
+    pthread_mutex_lock (&workers->lock);
+    workers->func = func;
+    workers->data = data;
+    workers->num_tasks = num_started;
+    workers->num_pending = num_started - 1;
+    workers->generation++;
+    pthread_cond_broadcast (&workers->start);
+    pthread_mutex_unlock (&workers->lock);
+
+    func (data, 0);
+
+    /* Tasks of threads that could not be started are done by the caller */
+    for (int i = num_started; i < num_tasks; i++)
+        func (data, i);
+
+    pthread_mutex_lock (&workers->lock);
+
+    while (workers->num_pending > 0)
+        pthread_cond_wait (&workers->done, &workers->lock);
+
+    pthread_mutex_unlock (&workers->lock);
+}
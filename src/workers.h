@@ -0,0 +1,35 @@
+/* Copyright (C) 2011, 2012 Matthias Vogelgesang <matthias.vogelgesang@kit.edu>
+   (Karlsruhe Institute of Technology)
+
+   This library is free software; you can redistribute it and/or modify it
+   under the terms of the GNU Lesser General Public License as published by the
+   Free Software Foundation; either version 2.1 of the License, or (at your
+   option) any later version.
+
+   This library is distributed in the hope that it will be useful, but WITHOUT
+   ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+   FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+   details.
+
+   You should have received a copy of the GNU Lesser General Public License along
+   with this library; if not, write to the Free Software Foundation, Inc., 51
+   Franklin St, Fifth Floor, Boston, MA 02110, USA */
+
+#ifndef __PCO_WORKERS_H
+#define __PCO_WORKERS_H
+
+/*
+ * Threads that are started once and then run tasks on request, so that the
+ * per-frame re-order functions do not create and join threads for every frame.
+ * The caller of pco_workers_run() runs task 0 itself.
+ */
+typedef struct pco_workers_t pco_workers;
+
+typedef void (*pco_workers_func) (void *data, int index);
+
+pco_workers *pco_workers_new (int num_threads);
+void pco_workers_free (pco_workers *workers);
+int pco_workers_get_num_threads (pco_workers *workers);
+void pco_workers_run (pco_workers *workers, int num_tasks, pco_workers_func func, void *data);
+
+#endif
@@ -0,0 +1,837 @@
+/* Copyright (C) 2011, 2012 Matthias Vogelgesang <matthias.vogelgesang@kit.edu>
+   (Karlsruhe Institute of Technology)
+
+   This library is free software; you can redistribute it and/or modify it
+   under the terms of the GNU Lesser General Public License as published by the
+   Free Software Foundation; either version 2.1 of the License, or (at your
+   option) any later version.
+
+   This library is distributed in the hope that it will be useful, but WITHOUT
+   ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+   FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+   details.
+
+   You should have received a copy of the GNU Lesser General Public License along
+   with this library; if not, write to the Free Software Foundation, Inc., 51
+   Franklin St, Fifth Floor, Boston, MA 02110, USA */
+
+/*
+ * Streaming writer for acquired frames. Frames are written straight from the
+ * buffers of the acquisition with direct I/O, bypassing the page cache. A
+ * writer thread keeps several writes in flight, either through io_uring or,
+ * where io_uring is not available, through a pool of threads calling
+ * pwrite(). The writer holds a reference to each frame until it is written,
+ * the memory it pins is bounded by a fixed budget.
+ *
+ * Frames are written into a sequence of recordings named
+ * <prefix>-000000.pcoraw, <prefix>-000001.pcoraw and so on, laid out as
+ * described in recording.h. Each frame occupies a multiple of 4 KB, the
+ * alignment required for direct I/O. The index of a recording is kept in
+ * memory and appended when the file is closed.
+ *
+ * The writer thread sleeps on an eventfd while there is nothing to do. It is
+ * signalled by the ring for each finished write, by the write threads and by
+ * pco_writer_write() if the writer thread is about to sleep. The write
+ * threads wait on a condition variable for writes to be submitted, as does
+ * pco_writer_flush() for the last write.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/eventfd.h>
+
+#include "libpco.h"
+#include "queue.h"
+#include "uring.h"
+#include "recording.h"
+
+#define WRITE_ALIGNMENT     PCO_RECORDING_ALIGNMENT
+#define MAX_IN_FLIGHT       8
+#define MAX_QUEUED_FRAMES   1024
+#define NUM_WRITE_THREADS   4
+
+typedef struct {
+    uint64_t offset;
+    uint64_t record;
+    uint64_t written;           /* by previous, short writes */
+    int64_t result;
+    pco_frame frame;
+    size_t length;
+    int fd;
+} write_job;
+
+struct pco_writer_t {
+    /* Shared by several threads, kept first to be naturally aligned */
+    pthread_mutex_t lock;
+    pthread_cond_t submitted_cond;
+    pthread_cond_t done_cond;
+    uint64_t num_frames;
+    uint64_t num_bytes;
+    uint64_t num_dropped;
+    uint64_t num_queued;
+    uint64_t num_done;
+    uint32_t num_flushing;      /* threads waiting in pco_writer_flush() */
+
+    char *prefix;
+    uint64_t max_file_size;
+    size_t max_memory;
+
+    pco_queue *input;           /* frames waiting to be written */
+
+    pco_recording_info info;
+    pco_recording_header *header;   /* page for direct I/O */
+    pco_recording_record *records;
+    uint64_t num_records;
+    uint64_t max_records;
+
+    int fd;
+    unsigned int file_index;
+    uint64_t file_offset;
+    uint64_t frame_size;
+    uint64_t frame_stride;
+    bool direct;
+
+    write_job jobs[MAX_IN_FLIGHT];
+    uint64_t free_jobs[MAX_IN_FLIGHT];
+    unsigned int num_free_jobs;
+
+    /* Either a ring or queues to and from the write threads */
+    pco_uring *ring;
+    pco_queue *submitted;
+    pco_queue *completed;
+
+    pthread_t threads[1 + NUM_WRITE_THREADS];
+    int num_threads;
+    int wake_fd;                /* eventfd the dispatcher sleeps on */
+    bool sleeping;              /* set while the dispatcher is about to sleep */
+    bool stop;                  /* set for the dispatcher */
+    bool stop_writing;          /* set for the write threads */
+};
+
+static bool
+is_set (bool *flag)
+{
+    return __atomic_load_n (flag, __ATOMIC_ACQUIRE);
+}
+
+static size_t
+get_frame_size (pco_frame frame)
+{
+    return pco_frame_get_data_size (frame);
+}
+
+/*
+ * The decoded frame buffers of an acquisition are 4 KB aligned and padded to a
+ * multiple of 4 KB, so the padded frame can be written as it is.
+ */
+static size_t
+get_write_length (pco_frame frame)
+{
+    return (get_frame_size (frame) + WRITE_ALIGNMENT - 1) / WRITE_ALIGNMENT * WRITE_ALIGNMENT;
+}
+
+static bool
+write_all (int fd, const void *data, size_t length, uint64_t offset)
+{
+    const uint8_t *p = (const uint8_t *) data;
+
+    while (length > 0) {
+        ssize_t result = pwrite (fd, p, length, (off_t) offset);
+
+        if (result < 0 && errno == EINTR)
+            continue;
+
+        if (result <= 0)
+            return false;
+
+        p += result;
+        offset += result;
+        length -= result;
+    }
+
+    return true;
+}
+
+static bool
+write_index (pco_writer writer)
+{
+    pco_recording_trailer trailer;
+    size_t length = writer->num_records * sizeof(pco_recording_record);
+    int flags = fcntl (writer->fd, F_GETFL);
+
+    memcpy (trailer.magic, PCO_RECORDING_INDEX_MAGIC, sizeof(trailer.magic));
+    trailer.num_frames = writer->num_records;
+    trailer.index_offset = writer->file_offset;
+
+    /* The index is not page sized, so it is written through the page cache */
+    if (writer->direct && fcntl (writer->fd, F_SETFL, flags & ~O_DIRECT) != 0)
+        return false;
+
+    return write_all (writer->fd, writer->records, length, writer->file_offset) &&
+           write_all (writer->fd, &trailer, sizeof(trailer), writer->file_offset + length);
+}
+
+static void
+close_file (pco_writer writer)
+{
+    if (writer->fd < 0)
+        return;
+
+    /* Cut off what was preallocated but not written, then append the index */
+    if (ftruncate (writer->fd, writer->file_offset) != 0 || !write_index (writer) || close (writer->fd) != 0)
+        fprintf (stderr, "Could not close %s-%06u%s: %s\n", writer->prefix, writer->file_index,
+                 PCO_RECORDING_EXTENSION, strerror (errno));
+
+    writer->fd = -1;
+    writer->file_index++;
+}
+
+static bool
+write_header (pco_writer writer, pco_frame frame)
+{
+    pco_recording_header *header = writer->header;
+    uint32_t width, height;
+
+    pco_frame_get_size (frame, &width, &height);
+    memset (header, 0, WRITE_ALIGNMENT);
+    memcpy (header->magic, PCO_RECORDING_MAGIC, sizeof(header->magic));
+    header->version = PCO_RECORDING_VERSION;
+    header->header_size = WRITE_ALIGNMENT;
+    header->frame_size = writer->frame_size;
+    header->frame_stride = writer->frame_stride;
+    header->info = writer->info;
+    header->info.width = width;
+    header->info.height = height;
+    header->info.format = pco_frame_get_format (frame);
+
+    return write_all (writer->fd, header, WRITE_ALIGNMENT, 0);
+}
+
+static bool
+open_file (pco_writer writer, pco_frame frame)
+{
+    char *filename;
+    int flags = O_WRONLY | O_CREAT | O_TRUNC;
+
+    filename = (char *) malloc (strlen (writer->prefix) + 16);
+
+    if (filename == NULL)
+        return false;
+
+    sprintf (filename, "%s-%06u%s", writer->prefix, writer->file_index, PCO_RECORDING_EXTENSION);
+
+    /* Not all file systems support direct I/O, e.g. tmpfs */
+    writer->fd = open (filename, flags | O_DIRECT, 0644);
+    writer->direct = writer->fd >= 0;
+
+    if (writer->fd < 0 && errno == EINVAL)
+        writer->fd = open (filename, flags, 0644);
+
+    if (writer->fd < 0) {
+        fprintf (stderr, "Could not open %s: %s\n", filename, strerror (errno));
+        free (filename);
+        return false;
+    }
+
+    /* Reserve the whole file up front so writes do not allocate extents */
+    fallocate (writer->fd, 0, 0, (off_t) writer->max_file_size);
+
+    writer->frame_size = get_frame_size (frame);
+    writer->frame_stride = get_write_length (frame);
+    writer->file_offset = WRITE_ALIGNMENT;
+    writer->num_records = 0;
+
+    if (!write_header (writer, frame)) {
+        fprintf (stderr, "Could not write header of %s: %s\n", filename, strerror (errno));
+        close (writer->fd);
+        writer->fd = -1;
+        free (filename);
+        return false;
+    }
+
+    free (filename);
+    return true;
+}
+
+static pco_recording_record *
+add_record (pco_writer writer, pco_frame frame)
+{
+    pco_recording_record *record;
+
+    if (writer->num_records == writer->max_records) {
+        uint64_t max_records = writer->max_records > 0 ? 2 * writer->max_records : 1024;
+        pco_recording_record *records;
+
+        records = (pco_recording_record *) realloc (writer->records, max_records * sizeof(pco_recording_record));
+
+        if (records == NULL)
+            return NULL;
+
+        writer->records = records;
+        writer->max_records = max_records;
+    }
+
+    record = &writer->records[writer->num_records++];
+    memset (record, 0, sizeof(pco_recording_record));
+    record->number = pco_frame_get_number (frame);
+    record->offset = writer->file_offset;
+
+    if (pco_frame_get_timestamp (frame, &record->timestamp) == PCO_NOERROR)
+        record->flags |= PCO_RECORD_HAS_TIMESTAMP;
+
+    return record;
+}
+
+/*
+ * A frame starts a new file if it does not fit together with the grown index
+ * or if its size differs from the frames already in the file.
+ */
+static bool
+needs_new_file (pco_writer writer, pco_frame frame, size_t length)
+{
+    uint64_t index_size = (writer->num_records + 1) * sizeof(pco_recording_record) + sizeof(pco_recording_trailer);
+
+    if (writer->fd < 0 || writer->num_records == 0)
+        return false;
+
+    return writer->file_offset + length + index_size > writer->max_file_size ||
+           get_frame_size (frame) != writer->frame_size;
+}
+
+/*
+ * Count a frame as written or dropped and wake up pco_writer_flush(). Like in
+ * wait_for_work(), the fences keep the flushing thread and this one from
+ * missing each other.
+ */
+static void
+count_done (pco_writer writer)
+{
+    __atomic_fetch_add (&writer->num_done, 1, __ATOMIC_RELEASE);
+    __atomic_thread_fence (__ATOMIC_SEQ_CST);
+
+    if (__atomic_load_n (&writer->num_flushing, __ATOMIC_RELAXED) == 0)
+        return;
+
+    pthread_mutex_lock (&writer->lock);
+    pthread_cond_broadcast (&writer->done_cond);
+    pthread_mutex_unlock (&writer->lock);
+}
+
+static void
+wake_dispatcher (pco_writer writer)
+{
+    uint64_t value = 1;
+
+    if (write (writer->wake_fd, &value, sizeof(value)) != sizeof(value))
+        fprintf (stderr, "Could not wake writer thread: %s\n", strerror (errno));
+}
+
+/*
+ * Sleep until a write finishes, the writer is stopped or, if #want_input is
+ * set, a frame is queued. Wakeups left from events that were handled already
+ * only cause another round of the caller.
+ */
+static void
+wait_for_work (pco_writer writer, bool want_input)
+{
+    uint64_t value;
+
+    __atomic_store_n (&writer->sleeping, true, __ATOMIC_SEQ_CST);
+    __atomic_thread_fence (__ATOMIC_SEQ_CST);
+
+    /* pco_writer_write() only signals if it sees the flag, check once more */
+    if (!(want_input && pco_queue_get_depth (writer->input) > 0) && !is_set (&writer->stop)) {
+        while (read (writer->wake_fd, &value, sizeof(value)) < 0 && errno == EINTR)
+            ;
+    }
+
+    __atomic_store_n (&writer->sleeping, false, __ATOMIC_RELAXED);
+}
+
+static bool
+start_write_threads (pco_writer writer);
+
+/*
+ * Write what is left of a job, through the ring if possible and otherwise
+ * through the write threads.
+ */
+static bool
+submit_job (pco_writer writer, uint64_t index)
+{
+    write_job *job = &writer->jobs[index];
+
+    if (writer->ring != NULL) {
+        if (pco_uring_write (writer->ring, job->fd, (const uint8_t *) pco_frame_get_data (job->frame) + job->written,
+                             job->length - job->written, job->offset + job->written, index)) {
+            pco_uring_submit (writer->ring);
+            return true;
+        }
+
+        if (!start_write_threads (writer))
+            return false;
+    }
+
+    pthread_mutex_lock (&writer->lock);
+    pco_queue_push (writer->submitted, index);
+    pthread_cond_signal (&writer->submitted_cond);
+    pthread_mutex_unlock (&writer->lock);
+    return true;
+}
+
+static void
+finish_job (pco_writer writer, uint64_t index, int64_t result)
+{
+    write_job *job = &writer->jobs[index];
+
+    if (result > 0)
+        job->written += result;
+
+    /* Continue a short write where it stopped */
+    if (result > 0 && job->written < job->length && submit_job (writer, index))
+        return;
+
+    if (job->written == job->length) {
+        __atomic_fetch_add (&writer->num_frames, 1, __ATOMIC_RELAXED);
+        __atomic_fetch_add (&writer->num_bytes, job->length, __ATOMIC_RELAXED);
+    }
+    else {
+        fprintf (stderr, "Could not write frame %llu: %s\n", (unsigned long long) pco_frame_get_number (job->frame),
+                 result < 0 ? strerror ((int) -result) : "short write");
+        writer->records[job->record].flags |= PCO_RECORD_MISSING;
+        __atomic_fetch_add (&writer->num_dropped, 1, __ATOMIC_RELAXED);
+    }
+
+    pco_frame_unref (job->frame);
+    writer->free_jobs[writer->num_free_jobs++] = index;
+    count_done (writer);
+}
+
+/*
+ * Finish the writes that are done, without waiting. Writes are finished by the
+ * ring or, if it is not available or was full, by the write threads.
+ */
+static unsigned int
+reap_jobs (pco_writer writer)
+{
+    uint64_t indices[MAX_IN_FLIGHT];
+    unsigned int n, total = 0;
+
+    if (writer->ring != NULL) {
+        int32_t results[MAX_IN_FLIGHT];
+
+        /* Retry writes that could not be submitted before */
+        pco_uring_submit (writer->ring);
+        n = pco_uring_reap (writer->ring, indices, results, MAX_IN_FLIGHT, false);
+
+        for (unsigned int i = 0; i < n; i++)
+            finish_job (writer, indices[i], results[i]);
+
+        total += n;
+    }
+
+    n = pco_queue_pop (writer->completed, indices, MAX_IN_FLIGHT);
+
+    for (unsigned int i = 0; i < n; i++)
+        finish_job (writer, indices[i], writer->jobs[indices[i]].result);
+
+    return total + n;
+}
+
+static void
+start_job (pco_writer writer, pco_frame frame)
+{
+    size_t length = get_write_length (frame);
+    write_job *job;
+    uint64_t index;
+
+    if (needs_new_file (writer, frame, length)) {
+        /* Roll over once all writes to the current file have finished */
+        while (writer->num_free_jobs < MAX_IN_FLIGHT) {
+            if (reap_jobs (writer) == 0)
+                wait_for_work (writer, false);
+        }
+
+        close_file (writer);
+    }
+
+    if ((writer->fd < 0 && !open_file (writer, frame)) || add_record (writer, frame) == NULL) {
+        __atomic_fetch_add (&writer->num_dropped, 1, __ATOMIC_RELAXED);
+        count_done (writer);
+        pco_frame_unref (frame);
+        return;
+    }
+
+    index = writer->free_jobs[--writer->num_free_jobs];
+    job = &writer->jobs[index];
+    job->frame = frame;
+    job->record = writer->num_records - 1;
+    job->fd = writer->fd;
+    job->offset = writer->file_offset;
+    job->length = length;
+    job->written = 0;
+    writer->file_offset += length;
+
+    if (!submit_job (writer, index))
+        finish_job (writer, index, -EAGAIN);
+}
+
+static void *
+dispatch_writes (void *data)
+{
+    pco_writer writer = (pco_writer) data;
+    uint64_t value;
+
+    for (;;) {
+        bool busy = reap_jobs (writer) > 0;
+
+        if (writer->num_free_jobs > 0 && pco_queue_pop (writer->input, &value, 1) == 1) {
+            start_job (writer, (pco_frame) (uintptr_t) value);
+            busy = true;
+        }
+
+        if (busy)
+            continue;
+
+        if (is_set (&writer->stop) && writer->num_free_jobs == MAX_IN_FLIGHT &&
+            pco_queue_get_depth (writer->input) == 0)
+            break;
+
+        wait_for_work (writer, writer->num_free_jobs > 0);
+    }
+
+    return NULL;
+}
+
+static void *
+write_frames (void *data)
+{
+    pco_writer writer = (pco_writer) data;
+    uint64_t index;
+
+    for (;;) {
+        write_job *job;
+        int64_t written = 0;
+        uint32_t n;
+
+        pthread_mutex_lock (&writer->lock);
+
+        while ((n = pco_queue_pop (writer->submitted, &index, 1)) == 0 && !writer->stop_writing)
+            pthread_cond_wait (&writer->submitted_cond, &writer->lock);
+
+        pthread_mutex_unlock (&writer->lock);
+
+        if (n == 0)
+            break;
+
+        job = &writer->jobs[index];
+
+        while (job->written + written < job->length) {
+            uint64_t position = job->written + written;
+            ssize_t result = pwrite (job->fd, (const uint8_t *) pco_frame_get_data (job->frame) + position,
+                                     job->length - position, (off_t) (job->offset + position));
+
+            if (result < 0 && errno == EINTR)
+                continue;
+
+            if (result <= 0) {
+                written = written == 0 && result < 0 ? -errno : written;
+                break;
+            }
+
+            written += result;
+        }
+
+        job->result = written;
+        pco_queue_push (writer->completed, index);
+        wake_dispatcher (writer);
+    }
+
+    return NULL;
+}
+
+static bool
+start_thread (pco_writer writer, void *(*func) (void *))
+{
+    pthread_t thread;
+
+    if (pthread_create (&thread, NULL, func, writer) != 0)
+        return false;
+
+    writer->threads[writer->num_threads++] = thread;
+    return true;
+}
+
+/*
+ * Start the write threads. With io_uring, this happens only once the ring
+ * refused a write and then by the dispatcher itself.
+ */
+static bool
+start_write_threads (pco_writer writer)
+{
+    bool started = true;
+
+    while (started && writer->num_threads < 1 + NUM_WRITE_THREADS)
+        started = start_thread (writer, write_frames);
+
+    if (!started)
+        fprintf (stderr, "Could not start all write threads\n");
+
+    return writer->num_threads > 1;
+}
+
+/**
+ * Create a writer for the frames of a #pco_acquisition. Frames are written
+ * into indexed recordings of at most #max_file_size bytes, named after #prefix
+ * with a running number and the extension .pcoraw.
+ *
+ * @param prefix Path and name of the files without number and extension
+ * @param max_file_size Size at which a new file is started, e.g. 4 GB
+ * @param max_memory Maximum size of the frames held by the writer until they
+ * are written. Frames that do not fit are dropped.
+ * @return A new #pco_writer or NULL on error
+ * @since 1.1
+ */
+pco_writer
+pco_writer_new (const char *prefix, uint64_t max_file_size, size_t max_memory)
+{
+    pco_writer writer;
+    void *header;
+    bool started;
+
+    if (max_file_size < 2 * WRITE_ALIGNMENT || max_memory == 0)
+        return NULL;
+
+    writer = (pco_writer) calloc (1, sizeof(struct pco_writer_t));
+
+    if (writer == NULL)
+        return NULL;
+
+    pthread_mutex_init (&writer->lock, NULL);
+    pthread_cond_init (&writer->submitted_cond, NULL);
+    pthread_cond_init (&writer->done_cond, NULL);
+    writer->prefix = strdup (prefix);
+    writer->max_file_size = max_file_size;
+    writer->max_memory = max_memory;
+    writer->fd = -1;
+    writer->wake_fd = eventfd (0, EFD_CLOEXEC);
+    writer->input = pco_queue_new (MAX_QUEUED_FRAMES, true);
+    writer->submitted = pco_queue_new (MAX_IN_FLIGHT, true);
+    writer->completed = pco_queue_new (MAX_IN_FLIGHT, true);
+
+    if (posix_memalign (&header, WRITE_ALIGNMENT, WRITE_ALIGNMENT) == 0)
+        writer->header = (pco_recording_header *) header;
+
+    writer->ring = pco_uring_new (MAX_IN_FLIGHT);
+
+    /* Without the eventfd, finished writes could not wake the dispatcher */
+    if (writer->ring != NULL && (writer->wake_fd < 0 || !pco_uring_set_eventfd (writer->ring, writer->wake_fd))) {
+        pco_uring_free (writer->ring);
+        writer->ring = NULL;
+    }
+
+    for (unsigned int i = 0; i < MAX_IN_FLIGHT; i++)
+        writer->free_jobs[i] = i;
+
+    writer->num_free_jobs = MAX_IN_FLIGHT;
+
+    if (writer->prefix == NULL || writer->wake_fd < 0 || writer->input == NULL || writer->header == NULL ||
+        writer->submitted == NULL || writer->completed == NULL) {
+        pco_writer_destroy (writer);
+        return NULL;
+    }
+
+    started = start_thread (writer, dispatch_writes);
+
+    if (started && writer->ring == NULL)
+        started = start_write_threads (writer);
+
+    if (!started) {
+        pco_writer_destroy (writer);
+        return NULL;
+    }
+
+    return writer;
+}
+
+/**
+ * Wait until all frames are written and close the files.
+ *
+ * @param writer A #pco_writer
+ * @since 1.1
+ */
+void
+pco_writer_destroy (pco_writer writer)
+{
+    if (writer == NULL)
+        return;
+
+    /* The dispatcher finishes all jobs before the write threads are stopped */
+    __atomic_store_n (&writer->stop, true, __ATOMIC_RELEASE);
+
+    if (writer->num_threads > 0) {
+        wake_dispatcher (writer);
+        pthread_join (writer->threads[0], NULL);
+    }
+
+    pthread_mutex_lock (&writer->lock);
+    writer->stop_writing = true;
+    pthread_cond_broadcast (&writer->submitted_cond);
+    pthread_mutex_unlock (&writer->lock);
+
+    for (int i = 1; i < writer->num_threads; i++)
+        pthread_join (writer->threads[i], NULL);
+
+    close_file (writer);
+    pco_uring_free (writer->ring);
+    pco_queue_free (writer->submitted);
+    pco_queue_free (writer->completed);
+    pco_queue_free (writer->input);
+
+    if (writer->wake_fd >= 0)
+        close (writer->wake_fd);
+
+    pthread_cond_destroy (&writer->submitted_cond);
+    pthread_cond_destroy (&writer->done_cond);
+    pthread_mutex_destroy (&writer->lock);
+    free (writer->records);
+    free (writer->header);
+    free (writer->prefix);
+    free (writer);
+}
+
+/**
+ * Queue a frame for writing. The writer takes a reference to the frame and
+ * releases it when the frame is written. The call does not wait for the
+ * write.
+ *
+ * @param writer A #pco_writer
+ * @param frame A #pco_frame of a #pco_acquisition
+ * @return Error code or PCO_NOERROR. PCO_ERROR_NOMEMORY is returned and the
+ * frame is dropped if the memory budget of the writer is exhausted.
+ * Several threads may write frames at the same time.
+ * @since 1.1
+ */
+unsigned int
+pco_writer_write (pco_writer writer, pco_frame frame)
+{
+    uint64_t max_frames = writer->max_memory / get_write_length (frame);
+    uint64_t queued = __atomic_load_n (&writer->num_queued, __ATOMIC_ACQUIRE);
+
+    /*
+     * Reserve a slot of the budget by counting the frame before it is pushed,
+     * so that it is never done before it is queued. The compare-and-swap keeps
+     * concurrent callers from exceeding the budget together.
+     */
+    do {
+        uint64_t done = __atomic_load_n (&writer->num_done, __ATOMIC_ACQUIRE);
+
+        if (queued - done >= max_frames) {
+            __atomic_fetch_add (&writer->num_dropped, 1, __ATOMIC_RELAXED);
+            return PCO_ERROR_NOMEMORY;
+        }
+    } while (!__atomic_compare_exchange_n (&writer->num_queued, &queued, queued + 1, true,
+                                           __ATOMIC_RELEASE, __ATOMIC_ACQUIRE));
+
+    if (!pco_queue_push (writer->input, (uint64_t) (uintptr_t) pco_frame_ref (frame))) {
+        pco_frame_unref (frame);
+        __atomic_fetch_add (&writer->num_dropped, 1, __ATOMIC_RELAXED);
+        count_done (writer);
+        return PCO_ERROR_NOMEMORY;
+    }
+
+    /* Pairs with the fence in wait_for_work() */
+    __atomic_thread_fence (__ATOMIC_SEQ_CST);
+
+    if (__atomic_load_n (&writer->sleeping, __ATOMIC_RELAXED))
+        wake_dispatcher (writer);
+
+    return PCO_NOERROR;
+}
+
+/**
+ * Set the camera description stored in the header of each recording. Width,
+ * height and format are taken from the frames. This must be called before
+ * frames are written, pco_acquisition_set_writer() does so for the camera of
+ * the acquisition.
+ *
+ * @param writer A #pco_writer
+ * @param info Description of the camera
+ * @return Error code or PCO_NOERROR.
+ * @since 1.1
+ */
+unsigned int
+pco_writer_set_info (pco_writer writer, const pco_recording_info *info)
+{
+    writer->info = *info;
+    return PCO_NOERROR;
+}
+
+/**
+ * Wait until all queued frames are written.
+ *
+ * @param writer A #pco_writer
+ * @return Error code or PCO_NOERROR.
+ * @since 1.1
+ */
+unsigned int
+pco_writer_flush (pco_writer writer)
+{
+    pthread_mutex_lock (&writer->lock);
+    __atomic_fetch_add (&writer->num_flushing, 1, __ATOMIC_SEQ_CST);
+    __atomic_thread_fence (__ATOMIC_SEQ_CST);
+
+    while (__atomic_load_n (&writer->num_done, __ATOMIC_ACQUIRE) != __atomic_load_n (&writer->num_queued, __ATOMIC_ACQUIRE))
+        pthread_cond_wait (&writer->done_cond, &writer->lock);
+
+    __atomic_fetch_sub (&writer->num_flushing, 1, __ATOMIC_RELAXED);
+    pthread_mutex_unlock (&writer->lock);
+
+    return PCO_NOERROR;
+}
+
+/**
+ * Get the number of frames and bytes written and the number of frames that
+ * were dropped, either because the memory budget was exhausted or because a
+ * write failed.
+ *
+ * @param writer A #pco_writer
+ * @param num_frames Location for the number of frames written
+ * @param num_bytes Location for the number of bytes written, including padding
+ * @param num_dropped Location for the number of frames dropped
+ * @return Error code or PCO_NOERROR.
+ * @since 1.1
+ */
+unsigned int
+pco_writer_get_counters (pco_writer writer, uint64_t *num_frames, uint64_t *num_bytes, uint64_t *num_dropped)
+{
+    *num_frames = __atomic_load_n (&writer->num_frames, __ATOMIC_RELAXED);
+    *num_bytes = __atomic_load_n (&writer->num_bytes, __ATOMIC_RELAXED);
+    *num_dropped = __atomic_load_n (&writer->num_dropped, __ATOMIC_RELAXED);
+    return PCO_NOERROR;
+}
+
+/**
+ * Get how frames are written.
+ *
+ * @param writer A #pco_writer
+ * @param io_uring Location for whether io_uring is used instead of write
+ * threads
+ * @param direct Location for whether the current file is written with direct
+ * I/O
+ * @return Error code or PCO_NOERROR.
+ * @since 1.1
+ */
+unsigned int
+pco_writer_get_info (pco_writer writer, bool *io_uring, bool *direct)
+{
+    *io_uring = writer->ring != NULL;
+    *direct = writer->direct;
+    return PCO_NOERROR;
+}
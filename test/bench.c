@@ -0,0 +1,742 @@
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include "libpco.h"
+
+/*
+ * Measures the throughput of the re-order functions on synthetic pco.edge
+ * frames and writes the results as JSON to stdout. The raw frames are random
+ * data, which decodes to valid pixels in both the 5x12 and the 5x16 format.
+ * GB/s always refer to the size of the raw frame, frames/s to complete calls.
+ * All functions run on the calling thread.
+ *
+ * With --verify, the output of every function is instead compared byte for
+ * byte with a reference decoder on randomly sized frames.
+ */
+
+/* Instruction set the library and this program were built for */
+#ifdef __AVX2__
+#define BENCH_BUILD_ISA "avx2"
+#elif defined(__SSE2__)
+#define BENCH_BUILD_ISA "sse2"
+#else
+#define BENCH_BUILD_ISA "generic"
+#endif
+
+struct geometry {
+    const char *name;
+    int width;
+    int height;
+};
+
+static struct geometry geometries[] = {
+    { "edge-5.5", 2560, 2160 },
+    { "edge-4.2", 2048, 2048 },
+    { "edge-5.5-roi", 2560, 512 },
+    { NULL, 0, 0 }
+};
+
+struct bench_frame {
+    int width;
+    int height;
+    bool packed;
+    size_t raw_size;
+    uint16_t *raw;
+    uint16_t *raw_copy;
+    void *out;
+    float *dark;
+    float *gain;
+    pco_frame_stats *stats;
+    uint16_t *scratch;
+    uint8_t *lut;
+};
+
+struct bench_kernel {
+    const char *suffix;
+    const char *output;
+    bool only_5x12;
+    bool modifies_input;
+    void (*run)(struct bench_frame *frame);
+};
+
+static void on_rows(const uint16_t *rows, int first_row, int num_rows, int width, void *user_data)
+{
+    *((uint64_t *) user_data) += rows[0];
+}
+
+static void on_verify_rows(const uint16_t *rows, int first_row, int num_rows, int width, void *user_data)
+{
+    memcpy((uint16_t *) user_data + (size_t) first_row * width, rows, (size_t) num_rows * width * sizeof(uint16_t));
+}
+
+static void run_reorder(struct bench_frame *f)
+{
+    (f->packed ? pco_reorder_image_5x12 : pco_reorder_image_5x16)(f->out, f->raw, f->width, f->height);
+}
+
+static void run_nt(struct bench_frame *f)
+{
+    (f->packed ? pco_reorder_image_5x12_nt : pco_reorder_image_5x16_nt)(f->out, f->raw, f->width, f->height);
+}
+
+static void run_inplace(struct bench_frame *f)
+{
+    (f->packed ? pco_reorder_image_5x12_inplace : pco_reorder_image_5x16_inplace)(f->raw, f->width, f->height, f->scratch);
+}
+
+static void run_strided(struct bench_frame *f)
+{
+    /* Write into the left half of an image twice as wide */
+    (f->packed ? pco_reorder_image_5x12_strided : pco_reorder_image_5x16_strided)(f->out, f->width * 2 * sizeof(uint16_t),
+            f->raw, 0, f->width, f->height);
+}
+
+static void run_lut8(struct bench_frame *f)
+{
+    (f->packed ? pco_reorder_image_5x12_lut8 : pco_reorder_image_5x16_lut8)(f->out, f->raw, f->width, f->height, f->lut);
+}
+
+static void run_scale8(struct bench_frame *f)
+{
+    uint16_t max = f->packed ? 0xFFF : 0xFFFF;
+    (f->packed ? pco_reorder_image_5x12_scale8 : pco_reorder_image_5x16_scale8)(f->out, f->raw, f->width, f->height, 0, max);
+}
+
+static void run_binned(struct bench_frame *f)
+{
+    (f->packed ? pco_reorder_image_5x12_binned : pco_reorder_image_5x16_binned)(f->out, f->raw, f->width, f->height, 2, 2, PCO_BINNING_SUM_16);
+}
+
+static void run_roi(struct bench_frame *f)
+{
+    int roi_width = f->width / 4;
+    int roi_height = f->height / 4;
+    (f->packed ? pco_reorder_image_5x12_roi : pco_reorder_image_5x16_roi)(f->out, f->raw, f->width, f->height,
+            (f->width - roi_width) / 2, (f->height - roi_height) / 2, roi_width, roi_height);
+}
+
+static void run_stream(struct bench_frame *f)
+{
+    uint64_t sum = 0;
+    (f->packed ? pco_reorder_image_5x12_stream : pco_reorder_image_5x16_stream)(f->raw, f->width, f->height, 0, on_rows, &sum);
+}
+
+static void run_flat_field(struct bench_frame *f)
+{
+    (f->packed ? pco_reorder_image_5x12_flat_field : pco_reorder_image_5x16_flat_field)(f->out, f->raw, f->width, f->height,
+            f->dark, f->gain);
+}
+
+static void run_flat_field_u16(struct bench_frame *f)
+{
+    (f->packed ? pco_reorder_image_5x12_flat_field_u16 : pco_reorder_image_5x16_flat_field_u16)(f->out, f->raw, f->width, f->height,
+            f->dark, f->gain, 1.0f);
+}
+
+static void run_stats(struct bench_frame *f)
+{
+    (f->packed ? pco_reorder_image_5x12_stats : pco_reorder_image_5x16_stats)(f->out, f->raw, f->width, f->height, f->stats);
+}
+
+static void run_packed(struct bench_frame *f)
+{
+    pco_reorder_image_5x12_packed(f->out, f->raw, f->width, f->height);
+}
+
+static struct bench_kernel kernels[] = {
+    { "", "u16", false, false, run_reorder },
+    { "_nt", "u16-nontemporal", false, false, run_nt },
+    { "_inplace", "u16-inplace", false, true, run_inplace },
+    { "_strided", "u16-strided", false, false, run_strided },
+    { "_lut8", "u8-lut", false, false, run_lut8 },
+    { "_scale8", "u8", false, false, run_scale8 },
+    { "_binned", "u16-binned-2x2", false, false, run_binned },
+    { "_roi", "u16-roi", false, false, run_roi },
+    { "_stream", "callback", false, false, run_stream },
+    { "_packed", "packed12", true, false, run_packed },
+    { "_flat_field", "f32", false, false, run_flat_field },
+    { "_flat_field_u16", "u16", false, false, run_flat_field_u16 },
+    { "_stats", "u16-stats", false, false, run_stats },
+    { NULL, NULL, false, false, NULL }
+};
+
+static uint64_t time_diff(struct timeval *end, struct timeval *start)
+{
+    return ((end->tv_sec * 1000000) + end->tv_usec) - ((start->tv_sec * 1000000) + start->tv_usec);
+}
+
+static int setup_frame(struct bench_frame *f, int width, int height, bool packed)
+{
+    size_t num_pixels = (size_t) width * height;
+    void *mem;
+
+    f->width = width;
+    f->height = height;
+    f->packed = packed;
+    f->raw_size = (packed ? pco_get_raw_pitch_5x12(width) : pco_get_raw_pitch_5x16(width)) * height;
+
+    /* The in-place functions need a buffer for the decoded frame */
+    if (posix_memalign(&mem, 64, num_pixels * sizeof(uint16_t)) != 0)
+        return 1;
+
+    f->raw = mem;
+    f->raw_copy = malloc(f->raw_size);
+
+    if (posix_memalign(&mem, 64, num_pixels * sizeof(float)) != 0)
+        return 1;
+
+    f->out = mem;
+    f->dark = malloc(num_pixels * sizeof(float));
+    f->gain = malloc(num_pixels * sizeof(float));
+    f->stats = malloc(sizeof(pco_frame_stats));
+    f->scratch = malloc(pco_get_inplace_scratch_size(width, height));
+    f->lut = malloc(65536);
+
+    if (f->raw_copy == NULL || f->dark == NULL || f->gain == NULL || f->stats == NULL || f->scratch == NULL ||
+        f->lut == NULL)
+        return 1;
+
+    for (int i = 0; i < 65536; i++)
+        f->lut[i] = (uint8_t) (packed ? i >> 4 : i >> 8);
+
+    for (size_t i = 0; i < f->raw_size / sizeof(uint16_t); i++)
+        f->raw_copy[i] = (uint16_t) rand();
+
+    for (size_t i = 0; i < num_pixels; i++) {
+        f->dark[i] = 100.0f;
+        f->gain[i] = 1.0f;
+    }
+
+    memset(f->out, 0, num_pixels * sizeof(float));
+    memcpy(f->raw, f->raw_copy, f->raw_size);
+    return 0;
+}
+
+static void free_frame(struct bench_frame *f)
+{
+    free(f->raw);
+    free(f->raw_copy);
+    free(f->out);
+    free(f->dark);
+    free(f->gain);
+    free(f->stats);
+    free(f->scratch);
+    free(f->lut);
+}
+
+static uint64_t measure(struct bench_kernel *kernel, struct bench_frame *f, int iterations)
+{
+    struct timeval start, end;
+    uint64_t elapsed = 0;
+
+    /* Warm up caches and page tables */
+    kernel->run(f);
+
+    for (int i = 0; i < iterations; i++) {
+        if (kernel->modifies_input)
+            memcpy(f->raw, f->raw_copy, f->raw_size);
+
+        gettimeofday(&start, NULL);
+        kernel->run(f);
+        gettimeofday(&end, NULL);
+        elapsed += time_diff(&end, &start);
+    }
+
+    memcpy(f->raw, f->raw_copy, f->raw_size);
+    return elapsed;
+}
+
+static void print_result(struct bench_kernel *kernel, struct geometry *geometry, struct bench_frame *f,
+                         int iterations, uint64_t elapsed, bool first)
+{
+    double seconds = elapsed > 0 ? elapsed / 1000000.0 : 1e-6;
+
+    printf("%s    {\"kernel\": \"pco_reorder_image_%s%s\", \"format\": \"%s\", \"output\": \"%s\", "
+           "\"geometry\": \"%s\", \"width\": %i, \"height\": %i, "
+           "\"frames_per_s\": %.2f, \"gb_per_s\": %.3f}",
+           first ? "" : ",\n",
+           f->packed ? "5x12" : "5x16", kernel->suffix, f->packed ? "5x12" : "5x16", kernel->output,
+           geometry->name, f->width, f->height,
+           iterations / seconds, (double) f->raw_size * iterations / seconds / 1e9);
+}
+
+/*
+ * Reference implementation for --verify. It deliberately shares no code with
+ * the library: pixels are packed bit by bit and lines are re-ordered by their
+ * row index, so that it can serve as an oracle for the optimized functions.
+ */
+
+static int ref_line_of_row(int row, int height)
+{
+    int top_rows = (height + 1) / 2;
+    return row < top_rows ? 2 * row : 2 * (height - 1 - row) + 1;
+}
+
+/* 5x12 lines are a stream of 12 bit values, MSB first within 16 bit words */
+static void ref_encode_line_5x12(uint16_t *out, const uint16_t *px, int width)
+{
+    memset(out, 0, (width * 12 + 15) / 16 * sizeof(uint16_t));
+
+    for (int i = 0; i < width; i++) {
+        for (int b = 0; b < 12; b++) {
+            int pos = i * 12 + b;
+
+            if ((px[i] >> (11 - b)) & 1)
+                out[pos / 16] |= (uint16_t) (1 << (15 - pos % 16));
+        }
+    }
+}
+
+static void ref_decode_line_5x12(uint16_t *px, const uint16_t *in, int width)
+{
+    for (int i = 0; i < width; i++) {
+        px[i] = 0;
+
+        for (int b = 0; b < 12; b++) {
+            int pos = i * 12 + b;
+            px[i] = (uint16_t) ((px[i] << 1) | ((in[pos / 16] >> (15 - pos % 16)) & 1));
+        }
+    }
+}
+
+static int ref_pitch(int width, bool packed)
+{
+    return packed ? (width * 12 + 15) / 16 : width;
+}
+
+static void ref_encode(uint16_t *raw, const uint16_t *image, int width, int height, bool packed)
+{
+    for (int row = 0; row < height; row++) {
+        uint16_t *line = raw + (size_t) ref_line_of_row(row, height) * ref_pitch(width, packed);
+
+        if (packed)
+            ref_encode_line_5x12(line, image + (size_t) row * width, width);
+        else
+            memcpy(line, image + (size_t) row * width, width * sizeof(uint16_t));
+    }
+}
+
+static void ref_decode(uint16_t *image, const uint16_t *raw, int width, int height, bool packed)
+{
+    for (int row = 0; row < height; row++) {
+        const uint16_t *line = raw + (size_t) ref_line_of_row(row, height) * ref_pitch(width, packed);
+
+        if (packed)
+            ref_decode_line_5x12(image + (size_t) row * width, line, width);
+        else
+            memcpy(image + (size_t) row * width, line, width * sizeof(uint16_t));
+    }
+}
+
+/* Packed 12 bit layout: pixel i occupies bits 12 * i to 12 * i + 11 LSB first */
+static void ref_pack12(uint8_t *out, const uint16_t *px, size_t num_pixels)
+{
+    memset(out, 0, (num_pixels * 3 + 1) / 2);
+
+    for (size_t i = 0; i < num_pixels; i++)
+        for (int b = 0; b < 12; b++)
+            if ((px[i] >> b) & 1)
+                out[(i * 12 + b) / 8] |= (uint8_t) (1 << ((i * 12 + b) % 8));
+}
+
+struct verify_state {
+    int failures;
+    int checks;
+};
+
+static void check(struct verify_state *state, bool ok, const char *function, bool packed, int width, int height)
+{
+    state->checks++;
+
+    if (!ok) {
+        state->failures++;
+
+        if (state->failures <= 20)
+            fprintf(stderr, "FAIL: pco_reorder_image_%s%s for %ix%i\n", packed ? "5x12" : "5x16", function, width, height);
+    }
+}
+
+static int random_range(int min, int max)
+{
+    return min + rand() % (max - min + 1);
+}
+
+static void verify_frame(struct verify_state *state, int width, int height, bool packed)
+{
+    const size_t num_pixels = (size_t) width * height;
+    const uint16_t max_value = packed ? 0xFFF : 0xFFFF;
+    uint16_t *image = malloc(num_pixels * sizeof(uint16_t));
+    uint16_t *raw = calloc(num_pixels + 8, sizeof(uint16_t));
+    uint16_t *ref = malloc(num_pixels * sizeof(uint32_t));
+    uint16_t *buf = calloc(num_pixels + 8, sizeof(uint16_t));
+    float *dark = malloc(num_pixels * sizeof(float));
+    float *gain = malloc(num_pixels * sizeof(float));
+    uint8_t *lut = malloc(max_value + 1);
+    pco_frame_stats *stats = malloc(sizeof(pco_frame_stats));
+    pco_frame_stats *ref_stats = calloc(1, sizeof(pco_frame_stats));
+    bool ok;
+    void *mem;
+
+    if (posix_memalign(&mem, 64, (num_pixels + 8) * sizeof(float)) != 0)
+        mem = NULL;
+
+    if (image == NULL || raw == NULL || ref == NULL || buf == NULL || dark == NULL ||
+        gain == NULL || lut == NULL || stats == NULL || ref_stats == NULL || mem == NULL) {
+        fprintf(stderr, "Could not allocate frame buffers\n");
+        exit(1);
+    }
+
+    for (size_t i = 0; i < num_pixels; i++) {
+        image[i] = (uint16_t) (rand() & max_value);
+        dark[i] = (float) (rand() % 200);
+        gain[i] = (float) rand() / RAND_MAX * 2.0f;
+    }
+
+    for (int i = 0; i <= max_value; i++)
+        lut[i] = (uint8_t) rand();
+
+    /* The reference pair must round-trip before it can judge anything */
+    ref_encode(raw, image, width, height, packed);
+    ref_decode(ref, raw, width, height, packed);
+    check(state, !memcmp(ref, image, num_pixels * sizeof(uint16_t)), " (reference)", packed, width, height);
+
+    uint16_t *out16 = mem;
+
+    (packed ? pco_reorder_image_5x12 : pco_reorder_image_5x16)(out16, raw, width, height);
+    check(state, !memcmp(out16, image, num_pixels * sizeof(uint16_t)), "", packed, width, height);
+
+    (packed ? pco_reorder_image_5x12_nt : pco_reorder_image_5x16_nt)(out16, raw, width, height);
+    check(state, !memcmp(out16, image, num_pixels * sizeof(uint16_t)), "_nt", packed, width, height);
+
+    (packed ? pco_reorder_image_5x12_nt : pco_reorder_image_5x16_nt)(out16 + 1, raw, width, height);
+    check(state, !memcmp(out16 + 1, image, num_pixels * sizeof(uint16_t)), "_nt (unaligned)", packed, width, height);
+
+    /* Padded input and output lines */
+    size_t in_pitch = (packed ? pco_get_raw_pitch_5x12(width) : pco_get_raw_pitch_5x16(width)) + 2 * random_range(0, 4);
+    size_t out_pitch = width * sizeof(uint16_t) + 2 * random_range(0, 4);
+    uint16_t *padded_in = calloc(height, in_pitch);
+    uint16_t *padded_out = calloc(height, out_pitch);
+    ok = padded_in != NULL && padded_out != NULL;
+
+    for (int y = 0; ok && y < height; y++)
+        memcpy((uint8_t *) padded_in + y * in_pitch, (uint8_t *) raw + y * ref_pitch(width, packed) * sizeof(uint16_t),
+               ref_pitch(width, packed) * sizeof(uint16_t));
+
+    if (ok)
+        (packed ? pco_reorder_image_5x12_strided : pco_reorder_image_5x16_strided)(padded_out, out_pitch, padded_in, in_pitch, width, height);
+
+    for (int y = 0; ok && y < height; y++) {
+        const uint8_t *row = (uint8_t *) padded_out + y * out_pitch;
+
+        ok = !memcmp(row, image + (size_t) y * width, width * sizeof(uint16_t));
+
+        for (size_t i = width * sizeof(uint16_t); ok && i < out_pitch; i++)
+            ok = row[i] == 0;
+    }
+
+    check(state, ok, "_strided", packed, width, height);
+    free(padded_in);
+    free(padded_out);
+
+    /* Once with a scratch buffer allocated by the function and once with our own */
+    memcpy(buf, raw, num_pixels * sizeof(uint16_t));
+    ok = (packed ? pco_reorder_image_5x12_inplace : pco_reorder_image_5x16_inplace)(buf, width, height, NULL) == PCO_NOERROR;
+    ok = ok && !memcmp(buf, image, num_pixels * sizeof(uint16_t));
+
+    uint16_t *scratch = malloc(pco_get_inplace_scratch_size(width, height));
+    memcpy(buf, raw, num_pixels * sizeof(uint16_t));
+    ok = ok && scratch != NULL &&
+         (packed ? pco_reorder_image_5x12_inplace : pco_reorder_image_5x16_inplace)(buf, width, height, scratch) == PCO_NOERROR;
+    ok = ok && !memcmp(buf, image, num_pixels * sizeof(uint16_t));
+    check(state, ok, "_inplace", packed, width, height);
+    free(scratch);
+
+    /* 8 bit output */
+    uint8_t *out8 = mem;
+    (packed ? pco_reorder_image_5x12_lut8 : pco_reorder_image_5x16_lut8)(out8, raw, width, height, lut);
+    ok = true;
+
+    for (size_t i = 0; i < num_pixels; i++)
+        ok = ok && out8[i] == lut[image[i]];
+
+    check(state, ok, "_lut8", packed, width, height);
+
+    uint16_t min = (uint16_t) (rand() & max_value), max = (uint16_t) (rand() & max_value);
+    float scale = max > min ? 255.0f / (float) (max - min) : 255.0f;
+    (packed ? pco_reorder_image_5x12_scale8 : pco_reorder_image_5x16_scale8)(out8, raw, width, height, min, max);
+    ok = true;
+
+    for (size_t i = 0; i < num_pixels; i++) {
+        float v = ((float) image[i] - (float) min) * scale;
+        uint8_t expected = v <= 0.0f ? 0 : (v >= 255.0f ? 255 : (uint8_t) v);
+        ok = ok && out8[i] == expected;
+    }
+
+    check(state, ok, "_scale8", packed, width, height);
+
+    /* Binning in all modes */
+    for (pco_binning_mode mode = PCO_BINNING_SUM_16; mode <= PCO_BINNING_MEAN_16; mode++) {
+        int bin_x = random_range(1, width < 4 ? width : 4);
+        int bin_y = random_range(1, height < 4 ? height : 4);
+        int out_width = width / bin_x;
+        uint32_t *out32 = mem;
+
+        (packed ? pco_reorder_image_5x12_binned : pco_reorder_image_5x16_binned)(mem, raw, width, height, bin_x, bin_y, mode);
+        ok = true;
+
+        for (int y = 0; y < height / bin_y; y++) {
+            for (int x = 0; x < out_width; x++) {
+                uint32_t sum = 0;
+
+                for (int j = 0; j < bin_y; j++)
+                    for (int i = 0; i < bin_x; i++)
+                        sum += image[(size_t) (y * bin_y + j) * width + x * bin_x + i];
+
+                if (mode == PCO_BINNING_SUM_32)
+                    ok = ok && out32[y * out_width + x] == sum;
+                else if (mode == PCO_BINNING_SUM_16)
+                    ok = ok && out16[y * out_width + x] == (sum > 0xFFFF ? 0xFFFF : sum);
+                else
+                    ok = ok && out16[y * out_width + x] == sum / (uint32_t) (bin_x * bin_y);
+            }
+        }
+
+        check(state, ok, "_binned", packed, width, height);
+    }
+
+    /* Arbitrary regions */
+    for (int k = 0; k < 4; k++) {
+        int roi_width = random_range(1, width);
+        int roi_height = random_range(1, height);
+        int x = random_range(0, width - roi_width);
+        int y = random_range(0, height - roi_height);
+
+        (packed ? pco_reorder_image_5x12_roi : pco_reorder_image_5x16_roi)(out16, raw, width, height, x, y, roi_width, roi_height);
+        ok = true;
+
+        for (int j = 0; j < roi_height; j++)
+            ok = ok && !memcmp(out16 + (size_t) j * roi_width, image + (size_t) (y + j) * width + x, roi_width * sizeof(uint16_t));
+
+        check(state, ok, "_roi", packed, width, height);
+    }
+
+    /* Flat-field correction */
+    float *outf = mem;
+    (packed ? pco_reorder_image_5x12_flat_field : pco_reorder_image_5x16_flat_field)(outf, raw, width, height, dark, gain);
+    ok = true;
+
+    for (size_t i = 0; i < num_pixels; i++) {
+        float expected = ((float) image[i] - dark[i]) * gain[i];
+        ok = ok && !memcmp(&outf[i], &expected, sizeof(float));
+    }
+
+    check(state, ok, "_flat_field", packed, width, height);
+
+    scale = (float) rand() / RAND_MAX * 16.0f;
+    (packed ? pco_reorder_image_5x12_flat_field_u16 : pco_reorder_image_5x16_flat_field_u16)(out16, raw, width, height, dark, gain, scale);
+    ok = true;
+
+    for (size_t i = 0; i < num_pixels; i++) {
+        float v = ((float) image[i] - dark[i]) * gain[i] * scale + 0.5f;
+        uint16_t expected = v <= 0.0f ? 0 : (v >= 65535.0f ? 65535 : (uint16_t) v);
+        ok = ok && out16[i] == expected;
+    }
+
+    check(state, ok, "_flat_field_u16", packed, width, height);
+
+    /* Statistics */
+    stats->saturation_level = ref_stats->saturation_level = (uint16_t) (rand() & max_value);
+    ref_stats->min = 0xFFFF;
+
+    for (size_t i = 0; i < num_pixels; i++) {
+        uint16_t saturation = ref_stats->saturation_level ? ref_stats->saturation_level : max_value;
+
+        ref_stats->min = image[i] < ref_stats->min ? image[i] : ref_stats->min;
+        ref_stats->max = image[i] > ref_stats->max ? image[i] : ref_stats->max;
+        ref_stats->sum += image[i];
+        ref_stats->num_saturated += image[i] >= saturation;
+        ref_stats->histogram[packed ? image[i] : image[i] >> 4]++;
+    }
+
+    (packed ? pco_reorder_image_5x12_stats : pco_reorder_image_5x16_stats)(out16, raw, width, height, stats);
+    check(state, !memcmp(out16, image, num_pixels * sizeof(uint16_t)) &&
+          stats->min == ref_stats->min && stats->max == ref_stats->max &&
+          stats->sum == ref_stats->sum && stats->num_saturated == ref_stats->num_saturated &&
+          stats->num_pixels == num_pixels &&
+          !memcmp(stats->histogram, ref_stats->histogram, sizeof(stats->histogram)),
+          "_stats", packed, width, height);
+
+    /* Streaming */
+    memset(buf, 0, num_pixels * sizeof(uint16_t));
+    (packed ? pco_reorder_image_5x12_stream : pco_reorder_image_5x16_stream)(raw, width, height, random_range(0, 5), on_verify_rows, buf);
+    check(state, !memcmp(buf, image, num_pixels * sizeof(uint16_t)), "_stream", packed, width, height);
+
+    /* Packed 12 bit output */
+    if (packed) {
+        size_t size = (num_pixels * 3 + 1) / 2;
+        uint8_t *expected = (uint8_t *) ref;
+
+        size_t pitch = ((size_t) width * 3 + 1) / 2;
+        ok = true;
+        pco_reorder_image_5x12_packed(out8, raw, width, height);
+
+        for (int y = 0; y < height; y++) {
+            ref_pack12(expected, image + (size_t) y * width, width);
+            ok = ok && !memcmp(out8 + y * pitch, expected, pitch);
+        }
+
+        check(state, ok, "_packed", packed, width, height);
+
+        size_t n = (size_t) random_range(0, (int) num_pixels);
+        memset(out8, 0, size);
+        pco_pack12(out8, image, n);
+        ref_pack12(expected, image, n);
+        pco_unpack12(buf, out8, n);
+        check(state, !memcmp(out8, expected, (n * 3 + 1) / 2) && !memcmp(buf, image, n * sizeof(uint16_t)),
+              "_packed (pco_pack12/pco_unpack12)", packed, width, height);
+    }
+
+    free(image);
+    free(raw);
+    free(ref);
+    free(buf);
+    free(dark);
+    free(gain);
+    free(lut);
+    free(stats);
+    free(ref_stats);
+    free(mem);
+}
+
+static int verify(int trials, unsigned int seed)
+{
+    struct verify_state state = { 0, 0 };
+
+    srand(seed);
+
+    for (int t = 0; t < trials; t++) {
+        for (int packed = 1; packed >= 0; packed--) {
+            int width = random_range(1, 320);
+            int height = random_range(1, 96);
+
+            verify_frame(&state, width, height, packed);
+        }
+    }
+
+    printf("%i checks, %i failures (seed %u)\n", state.checks, state.failures, seed);
+    return state.failures > 0;
+}
+
+/*
+ * The most capable instruction set of the CPU running the benchmark, which may
+ * differ from the one the library was built for.
+ */
+static const char *get_cpu_isa(void)
+{
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("avx512f"))
+        return "avx512f";
+
+    if (__builtin_cpu_supports("avx2"))
+        return "avx2";
+
+    if (__builtin_cpu_supports("sse4.2"))
+        return "sse4.2";
+
+    if (__builtin_cpu_supports("sse2"))
+        return "sse2";
+#endif
+    return "generic";
+}
+
+static void usage(const char *name)
+{
+    fprintf(stderr, "Usage: %s [-n ITERATIONS] [-g WIDTHxHEIGHT]\n"
+                    "       %s --verify [-n TRIALS] [-s SEED]\n", name, name);
+}
+
+static int benchmark(struct geometry *geometry, int iterations)
+{
+    bool first = true;
+
+    printf("{\n  \"isa\": \"%s\",\n  \"build_isa\": \"%s\",\n  \"iterations\": %i,\n  \"results\": [\n",
+           get_cpu_isa(), BENCH_BUILD_ISA, iterations);
+
+    for (; geometry->name != NULL; geometry++) {
+        if (geometry->width < 8 || geometry->height < 8) {
+            fprintf(stderr, "Skipping %ix%i, frames must be at least 8x8 pixels\n",
+                    geometry->width, geometry->height);
+            continue;
+        }
+
+        for (int packed = 1; packed >= 0; packed--) {
+            struct bench_frame frame;
+
+            if (setup_frame(&frame, geometry->width, geometry->height, packed)) {
+                fprintf(stderr, "Could not allocate frame buffers\n");
+                return 1;
+            }
+
+            for (struct bench_kernel *kernel = kernels; kernel->run != NULL; kernel++) {
+                if (kernel->only_5x12 && !packed)
+                    continue;
+
+                print_result(kernel, geometry, &frame, iterations, measure(kernel, &frame, iterations), first);
+                first = false;
+            }
+
+            free_frame(&frame);
+        }
+    }
+
+    printf("\n  ]\n}\n");
+    return 0;
+}
+
+int main(int argc, char const* argv[])
+{
+    struct geometry custom[] = { { "custom", 0, 0 }, { NULL, 0, 0 } };
+    struct geometry *geometry = geometries;
+    int iterations = 0;
+    unsigned int seed = 1;
+    bool verify_mode = false;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--verify"))
+            verify_mode = true;
+        else if (i + 1 < argc && !strcmp(argv[i], "-n"))
+            iterations = atoi(argv[++i]);
+        else if (i + 1 < argc && !strcmp(argv[i], "-s"))
+            seed = (unsigned int) strtoul(argv[++i], NULL, 10);
+        else if (i + 1 < argc && !strcmp(argv[i], "-g")) {
+            if (sscanf(argv[++i], "%ix%i", &custom[0].width, &custom[0].height) != 2) {
+                usage(argv[0]);
+                return 1;
+            }
+            geometry = custom;
+        }
+        else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (iterations == 0)
+        iterations = verify_mode ? 200 : 20;
+
+    if (iterations < 1) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    if (verify_mode)
+        return verify(iterations, seed);
+
+    return benchmark(geometry, iterations);
+}
@@ -61,21 +61,6 @@ static struct pco_types pco_cameras[] = {
     { 0, NULL }
 };
 
-typedef struct {
-    int camera_type;
-    const char *so_file;
-    int cl_type;
-    int cl_format;
-} pco_cl_map_entry;
-
-/* TODO: merge this table with pco_cameras */
-static pco_cl_map_entry pco_cl_map[] = { 
-    { CAMERATYPE_PCO_EDGE,       "libFullAreaGray8.so",  FG_CL_8BIT_FULL_10,        FG_GRAY },
-    { CAMERATYPE_PCO4000,        "libDualAreaGray16.so", FG_CL_SINGLETAP_16_BIT,    FG_GRAY16 },
-    { CAMERATYPE_PCO_DIMAX_STD,  "libDualAreaGray16.so", FG_CL_SINGLETAP_16_BIT,    FG_GRAY16 },
-    { 0, NULL, 0, 0}
-};
-
 static void print_parameters(Fg_Struct *fg, unsigned int dma_index)
 {
     int value, ret; 
@@ -294,18 +279,6 @@ static void print_segment_info(pco_handle pco)
     print_number_of_valid_images(pco);
 }
 
-static pco_cl_map_entry *get_pco_cl_map_entry(int camera_type)
-{
-    pco_cl_map_entry *entry = pco_cl_map;
-
-    while (entry->camera_type != 0) {
-        if (entry->camera_type == camera_type)
-            return entry;
-        entry++; 
-    }
-    return NULL;
-}
-
 int main(int argc, char const* argv[])
 {
     /* CameraLink specific */
@@ -362,17 +335,18 @@ int main(int argc, char const* argv[])
     int port = PORT_A;
     uint16_t cam_type, cam_subtype;
     CHECK_PCO(pco_get_camera_type(pco, &cam_type, &cam_subtype));
-    pco_cl_map_entry *entry = get_pco_cl_map_entry(cam_type);
+    const char *applet;
+    int cl_type, cl_format;
 
-    if (entry == NULL) {
+    if (pco_get_grabber_config(pco, &applet, &cl_type, &cl_format) != PCO_NOERROR) {
         fprintf(stderr, "No suitable access library found\n");
         pco_destroy(pco);
         return 1;
     }
 
-    Fg_Struct *fg = Fg_Init(entry->so_file, 0);
-    CHECK_FG(fg, Fg_setParameter(fg, FG_CAMERA_LINK_CAMTYP, &entry->cl_type, port));
-    CHECK_FG(fg, Fg_setParameter(fg, FG_FORMAT, &entry->cl_format, port));
+    Fg_Struct *fg = Fg_Init(applet, 0);
+    CHECK_FG(fg, Fg_setParameter(fg, FG_CAMERA_LINK_CAMTYP, &cl_type, port));
+    CHECK_FG(fg, Fg_setParameter(fg, FG_FORMAT, &cl_format, port));
 
     int val = FREE_RUN;
     CHECK_FG(fg, Fg_setParameter(fg, FG_TRIGGERMODE, &val, port));
@@ -441,14 +415,10 @@ int main(int argc, char const* argv[])
         uint16_t *frame = (uint16_t *) Fg_getImagePtrEx(fg, last_frame, port, mem);
         FILE *fp = fopen("out.raw", "wb");
 
-        if (cam_type == CAMERATYPE_PCO_EDGE) {
-            uint16_t *image = (uint16_t *) malloc(width*height*2);
-            pco_get_reorder_func(pco)(image, frame, width, height);
-            fwrite(image, width * height * 2, 1, fp);
-            free(image);
-        }
-        else
-            fwrite(frame, width * height * 2, 1, fp);
+        if (cam_type == CAMERATYPE_PCO_EDGE)
+            pco_get_reorder_inplace_func(pco)(frame, width, height, NULL);
+
+        fwrite(frame, width * height * 2, 1, fp);
 
         fclose(fp);
     }
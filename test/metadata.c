@@ -0,0 +1,169 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+
+#include "libpco.h"
+#include "sc2_common.h"
+
+/*
+ * Appends a metadata block to a synthetic frame, encodes frame and block like
+ * a pco.edge transfers them in 5x16 and 5x12 format, decodes them with the
+ * library and checks that pco_get_metadata_view() and pco_parse_metadata()
+ * recover every field. Raw frames must be rejected.
+ */
+
+#define FIELD(name)  offsetof(PCO_METADATA_STRUCT, name)
+
+static int failures;
+
+static void check(int ok, const char *what, const char *format, int width, int height)
+{
+    if (!ok) {
+        printf("FAIL %s (%s, %ix%i)\n", what, format, width, height);
+        failures++;
+    }
+}
+
+static int line_of_row(int row, int height)
+{
+    int top_rows = (height + 1) / 2;
+    return row < top_rows ? 2 * row : 2 * (height - 1 - row) + 1;
+}
+
+/* 5x12 lines are a stream of 12 bit values, MSB first within 16 bit words */
+static void encode_line_5x12(uint16_t *out, const uint16_t *px, int width)
+{
+    memset(out, 0, (width * 12 + 15) / 16 * sizeof(uint16_t));
+
+    for (int i = 0; i < width; i++) {
+        for (int b = 0; b < 12; b++) {
+            int pos = i * 12 + b;
+
+            if ((px[i] >> (11 - b)) & 1)
+                out[pos / 16] |= (uint16_t) (1 << (15 - pos % 16));
+        }
+    }
+}
+
+static void encode(uint16_t *raw, const uint16_t *image, int width, int height, int packed)
+{
+    size_t pitch = packed ? pco_get_raw_pitch_5x12(width) / sizeof(uint16_t) : (size_t) width;
+
+    for (int row = 0; row < height; row++) {
+        uint16_t *line = raw + (size_t) line_of_row(row, height) * pitch;
+
+        if (packed)
+            encode_line_5x12(line, image + (size_t) row * width, width);
+        else
+            memcpy(line, image + (size_t) row * width, width * sizeof(uint16_t));
+    }
+}
+
+static void put_bytes(uint16_t *block, size_t offset, const uint8_t *bytes, size_t size, int shift)
+{
+    for (size_t i = 0; i < size; i++)
+        block[offset + i] = (uint16_t) (bytes[i] << shift);
+}
+
+static void put_u16(uint16_t *block, size_t offset, uint16_t value, int shift)
+{
+    uint8_t bytes[2] = { value & 0xFF, value >> 8 };
+    put_bytes(block, offset, bytes, 2, shift);
+}
+
+static void put_u32(uint16_t *block, size_t offset, uint32_t value, int shift)
+{
+    put_u16(block, offset, value & 0xFFFF, shift);
+    put_u16(block, offset + 2, value >> 16, shift);
+}
+
+static void write_block(uint16_t *block, int shift)
+{
+    /* Frame 12345678 at 2013-07-04 13:45:59.123456 */
+    const uint8_t counter[4] = { 0x78, 0x56, 0x34, 0x12 };
+    const uint8_t time[10] = { 0x56, 0x34, 0x12, 0x59, 0x45, 0x13, 0x04, 0x07, 0x13, 0x01 };
+
+    put_u16(block, FIELD(wSize), sizeof(PCO_METADATA_STRUCT), shift);
+    put_u16(block, FIELD(wVersion), 1, shift);
+    put_bytes(block, FIELD(bIMAGE_COUNTER_BCD), counter, 4, shift);
+    put_bytes(block, FIELD(bIMAGE_TIME_US_BCD), time, 10, shift);
+    put_u16(block, FIELD(wEXPOSURE_TIME_BASE), 1, shift);
+    put_u32(block, FIELD(dwEXPOSURE_TIME), 5000, shift);
+    put_u32(block, FIELD(dwFRAMERATE_MILLIHZ), 100000, shift);
+    put_u16(block, FIELD(sSENSOR_TEMPERATURE), (uint16_t) -52, shift);
+    put_u16(block, FIELD(wIMAGE_SIZE_X), 2560, shift);
+    put_u16(block, FIELD(wIMAGE_SIZE_Y), 2160, shift);
+    put_u32(block, FIELD(dwCAMERA_SERIAL_NO), 0xC0FFEE, shift);
+    put_u16(block, FIELD(wCOLOR_PATTERN), 0x1234, shift);
+}
+
+static void check_metadata(const pco_metadata *m, const char *format, int width, int height)
+{
+    check(m->frame_number == 12345678, "frame number", format, width, height);
+    check(m->microseconds == 123456, "microseconds", format, width, height);
+    check(m->year == 2013 && m->month == 7 && m->day == 4, "date", format, width, height);
+    check(m->hour == 13 && m->minute == 45 && m->second == 59, "time", format, width, height);
+    check(m->time_status == 1, "time status", format, width, height);
+    check(m->exposure_timebase == 1 && m->exposure_time == 5000, "exposure", format, width, height);
+    check(m->framerate_mhz == 100000, "frame rate", format, width, height);
+    check(m->sensor_temperature == -52, "temperature", format, width, height);
+    check(m->width == 2560 && m->height == 2160, "size", format, width, height);
+    check(m->serial_number == 0xC0FFEE, "serial number", format, width, height);
+    check(m->color_pattern == 0x1234, "color pattern", format, width, height);
+}
+
+static void test_frame(int width, int height, int packed)
+{
+    const char *format = packed ? "5x12" : "5x16";
+    const int block_lines = (sizeof(PCO_METADATA_STRUCT) + width - 1) / width;
+    const int total_height = height + block_lines;
+    const size_t num_pixels = (size_t) width * total_height;
+    const int shift = 0;
+    uint16_t *image = calloc(num_pixels, sizeof(uint16_t));
+    uint16_t *raw = calloc(num_pixels + 8, sizeof(uint16_t));
+    uint16_t *decoded = calloc(num_pixels, sizeof(uint16_t));
+    pco_metadata_view view;
+    pco_metadata metadata;
+
+    if (image == NULL || raw == NULL || decoded == NULL) {
+        fprintf(stderr, "Could not allocate frame buffers\n");
+        exit(1);
+    }
+
+    for (size_t i = 0; i < (size_t) width * height; i++)
+        image[i] = (uint16_t) (rand() & 0xFFF);
+
+    write_block(image + (size_t) width * height, shift);
+    encode(raw, image, width, total_height, packed);
+
+    /* The block is interleaved and, in 5x12, packed in the raw frame */
+    check(pco_get_metadata_view(raw, width, height, packed ? PCO_FRAME_FORMAT_EDGE_5X12 : PCO_FRAME_FORMAT_EDGE_5X16,
+                                shift, &view) == PCO_ERROR_WRONGVALUE, "raw frame rejected", format, width, height);
+
+    /* Decoded together with the frame it follows the last row */
+    (packed ? pco_reorder_image_5x12 : pco_reorder_image_5x16)(decoded, raw, width, total_height);
+    check(!memcmp(decoded, image, num_pixels * sizeof(uint16_t)), "decoded frame", format, width, height);
+    check(pco_get_metadata_view(decoded, width, height, PCO_FRAME_FORMAT_GRAY16, shift, &view) == PCO_NOERROR,
+          "view", format, width, height);
+    check(view.size == sizeof(PCO_METADATA_STRUCT) && view.version == 1, "view size", format, width, height);
+    check(pco_parse_metadata(&view, &metadata) == PCO_NOERROR, "parse", format, width, height);
+    check_metadata(&metadata, format, width, height);
+
+    free(image);
+    free(raw);
+    free(decoded);
+}
+
+int main(int argc, char const* argv[])
+{
+    static const int sizes[][2] = { { 64, 32 }, { 40, 17 }, { 2560, 8 } };
+
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        test_frame(sizes[i][0], sizes[i][1], 1);
+        test_frame(sizes[i][0], sizes[i][1], 0);
+    }
+
+    printf("%i failures\n", failures);
+    return failures > 0;
+}
@@ -0,0 +1,155 @@
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include "queue.h"
+
+/*
+ * Pushes distinct values from several producers through a small queue while
+ * several consumers pop them, one at a time, in batches and waiting with
+ * pco_queue_pop_wait(). Every value must come out exactly once.
+ */
+
+#define NUM_VALUES  200000
+#define MAX_THREADS 4
+#define BATCH_SIZE  8
+
+typedef struct {
+    pco_queue *queue;
+    uint8_t *seen;
+    int index;
+    int num_producers;
+    uint64_t num_popped;
+    uint64_t num_invalid;
+} worker;
+
+static int failures;
+
+static void check(int ok, const char *what, int producers, int consumers)
+{
+    if (!ok) {
+        printf("FAIL %s (%i producers, %i consumers)\n", what, producers, consumers);
+        failures++;
+    }
+}
+
+static void *produce(void *data)
+{
+    worker *self = data;
+
+    /* Producer i pushes i, i + n, i + 2n, ... */
+    for (uint64_t value = self->index; value < NUM_VALUES; value += self->num_producers) {
+        while (!pco_queue_push(self->queue, value))
+            sched_yield();
+    }
+
+    return NULL;
+}
+
+static void *consume(void *data)
+{
+    worker *self = data;
+    uint64_t values[BATCH_SIZE];
+
+    for (uint64_t round = 0;; round++) {
+        uint32_t n;
+
+        /* Alternate between single, batch and waiting pops */
+        switch (round % 3) {
+            case 0:
+                n = pco_queue_pop(self->queue, values, 1);
+                break;
+            case 1:
+                n = pco_queue_pop(self->queue, values, BATCH_SIZE);
+                break;
+            default:
+                n = pco_queue_pop_wait(self->queue, values, BATCH_SIZE, -1);
+
+                /* Closed and empty */
+                if (n == 0)
+                    return NULL;
+        }
+
+        for (uint32_t i = 0; i < n; i++) {
+            if (values[i] >= NUM_VALUES)
+                self->num_invalid++;
+            else
+                __atomic_fetch_add(&self->seen[values[i]], 1, __ATOMIC_RELAXED);
+        }
+
+        self->num_popped += n;
+    }
+}
+
+static void test_queue(int num_producers, int num_consumers)
+{
+    pthread_t producers[MAX_THREADS], consumers[MAX_THREADS];
+    worker producer_data[MAX_THREADS], consumer_data[MAX_THREADS];
+    uint8_t *seen = calloc(NUM_VALUES, 1);
+    pco_queue *queue = pco_queue_new(64, num_producers > 1 || num_consumers > 1);
+    uint64_t num_popped = 0, num_invalid = 0, num_wrong = 0;
+
+    if (seen == NULL || queue == NULL) {
+        fprintf(stderr, "Could not allocate queue\n");
+        exit(1);
+    }
+
+    for (int i = 0; i < num_consumers; i++) {
+        consumer_data[i] = (worker) { queue, seen, i, num_producers, 0, 0 };
+        pthread_create(&consumers[i], NULL, consume, &consumer_data[i]);
+    }
+
+    for (int i = 0; i < num_producers; i++) {
+        producer_data[i] = (worker) { queue, seen, i, num_producers, 0, 0 };
+        pthread_create(&producers[i], NULL, produce, &producer_data[i]);
+    }
+
+    for (int i = 0; i < num_producers; i++)
+        pthread_join(producers[i], NULL);
+
+    /* Consumers drain the queue and stop once it is empty */
+    pco_queue_set_closed(queue, true);
+
+    for (int i = 0; i < num_consumers; i++) {
+        pthread_join(consumers[i], NULL);
+        num_popped += consumer_data[i].num_popped;
+        num_invalid += consumer_data[i].num_invalid;
+    }
+
+    for (uint64_t value = 0; value < NUM_VALUES; value++)
+        num_wrong += seen[value] != 1;
+
+    check(num_popped == NUM_VALUES, "number of values", num_producers, num_consumers);
+    check(num_invalid == 0, "invalid values", num_producers, num_consumers);
+    check(num_wrong == 0, "values popped exactly once", num_producers, num_consumers);
+    check(pco_queue_get_depth(queue) == 0, "empty queue", num_producers, num_consumers);
+
+    pco_queue_free(queue);
+    free(seen);
+}
+
+static void test_timeout(void)
+{
+    pco_queue *queue = pco_queue_new(4, false);
+    uint64_t value;
+
+    check(pco_queue_pop_wait(queue, &value, 1, 10) == 0, "timeout on empty queue", 1, 1);
+    pco_queue_push(queue, 42);
+    check(pco_queue_pop_wait(queue, &value, 1, 10) == 1 && value == 42, "value before timeout", 1, 1);
+    pco_queue_free(queue);
+}
+
+int main(int argc, char const* argv[])
+{
+    test_queue(1, 1);
+    test_queue(1, 3);
+    test_queue(3, 1);
+    test_queue(4, 4);
+    test_timeout();
+
+    printf("%i failures\n", failures);
+    return failures > 0;
+}
@@ -0,0 +1,250 @@
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "libpco.h"
+
+/*
+ * Runs short acquisitions on the simulated frame grabber and camera. Frames
+ * are written with a pco_writer and read back with a pco_reader, which must
+ * return every frame the writer got with the pixels the camera sent. With a
+ * slow consumer, each drop policy must account for every frame it did not
+ * deliver.
+ */
+
+#define WIDTH           640
+#define HEIGHT          160
+#define FPS             "200"
+#define MAX_FRAMES      1024
+#define TIMESTAMP_PIXELS 14
+
+typedef struct {
+    uint64_t numbers[MAX_FRAMES];
+    uint64_t num_frames;
+    uint64_t num_backwards;
+    uint64_t num_not_multiple;
+    int decimation;
+    long delay_ms;
+} delivery;
+
+static int failures;
+
+static void check(int ok, const char *what, const char *run)
+{
+    if (!ok) {
+        printf("FAIL %s (%s)\n", what, run);
+        failures++;
+    }
+}
+
+static void sleep_ms(long ms)
+{
+    struct timespec duration = { ms / 1000, (ms % 1000) * 1000000 };
+    nanosleep(&duration, NULL);
+}
+
+static void deliver(pco_frame frame, void *user_data)
+{
+    delivery *d = user_data;
+    uint64_t number = pco_frame_get_number(frame);
+
+    if (d->num_frames > 0 && number <= d->numbers[d->num_frames - 1])
+        d->num_backwards++;
+
+    if (d->decimation > 1 && number % d->decimation != 0)
+        d->num_not_multiple++;
+
+    if (d->num_frames < MAX_FRAMES)
+        d->numbers[d->num_frames++] = number;
+
+    if (d->delay_ms > 0)
+        sleep_ms(d->delay_ms);
+}
+
+static pco_handle open_camera(const char *format)
+{
+    pco_handle pco;
+
+    /* The simulation reads its setup when the camera is opened */
+    setenv("PCO_SIM_FORMAT", format, 1);
+    setenv("PCO_SIM_WIDTH", "640", 1);
+    setenv("PCO_SIM_HEIGHT", "160", 1);
+    setenv("PCO_SIM_FPS", FPS, 1);
+    pco = pco_init();
+
+    if (pco == NULL) {
+        fprintf(stderr, "Could not open the simulated camera\n");
+        exit(1);
+    }
+
+    pco_set_scan_mode(pco, strcmp(format, "5x12") ? PCO_SCANMODE_SLOW : PCO_SCANMODE_FAST);
+    return pco;
+}
+
+static uint64_t count_wrong_pixels(const uint16_t *frame)
+{
+    uint64_t num_wrong = 0;
+
+    /* The time stamp replaces the first pixels of the top row */
+    for (int y = 0; y < HEIGHT; y++)
+        for (int x = y == 0 ? TIMESTAMP_PIXELS : 0; x < WIDTH; x++)
+            num_wrong += frame[y * WIDTH + x] != ((x + y) & 0xFFF);
+
+    return num_wrong;
+}
+
+static void test_recording(const char *dir, const char *format, bool raw)
+{
+    char run[64], prefix[256], filename[300];
+    pco_handle pco = open_camera(format);
+    pco_acquisition acq = pco_acquisition_init(pco, 16);
+    delivery *d = calloc(1, sizeof(delivery));
+    uint16_t *frame = malloc(WIDTH * HEIGHT * sizeof(uint16_t));
+    uint64_t num_written, num_bytes, num_dropped, num_read = 0, num_wrong_numbers = 0, num_wrong_pixels = 0;
+    pco_writer writer;
+    pco_reader reader;
+
+    snprintf(run, sizeof(run), "%s%s", format, raw ? " raw" : "");
+    snprintf(prefix, sizeof(prefix), "%s/%s-%s", dir, format, raw ? "raw" : "decoded");
+    writer = pco_writer_new(prefix, 1ULL << 30, 64 << 20);
+
+    if (acq == NULL || d == NULL || frame == NULL || writer == NULL) {
+        fprintf(stderr, "Could not set up the acquisition\n");
+        exit(1);
+    }
+
+    check(pco_acquisition_set_raw(acq, raw) == PCO_NOERROR, "set raw", run);
+    check(pco_acquisition_set_writer(acq, writer) == PCO_NOERROR, "set writer", run);
+    check(pco_acquisition_set_callback(acq, deliver, d) == PCO_NOERROR, "set callback", run);
+    check(pco_acquisition_start(acq) == PCO_NOERROR, "start", run);
+    sleep_ms(500);
+    pco_acquisition_stop(acq);
+    pco_writer_flush(writer);
+    pco_writer_get_counters(writer, &num_written, &num_bytes, &num_dropped);
+    pco_writer_destroy(writer);
+
+    check(d->num_frames > 10, "frames delivered", run);
+    check(d->num_backwards == 0, "frames in order", run);
+    check(num_written == d->num_frames && num_dropped == 0, "frames written", run);
+
+    /* The writer closed the recording, all of it must be in the first file */
+    snprintf(filename, sizeof(filename), "%s-000000.pcoraw", prefix);
+    reader = pco_reader_open(filename);
+    check(reader != NULL, "open recording", run);
+
+    if (reader != NULL) {
+        pco_recording_info info;
+
+        pco_reader_get_info(reader, &info);
+        check(info.width == WIDTH && info.height == HEIGHT, "recorded size", run);
+        num_read = pco_reader_get_num_frames(reader);
+
+        for (uint64_t i = 0; i < num_read && i < d->num_frames; i++) {
+            uint64_t number;
+
+            if (pco_reader_get_frame_number(reader, i, &number) != PCO_NOERROR || number != d->numbers[i])
+                num_wrong_numbers++;
+
+            if (pco_reader_decode_frame(reader, i, frame) != PCO_NOERROR)
+                num_wrong_pixels++;
+            else
+                num_wrong_pixels += count_wrong_pixels(frame);
+        }
+
+        pco_reader_close(reader);
+    }
+
+    check(num_read == d->num_frames, "frames read", run);
+    check(num_wrong_numbers == 0, "frame numbers", run);
+    check(num_wrong_pixels == 0, "pixels", run);
+
+    unlink(filename);
+    snprintf(filename, sizeof(filename), "%s-000001.pcoraw", prefix);
+    check(access(filename, F_OK) != 0, "single file", run);
+
+    pco_acquisition_destroy(acq);
+    pco_destroy(pco);
+    free(frame);
+    free(d);
+}
+
+static void test_policy(pco_drop_policy policy, const char *run)
+{
+    pco_handle pco = open_camera("5x16");
+    pco_acquisition acq = pco_acquisition_init(pco, 16);
+    delivery *d = calloc(1, sizeof(delivery));
+    uint64_t num_decoded, num_dropped, last;
+    pco_drop_stats stats;
+
+    if (acq == NULL || d == NULL) {
+        fprintf(stderr, "Could not set up the acquisition\n");
+        exit(1);
+    }
+
+    /* A consumer at a tenth of the frame rate behind four frame buffers */
+    d->decimation = policy == PCO_DROP_DECIMATE ? 4 : 1;
+    d->delay_ms = 50;
+    check(pco_acquisition_set_decoding(acq, 1, 4) == PCO_NOERROR, "set decoding", run);
+    check(pco_acquisition_set_drop_policy(acq, policy, d->decimation) == PCO_NOERROR, "set policy", run);
+    check(pco_acquisition_set_callback(acq, deliver, d) == PCO_NOERROR, "set callback", run);
+    check(pco_acquisition_start(acq) == PCO_NOERROR, "start", run);
+    sleep_ms(1000);
+    pco_acquisition_stop(acq);
+    pco_acquisition_get_counters(acq, &num_decoded, &num_dropped);
+    pco_acquisition_get_drop_stats(acq, &stats);
+
+    check(d->num_frames > 5, "frames delivered", run);
+    check(d->num_backwards == 0, "frames in order", run);
+    check(d->num_frames <= num_decoded, "delivered frames decoded", run);
+    check(num_dropped == stats.num_overwritten + stats.num_discarded, "drop counters", run);
+
+    /* Each frame up to the last one delivered was either delivered or dropped */
+    last = d->num_frames > 0 ? d->numbers[d->num_frames - 1] : 0;
+    check(last - d->num_frames <= num_dropped, "frames accounted for", run);
+    check(stats.num_recent == (num_dropped < PCO_DROP_HISTORY ? num_dropped : PCO_DROP_HISTORY), "recent drops", run);
+    check(num_dropped == 0 || (stats.first_dropped > 0 && stats.first_dropped <= stats.last_dropped),
+          "first and last drop", run);
+
+    if (policy == PCO_DROP_BLOCK) {
+        check(stats.num_discarded == 0, "nothing discarded", run);
+        check(stats.num_overwritten > 0, "ring overflows", run);
+    }
+    else
+        check(stats.num_discarded > 0, "frames discarded", run);
+
+    /* Frames waiting for a buffer are not discarded but may be overwritten */
+    if (policy == PCO_DROP_DECIMATE && stats.num_overwritten == 0) {
+        for (uint32_t i = 0; i < stats.num_recent; i++)
+            check(stats.recent[i] % d->decimation != 0, "decimation keeps every 4th frame", run);
+    }
+
+    pco_acquisition_destroy(acq);
+    pco_destroy(pco);
+    free(d);
+}
+
+int main(int argc, char const* argv[])
+{
+    char dir[] = "/tmp/pco-recording-XXXXXX";
+
+    if (mkdtemp(dir) == NULL) {
+        fprintf(stderr, "Could not create a directory for the recordings\n");
+        return 1;
+    }
+
+    test_recording(dir, "5x16", false);
+    test_recording(dir, "5x12", true);
+    rmdir(dir);
+
+    test_policy(PCO_DROP_BLOCK, "block");
+    test_policy(PCO_DROP_NEWEST, "drop newest");
+    test_policy(PCO_DROP_OLDEST, "drop oldest");
+    test_policy(PCO_DROP_DECIMATE, "decimate");
+
+    printf("%i failures\n", failures);
+    return failures > 0;
+}
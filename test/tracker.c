@@ -0,0 +1,93 @@
+#include <stdio.h>
+
+#include "libpco.h"
+
+/*
+ * Feeds sequences of image counters to a pco_frame_tracker and checks the
+ * reported gaps and counters, including the wrap of the 8 digit counter and
+ * restarts of the camera.
+ */
+
+static int failures;
+
+static void check(int ok, const char *what)
+{
+    if (!ok) {
+        printf("FAIL %s\n", what);
+        failures++;
+    }
+}
+
+static void track(pco_frame_tracker *tracker, const uint32_t *numbers, const int64_t *gaps, int count,
+                  const char *what)
+{
+    for (int i = 0; i < count; i++) {
+        int64_t gap = pco_track_frame(tracker, numbers[i]);
+
+        if (gap != gaps[i]) {
+            printf("FAIL %s: frame %u returned %lli instead of %lli\n", what, numbers[i],
+                   (long long) gap, (long long) gaps[i]);
+            failures++;
+        }
+    }
+}
+
+static void test_sequence(void)
+{
+    const uint32_t numbers[] = { 1, 2, 3, 6, 7, 7, 5, 8 };
+    const int64_t gaps[] = { 0, 0, 0, 2, 0, -1, -1, 0 };
+    pco_frame_tracker tracker;
+
+    pco_init_frame_tracker(&tracker);
+    track(&tracker, numbers, gaps, 8, "sequence");
+    check(tracker.num_frames == 8, "sequence: frames");
+    check(tracker.num_dropped == 2, "sequence: dropped");
+    check(tracker.num_duplicated == 2, "sequence: duplicated");
+    check(tracker.last_frame_number == 8, "sequence: last frame");
+    check(tracker.num_restarts == 0, "sequence: restarts");
+}
+
+static void test_wrap(void)
+{
+    const uint32_t numbers[] = { 99999997, 99999998, 99999999, 0, 1, 4, 5 };
+    const int64_t gaps[] = { 0, 0, 0, 0, 0, 2, 0 };
+    const uint32_t gap_numbers[] = { 99999995, 3 };
+    const int64_t gap_gaps[] = { 0, 7 };
+    pco_frame_tracker tracker;
+
+    pco_init_frame_tracker(&tracker);
+    track(&tracker, numbers, gaps, 7, "wrap");
+    check(tracker.num_dropped == 2, "wrap: dropped");
+    check(tracker.num_duplicated == 0, "wrap: duplicated");
+    check(tracker.last_frame_number == 5, "wrap: last frame");
+    check(tracker.num_restarts == 0, "wrap: restarts");
+
+    /* Frames lost right across the wrap */
+    pco_init_frame_tracker(&tracker);
+    track(&tracker, gap_numbers, gap_gaps, 2, "wrap with gap");
+    check(tracker.num_dropped == 7, "wrap with gap: dropped");
+}
+
+static void test_restart(void)
+{
+    const uint32_t numbers[] = { 5000, 5001, 1, 2, 3, 3, 4 };
+    const int64_t gaps[] = { 0, 0, 0, 0, 0, -1, 0 };
+    pco_frame_tracker tracker;
+
+    pco_init_frame_tracker(&tracker);
+    track(&tracker, numbers, gaps, 7, "restart");
+    check(tracker.num_dropped == 0, "restart: dropped");
+    check(tracker.num_duplicated == 1, "restart: duplicated");
+    check(tracker.last_frame_number == 4, "restart: last frame");
+    check(tracker.num_restarts == 1, "restart: restarts");
+}
+
+int main(int argc, char const* argv[])
+{
+    test_sequence();
+    test_wrap();
+    test_restart();
+
+    printf("%i failures\n", failures);
+    return failures > 0;
+}